@@ -109,51 +109,121 @@ gdev_prn_open(gx_device * pdev)
     return code;
 }
 
-/* This is called various places to wait for any pending bg print thread and */
-/* perform its cleanup                                                       */
+/* Is the output file closed and reopened for every page? */
+static bool
+prn_file_per_page(gx_device_printer *ppdev)
+{
+    gs_parsed_file_name_t parsed;
+    const char *fmt;
+    int code = gx_parse_output_file_name(&parsed, &fmt, ppdev->fname,
+                                         strlen(ppdev->fname), ppdev->memory);
+
+    return (code >= 0 && fmt) || ppdev->ReopenPerPage;
+}
+
+/* Wait for the oldest page queued for background printing and perform its */
+/* cleanup, i.e. close and unlink the files and free the device and its    */
+/* private allocator.                                                      */
+static void
+prn_retire_bg_page(gx_device_printer *ppdev)
+{
+    bg_print_queue_t *queue = ppdev->bg_print;
+    bg_print_t *bg_print = &queue->pages[queue->head];
+    gx_device_printer *bgppdev = (gx_device_printer *)bg_print->device;
+    gp_file *file = ppdev->file;
+    int closecode;
+
+    /* wait for the semaphore (it may already have been signalled, but that's OK.) */
+    gx_semaphore_wait(bg_print->sema);
+    /* If numcopies > 1, then the bg_print->device will have closed and reopened
+     * the output file, so the pointer in the original device is now stale,
+     * so close the one the background device ended up with. If there is an
+     * output file per page, the foreground device may already have opened the
+     * file for a later page, so put that back afterwards.
+     * If numcopies == 1 with a single output file, this is pointless, but benign.
+     */
+    ppdev->file = bgppdev->file;
+    closecode = gdev_prn_close_printer((gx_device *)ppdev);
+    if (file != bgppdev->file)
+        ppdev->file = file;
+    if (bg_print->return_code == 0)
+        bg_print->return_code = closecode;	/* return code here iff there wasn't another error */
+    teardown_device_and_mem_for_thread(bg_print->device,
+                                       bg_print->thread_id, true);
+    bg_print->device = NULL;
+    if (bg_print->ocfile) {
+        closecode = bg_print->oio_procs->fclose(bg_print->ocfile, bg_print->ocfname, true);
+        if (bg_print->return_code == 0)
+           bg_print->return_code = closecode;
+    }
+    if (bg_print->ocfname) {
+        gs_free_object(ppdev->memory->non_gc_memory, bg_print->ocfname, "prn_finish_bg_print(ocfname)");
+    }
+    if (bg_print->obfile) {
+        closecode = bg_print->oio_procs->fclose(bg_print->obfile, bg_print->obfname, true);
+        if (bg_print->return_code == 0)
+           bg_print->return_code = closecode;
+    }
+    if (bg_print->obfname) {
+        gs_free_object(ppdev->memory->non_gc_memory, bg_print->obfname, "prn_finish_bg_print(obfname)");
+    }
+    bg_print->ocfile = bg_print->obfile =
+      bg_print->ocfname = bg_print->obfname = NULL;
+    if (queue->return_code == 0)
+        queue->return_code = bg_print->return_code;
+    queue->clist_bytes -= bg_print->clist_size;
+    queue->head = (queue->head + 1) % BG_PRINT_MAX_PAGES;
+    queue->count--;
+}
+
+/* Wait until another page can be queued for background printing, i.e. */
+/* until both the number of queued pages and the size of their band    */
+/* lists are below the requested limits.                               */
+static void
+prn_wait_bg_print_queue(gx_device_printer *ppdev)
+{
+    bg_print_queue_t *queue = ppdev->bg_print;
+    int max_pages = min(max(ppdev->bg_print_pages_requested, 1), BG_PRINT_MAX_PAGES);
+
+    if (queue == NULL)
+        return;
+    while (queue->count >= max_pages ||
+           (queue->count > 0 && ppdev->bg_print_max_bytes != 0 &&
+            queue->clist_bytes >= (int64_t)ppdev->bg_print_max_bytes))
+        prn_retire_bg_page(ppdev);
+}
+
+/* This is called various places to wait for any pending bg print threads */
+/* and perform their cleanup                                              */
 static void
 prn_finish_bg_print(gx_device_printer *ppdev)
 {
-    /* if we have a a bg printing device that was created, then wait for its	*/
-    /* semaphore (it may already have been signalled, but that's OK.) then	*/
-    /* close and unlink the files and free the device and its private allocator	*/
-    if (ppdev->bg_print && (ppdev->bg_print->device != NULL)) {
-        int closecode;
-        gx_device_printer *bgppdev = (gx_device_printer *)ppdev->bg_print->device;
-
-        gx_semaphore_wait(ppdev->bg_print->sema);
-        /* If numcopies > 1, then the bg_print->device will have closed and reopened
-         * the output file, so the pointer in the original device is now stale,
-         * so copy it back.
-         * If numcopies == 1, this is pointless, but benign.
-         */
-        ppdev->file = bgppdev->file;
-        closecode = gdev_prn_close_printer((gx_device *)ppdev);
-        if (ppdev->bg_print->return_code == 0)
-            ppdev->bg_print->return_code = closecode;	/* return code here iff there wasn't another error */
-        teardown_device_and_mem_for_thread(ppdev->bg_print->device,
-                                           ppdev->bg_print->thread_id, true);
-        ppdev->bg_print->device = NULL;
-        if (ppdev->bg_print->ocfile) {
-            closecode = ppdev->bg_print->oio_procs->fclose(ppdev->bg_print->ocfile, ppdev->bg_print->ocfname, true);
-            if (ppdev->bg_print->return_code == 0)
-               ppdev->bg_print->return_code = closecode;
-        }
-        if (ppdev->bg_print->ocfname) {
-            gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->ocfname, "prn_finish_bg_print(ocfname)");
-        }
-        if (ppdev->bg_print->obfile) {
-            closecode = ppdev->bg_print->oio_procs->fclose(ppdev->bg_print->obfile, ppdev->bg_print->obfname, true);
-            if (ppdev->bg_print->return_code == 0)
-               ppdev->bg_print->return_code = closecode;
-        }
-        if (ppdev->bg_print->obfname) {
-            gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->obfname, "prn_finish_bg_print(obfname)");
-        }
-        ppdev->bg_print->ocfile = ppdev->bg_print->obfile =
-          ppdev->bg_print->ocfname = ppdev->bg_print->obfname = NULL;
+    while (ppdev->bg_print && ppdev->bg_print->count > 0)
+        prn_retire_bg_page(ppdev);
+}
+
+/* Finish background printing and free the queue */
+static void
+prn_free_bg_print(gx_device_printer *ppdev)
+{
+    bg_print_queue_t *queue = ppdev->bg_print;
+    int i;
+
+    if (queue == NULL)
+        return;
+    prn_finish_bg_print(ppdev);
+    for (i = 0; i < BG_PRINT_MAX_PAGES; i++) {
+        if (queue->pages[i].sema != NULL)
+            gx_semaphore_free(queue->pages[i].sema);
+        if (queue->pages[i].sema_turn != NULL)
+            gx_semaphore_free(queue->pages[i].sema_turn);
     }
+    if (queue->lock != NULL)
+        gx_monitor_free(queue->lock);
+    gs_free_object(ppdev->memory->non_gc_memory, queue, "prn_free_bg_print");
+    ppdev->bg_print = NULL;
 }
+
 /* Generic closing for the printer device. */
 /* Specific devices may wish to extend this. */
 int
@@ -163,10 +233,6 @@ gdev_prn_close(gx_device * pdev)
     int code = 0;
 
     prn_finish_bg_print(ppdev);
-    if (ppdev->bg_print != NULL && ppdev->bg_print->sema != NULL) {
-        gx_semaphore_free(ppdev->bg_print->sema);
-        ppdev->bg_print->sema = NULL;		/* prevent double free */
-    }
     gdev_prn_free_memory(pdev);
     if (ppdev->file != NULL) {
         code = gx_device_close_output_file(pdev, ppdev->fname, ppdev->file);
@@ -290,12 +356,15 @@ gdev_prn_allocate(gx_device *pdev, gdev_space_params *new_space_params,
 
 
     /* bg_print allocation is not fatal, we just continue (as far as possible) without BGPrint */
-    if (ppdev->bg_print == NULL)
-        ppdev->bg_print = (bg_print_t *)gs_alloc_bytes(pdev->memory->non_gc_memory, sizeof(bg_print_t), "prn bg_print");
     if (ppdev->bg_print == NULL) {
-        emprintf(pdev->memory, "Failed to allocate memory for BGPrint, attempting to continue without BGPrint\n");
+        ppdev->bg_print = (bg_print_queue_t *)gs_alloc_bytes(pdev->memory->non_gc_memory, sizeof(bg_print_queue_t), "prn bg_print");
+        if (ppdev->bg_print == NULL)
+            emprintf(pdev->memory, "Failed to allocate memory for BGPrint, attempting to continue without BGPrint\n");
+        else
+            memset(ppdev->bg_print, 0, sizeof(bg_print_queue_t));
     } else {
-        memset(ppdev->bg_print, 0, sizeof(bg_print_t));
+        /* Any queued pages were printed by gdev_prn_tear_down */
+        ppdev->bg_print->return_code = 0;
     }
 
     /* Re/allocate memory */
@@ -416,11 +485,6 @@ gdev_prn_allocate(gx_device *pdev, gdev_space_params *new_space_params,
                 ecode = gs_note_error(gs_error_VMerror);
                 continue;
             }
-            if (ppdev->bg_print) {
-                ppdev->bg_print->ocfname = ppdev->bg_print->obfname =
-                    ppdev->bg_print->obfile = ppdev->bg_print->ocfile = NULL;
-            }
-
             code = clist_mutate_to_clist((gx_device_clist_mutatable *)pdev,
                                          buffer_memory,
                                          &the_memory, &space_params,
@@ -530,8 +594,7 @@ gdev_prn_free_memory(gx_device *pdev)
          ppdev->buffer_memory);
 
     gdev_prn_tear_down(pdev, &the_memory);
-    gs_free_object(pdev->memory->non_gc_memory, ppdev->bg_print, "gdev_prn_free_memory");
-    ppdev->bg_print = NULL;
+    prn_free_bg_print(ppdev);
     gs_free_object(buffer_memory, the_memory, "gdev_prn_free_memory");
     return 0;
 }
@@ -569,12 +632,21 @@ gdev_prn_get_param(gx_device *dev, char *Param, void *list)
     if (strcmp(Param, "NumRenderingThreads") == 0) {
         return param_write_int(plist, "NumRenderingThreads", &ppdev->num_render_threads_requested);
     }
+    if (strcmp(Param, "BandBuffersPerThread") == 0) {
+        return param_write_int(plist, "BandBuffersPerThread", &ppdev->band_buffers_per_thread);
+    }
     if (strcmp(Param, "OpenOutputFile") == 0) {
         return param_write_bool(plist, "OpenOutputFile", &ppdev->OpenOutputFile);
     }
     if (strcmp(Param, "BGPrint") == 0) {
         return param_write_bool(plist, "BGPrint", &ppdev->bg_print_requested);
     }
+    if (strcmp(Param, "BGPrintPages") == 0) {
+        return param_write_int(plist, "BGPrintPages", &ppdev->bg_print_pages_requested);
+    }
+    if (strcmp(Param, "BGPrintMaxBytes") == 0) {
+        return param_write_size_t(plist, "BGPrintMaxBytes", &ppdev->bg_print_max_bytes);
+    }
     if (strcmp(Param, "ReopenPerPage") == 0) {
         return param_write_bool(plist, "ReopenPerPage", &ppdev->ReopenPerPage);
     }
@@ -583,7 +655,11 @@ gdev_prn_get_param(gx_device *dev, char *Param, void *list)
         /* Force the default to 'memory' if clist file I/O is not included in this build */
         if (clist_io_procs_file_global == NULL)
             ppdev->BLS_force_memory = true;
-        if (ppdev->BLS_force_memory) {
+        if (ppdev->BLS_compress) {
+            bls.data = (byte *)"compressed";
+            bls.size = 10;
+            bls.persistent = false;
+        } else if (ppdev->BLS_force_memory) {
             bls.data = (byte *)"memory";
             bls.size = 6;
             bls.persistent = false;
@@ -638,8 +714,11 @@ gdev_prn_get_params(gx_device * pdev, gs_param_list * plist)
                   param_write_bool(plist, "Duplex", &ppdev->Duplex) :
                   param_write_null(plist, "Duplex"))) < 0) ||
         (code = param_write_int(plist, "NumRenderingThreads", &ppdev->num_render_threads_requested)) < 0 ||
+        (code = param_write_int(plist, "BandBuffersPerThread", &ppdev->band_buffers_per_thread)) < 0 ||
         (code = param_write_bool(plist, "OpenOutputFile", &ppdev->OpenOutputFile)) < 0 ||
         (code = param_write_bool(plist, "BGPrint", &ppdev->bg_print_requested)) < 0 ||
+        (code = param_write_int(plist, "BGPrintPages", &ppdev->bg_print_pages_requested)) < 0 ||
+        (code = param_write_size_t(plist, "BGPrintMaxBytes", &ppdev->bg_print_max_bytes)) < 0 ||
         (code = param_write_bool(plist, "ReopenPerPage", &ppdev->ReopenPerPage)) < 0 ||
         (code = param_write_bool(plist, "pageneutralcolor", &pageneutralcolor)) < 0
         )
@@ -648,7 +727,11 @@ gdev_prn_get_params(gx_device * pdev, gs_param_list * plist)
     /* Force the default to 'memory' if clist file I/O is not included in this build */
     if (clist_io_procs_file_global == NULL)
         ppdev->BLS_force_memory = true;
-    if (ppdev->BLS_force_memory) {
+    if (ppdev->BLS_compress) {
+        bls.data = (byte *)"compressed";
+        bls.size = 10;
+        bls.persistent = false;
+    } else if (ppdev->BLS_force_memory) {
         bls.data = (byte *)"memory";
         bls.size = 6;
         bls.persistent = false;
@@ -698,11 +781,14 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
     bool rpp = ppdev->ReopenPerPage;
     bool old_page_uses_transparency = ppdev->page_uses_transparency;
     bool bg_print_requested = ppdev->bg_print_requested;
+    int bg_print_pages = ppdev->bg_print_pages_requested;
+    size_t bg_print_max_bytes = ppdev->bg_print_max_bytes;
     bool duplex;
     int duplex_set = -1;
     int width = pdev->width;
     int height = pdev->height;
     int nthreads = ppdev->num_render_threads_requested;
+    int band_buffers = ppdev->band_buffers_per_thread;
     gdev_space_params save_sp;
     gs_param_string ofs;
     gs_param_string bls;
@@ -750,7 +836,7 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
     switch (code = param_read_string(plist, (param_name = "BandListStorage"), &bls)) {
         case 0:
             /* Only accept 'file' if the file procs are include in the build */
-            if ((bls.size > 1) && (bls.data[0] == 'm' ||
+            if ((bls.size > 1) && (bls.data[0] == 'm' || bls.data[0] == 'c' ||
                  (clist_io_procs_file_global != NULL && bls.data[0] == 'f')))
                 break;
             /* fall through */
@@ -811,6 +897,18 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
         case 1:
             ;
     }
+    switch (code = param_read_int(plist, (param_name = "BandBuffersPerThread"),
+                                                        &band_buffers)) {
+        case 0:
+            if (band_buffers >= 1 && band_buffers <= BAND_BUFFERS_PER_THREAD_MAX)
+                break;
+            code = gs_note_error(gs_error_rangecheck);
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+        case 1:
+            break;
+    }
     switch (code = param_read_bool(plist, (param_name = "BGPrint"),
                                                         &bg_print_requested)) {
         default:
@@ -821,6 +919,28 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
             break;
     }
 
+    switch (code = param_read_int(plist, (param_name = "BGPrintPages"),
+                                                        &bg_print_pages)) {
+        case 0:
+            if (bg_print_pages >= 1 && bg_print_pages <= BG_PRINT_MAX_PAGES)
+                break;
+            code = gs_note_error(gs_error_rangecheck);
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+        case 1:
+            break;
+    }
+    switch (code = param_read_size_t(plist, (param_name = "BGPrintMaxBytes"),
+                                                        &bg_print_max_bytes)) {
+        default:
+            ecode = code;
+            param_signal_error(plist, param_name, ecode);
+        case 0:
+        case 1:
+            break;
+    }
+
     switch (code = param_read_string(plist, (param_name = "saved-pages"),
                                                         &saved_pages)) {
         default:
@@ -859,13 +979,17 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
     }
 
     ppdev->bg_print_requested = bg_print_requested;
+    ppdev->bg_print_pages_requested = bg_print_pages;
+    ppdev->bg_print_max_bytes = bg_print_max_bytes;
     if (duplex_set >= 0) {
         ppdev->Duplex = duplex;
         ppdev->Duplex_set = duplex_set;
     }
     ppdev->num_render_threads_requested = nthreads;
+    ppdev->band_buffers_per_thread = band_buffers;
     if (bls.data != 0) {
-        ppdev->BLS_force_memory = (bls.data[0] == 'm');
+        ppdev->BLS_force_memory = (bls.data[0] == 'm' || bls.data[0] == 'c');
+        ppdev->BLS_compress = (bls.data[0] == 'c');
     }
 
     /* If necessary, free and reallocate the printer memory. */
@@ -904,6 +1028,7 @@ gdev_prn_put_params(gx_device * pdev, gs_param_list * plist)
     /* allocating or freeing a list. This is (sort of) a write-only parameter, so */
     /* the get_params will always return an empty string (a no-op action).        */
     if (saved_pages.data != 0 && saved_pages.size != 0) {
+        prn_finish_bg_print(ppdev);	/* saved pages come after any queued ones */
         return gx_saved_pages_param_process(ppdev, (byte *)saved_pages.data, saved_pages.size);
     }
     return 0;
@@ -933,10 +1058,11 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
     int outcode = 0, errcode = 0, endcode, closecode = 0;
     int code;
 
-    prn_finish_bg_print(ppdev);		/* finish any previous background printing */
+    prn_wait_bg_print_queue(ppdev);	/* make room to queue this page */
 
     if (num_copies > 0 && ppdev->saved_pages_list != NULL) {
         /* We are putting pages on a list */
+        prn_finish_bg_print(ppdev);
         if ((code = gx_saved_pages_list_add(ppdev)) < 0)
             return code;
 
@@ -947,24 +1073,33 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
         if (num_copies > 0) {
             int threads_enabled = 0;
             int print_foreground = 1;		/* default to foreground printing */
+            bg_print_queue_t *queue = ppdev->bg_print;
+            bg_print_t *bg_print = NULL;
 
-            if (bg_print_ok && PRINTER_IS_CLIST(ppdev) && ppdev->bg_print &&
+            if (bg_print_ok && PRINTER_IS_CLIST(ppdev) && queue &&
                 (ppdev->bg_print_requested || ppdev->num_render_threads_requested > 0)) {
                 threads_enabled = clist_enable_multi_thread_render(pdev);
             }
-            /* NB: we leave the semaphore allocated until foreground printing or close */
+            /* NB: we leave the semaphores allocated until the device memory is freed  */
             /* If there was an error, abort on this page -- no good way to handle this */
             /* but it means that the error will be reported AFTER another page was     */
             /* interpreted and written to clist files. FIXME: ???                      */
-            if (ppdev->bg_print && (ppdev->bg_print->return_code < 0)) {
-                outcode = ppdev->bg_print->return_code;
+            if (queue && (queue->return_code < 0)) {
+                outcode = queue->return_code;
                 threads_enabled = 0;	/* and allow current page to try foreground */
             }
             /* Use 'while' instead of 'if' to avoid nesting */
-            while (ppdev->bg_print_requested && ppdev->bg_print && threads_enabled) {
+            while (ppdev->bg_print_requested && queue && threads_enabled) {
                 gx_device *ndev;
                 gx_device_printer *npdev;
                 gx_device_clist_reader *crdev = (gx_device_clist_reader *)ppdev;
+                bg_print_t *prev_print = NULL;
+
+                bg_print = &queue->pages[(queue->head + queue->count) % BG_PRINT_MAX_PAGES];
+                if (queue->count > 0)
+                    prev_print = &queue->pages[(queue->head + queue->count - 1) % BG_PRINT_MAX_PAGES];
+                bg_print->wait_turn = bg_print->turn_pending = bg_print->printed = false;
+                bg_print->return_code = 0;
 
                 if ((code = clist_close_writer_and_init_reader((gx_device_clist *)ppdev)) < 0)
                     /* should not happen -- do foreground print */
@@ -973,39 +1108,58 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
                 /* We need to hang onto references to these files, so we can ensure the main file data
                  * gets freed with the correct allocator.
                  */
-                ppdev->bg_print->ocfname =
+                bg_print->ocfname =
                      (char *)gs_alloc_bytes(ppdev->memory->non_gc_memory,
                            strnlen(crdev->page_info.cfname, gp_file_name_sizeof - 1) + 1, "gdev_prn_output_page_aux(ocfname)");
-                ppdev->bg_print->obfname =
+                bg_print->obfname =
                      (char *)gs_alloc_bytes(ppdev->memory->non_gc_memory,
                            strnlen(crdev->page_info.bfname, gp_file_name_sizeof - 1) + 1,"gdev_prn_output_page_aux(ocfname)");
 
-                if (!ppdev->bg_print->ocfname || !ppdev->bg_print->obfname)
+                if (!bg_print->ocfname || !bg_print->obfname)
                     break;
 
-                strncpy(ppdev->bg_print->ocfname, crdev->page_info.cfname, strnlen(crdev->page_info.cfname, gp_file_name_sizeof - 1) + 1);
-                strncpy(ppdev->bg_print->obfname, crdev->page_info.bfname, strnlen(crdev->page_info.bfname, gp_file_name_sizeof - 1) + 1);
-                ppdev->bg_print->obfile = crdev->page_info.bfile;
-                ppdev->bg_print->ocfile = crdev->page_info.cfile;
-                ppdev->bg_print->oio_procs = crdev->page_info.io_procs;
+                strncpy(bg_print->ocfname, crdev->page_info.cfname, strnlen(crdev->page_info.cfname, gp_file_name_sizeof - 1) + 1);
+                strncpy(bg_print->obfname, crdev->page_info.bfname, strnlen(crdev->page_info.bfname, gp_file_name_sizeof - 1) + 1);
+                bg_print->obfile = crdev->page_info.bfile;
+                bg_print->ocfile = crdev->page_info.cfile;
+                bg_print->oio_procs = crdev->page_info.io_procs;
                 crdev->page_info.cfile = crdev->page_info.bfile = NULL;
 
-                if (ppdev->bg_print->sema == NULL)
+                /* Note how much band list storage the page holds on to while queued */
+                bg_print->clist_size = crdev->page_info.bfile_end_pos;
+                if (bg_print->oio_procs->fseek(bg_print->ocfile, 0, SEEK_END, bg_print->ocfname) >= 0)
+                    bg_print->clist_size += bg_print->oio_procs->ftell(bg_print->ocfile);
+
+                if (queue->lock == NULL)
+                {
+                    queue->lock = gx_monitor_label(gx_monitor_alloc(ppdev->memory->non_gc_memory), "BGPrint queue");
+                    if (queue->lock == NULL)
+                        break;
+                }
+                if (bg_print->sema == NULL)
                 {
-                    ppdev->bg_print->sema = gx_semaphore_label(gx_semaphore_alloc(ppdev->memory->non_gc_memory), "BGPrint");
-                    if (ppdev->bg_print->sema == NULL)
+                    bg_print->sema = gx_semaphore_label(gx_semaphore_alloc(ppdev->memory->non_gc_memory), "BGPrint");
+                    if (bg_print->sema == NULL)
                         break;			/* couldn't create the semaphore */
                 }
+                if (bg_print->sema_turn == NULL)
+                {
+                    bg_print->sema_turn = gx_semaphore_label(gx_semaphore_alloc(ppdev->memory->non_gc_memory), "BGPrint turn");
+                    if (bg_print->sema_turn == NULL)
+                        break;
+                }
 
                 ndev = setup_device_and_mem_for_thread(pdev->memory->thread_safe_memory, pdev, true, NULL);
                 if (ndev == NULL) {
                     break;
                 }
-                ppdev->bg_print->device = ndev;
-                ppdev->bg_print->num_copies = num_copies;
+                bg_print->device = ndev;
+                bg_print->num_copies = num_copies;
+                bg_print->queue = queue;
                 npdev = (gx_device_printer *)ndev;
                 npdev->bg_print_requested = 0;
                 npdev->num_render_threads_requested = ppdev->num_render_threads_requested;
+                npdev->band_buffers_per_thread = ppdev->band_buffers_per_thread;
                 /* The bgprint's device was created with normal procs, so multi-threaded */
                 /* rendering was turned off. Re-enable it now if it is needed.           */
                 if (npdev->num_render_threads_requested > 0) {
@@ -1013,16 +1167,29 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
                     (void)clist_enable_multi_thread_render(ndev);
                 }
 
+                /* Pages are printed in order: if the previous page is still being */
+                /* printed, this page's thread waits until that one is done.       */
+                if (prev_print != NULL) {
+                    gx_monitor_enter(queue->lock);
+                    bg_print->wait_turn = bg_print->turn_pending = !prev_print->printed;
+                    gx_monitor_leave(queue->lock);
+                }
+
                 /* Now start the thread to print the page */
                 if ((code = gp_thread_start(prn_print_page_in_background,
-                                            (void *)(ppdev->bg_print),
-                                            &(ppdev->bg_print->thread_id))) < 0) {
+                                            (void *)bg_print,
+                                            &(bg_print->thread_id))) < 0) {
                     /* Did not start cleanly - clean up is in print_foreground block below */
                     break;
                 }
-                gp_thread_label(ppdev->bg_print->thread_id, "BG print thread");
+                gp_thread_label(bg_print->thread_id, "BG print thread");
                 /* Page was succesfully started in bg_print mode */
                 print_foreground = 0;
+                queue->count++;
+                queue->clist_bytes += bg_print->clist_size;
+                /* The queued page owns its output file if there is one per page */
+                if (prn_file_per_page(ppdev))
+                    ppdev->file = NULL;
                 /* Now we need to set up the next page so it will use new clist files */
                 if ((code = clist_open(pdev)) < 0) 	/* this should do it */
                     /* OOPS! can't proceed with the next page */
@@ -1030,18 +1197,25 @@ gdev_prn_output_page_aux(gx_device * pdev, int num_copies, int flush, bool seeka
                 break;				/* exit the while loop */
             }
             if (print_foreground) {
-                if (ppdev->bg_print) {
-                     gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->ocfname, "gdev_prn_output_page_aux(ocfname)");
-                     gs_free_object(ppdev->memory->non_gc_memory, ppdev->bg_print->obfname, "gdev_prn_output_page_aux(obfname)");
-                     ppdev->bg_print->ocfname = ppdev->bg_print->obfname = NULL;
-
+                /* Queued pages must come out before this one */
+                prn_finish_bg_print(ppdev);
+                if (bg_print) {
+                     gs_free_object(ppdev->memory->non_gc_memory, bg_print->ocfname, "gdev_prn_output_page_aux(ocfname)");
+                     gs_free_object(ppdev->memory->non_gc_memory, bg_print->obfname, "gdev_prn_output_page_aux(obfname)");
+                     bg_print->ocfname = bg_print->obfname = NULL;
+
+                    /* A wake up from the previous page is now owed to this slot, take it */
+                    if (bg_print->wait_turn) {
+                        gx_semaphore_wait(bg_print->sema_turn);
+                        bg_print->wait_turn = false;
+                    }
                     /* either bg_print was not requested or was not able to start */
-                    if (ppdev->bg_print->sema != NULL && ppdev->bg_print->device != NULL) {
+                    if (bg_print->sema != NULL && bg_print->device != NULL) {
                         /* There was a problem. Teardown the device and its allocator, but */
                         /* leave the semaphore for possible later use.                     */
-                        teardown_device_and_mem_for_thread(ppdev->bg_print->device,
-                                                           ppdev->bg_print->thread_id, true);
-                        ppdev->bg_print->device = NULL;
+                        teardown_device_and_mem_for_thread(bg_print->device,
+                                                           bg_print->thread_id, true);
+                        bg_print->device = NULL;
                     }
                 }
                 /* Here's where we actually let the device's print_page_copies work */
@@ -1156,10 +1330,16 @@ static void
 prn_print_page_in_background(void *data)
 {
     bg_print_t *bg_print = (bg_print_t *)data;
+    bg_print_queue_t *queue = bg_print->queue;
+    bg_print_t *next_print;
     int code, errcode = 0;
     int num_copies = bg_print->num_copies;
     gx_device_printer *ppdev = (gx_device_printer *)bg_print->device;
 
+    /* Wait for the previous page to be printed */
+    if (bg_print->wait_turn)
+        gx_semaphore_wait(bg_print->sema_turn);
+
     code = (*ppdev->printer_procs.print_page_copies)(ppdev, ppdev->file,
                                                           num_copies);
     gp_fflush(ppdev->file);
@@ -1167,6 +1347,16 @@ prn_print_page_in_background(void *data)
     errcode = (gp_ferror(ppdev->file) ? gs_note_error(gs_error_ioerror) : 0);
     bg_print->return_code = code < 0 ? code : errcode;
 
+    /* Let the next page go ahead if it is waiting for us */
+    next_print = &queue->pages[(bg_print - queue->pages + 1) % BG_PRINT_MAX_PAGES];
+    gx_monitor_enter(queue->lock);
+    bg_print->printed = true;
+    if (next_print->turn_pending) {
+        next_print->turn_pending = false;
+        gx_semaphore_signal(next_print->sema_turn);
+    }
+    gx_monitor_leave(queue->lock);
+
     /* Finally, release the foreground that may be waiting */
     gx_semaphore_signal(bg_print->sema);
 }
@@ -113,8 +113,39 @@ typedef struct gx_printer_device_procs_s {
 
 #define prn_fname_sizeof gp_file_name_sizeof
 
+/*
+ * Background printing keeps a queue of pages whose band lists have been
+ * written but not yet printed, so that the interpreter can go on with
+ * later pages while earlier ones are rendered.  BGPrintPages limits the
+ * number of queued pages (up to BG_PRINT_MAX_PAGES) and BGPrintMaxBytes
+ * the total size of their band lists.  Each queued page is printed by its
+ * own thread, but a page's thread waits for the previous page to finish
+ * so the output stays in page order.
+ */
+#ifndef BG_PRINT_MAX_PAGES
+#  define BG_PRINT_MAX_PAGES 16
+#endif
+
+/*
+ * With NumRenderingThreads, each rendering thread can be given more than
+ * one band buffer (BandBuffersPerThread), so that threads that have
+ * finished their band can go on with the following ones while a slow
+ * band is still being rendered.
+ */
+#ifndef BAND_BUFFERS_PER_THREAD_MAX
+#  define BAND_BUFFERS_PER_THREAD_MAX 4
+#endif
+
+typedef struct bg_print_queue_s bg_print_queue_t;
+
 typedef struct bg_print_s {
     gx_semaphore_t *sema;		/* used by foreground to wait */
+    gx_semaphore_t *sema_turn;		/* signalled when the previous page is printed */
+    bg_print_queue_t *queue;		/* queue this page belongs to */
+    bool wait_turn;			/* wait on sema_turn before printing */
+    bool turn_pending;			/* previous page has yet to signal sema_turn */
+    bool printed;			/* page has been printed */
+    int64_t clist_size;			/* size of the page's band list */
     gx_device *device;			/* printer/clist device for bg printing */
     gp_thread_id thread_id;
     int num_copies;
@@ -126,6 +157,15 @@ typedef struct bg_print_s {
     const clist_io_procs_t *oio_procs;
 } bg_print_t;
 
+struct bg_print_queue_s {
+    gx_monitor_t *lock;			/* protects the hand over between pages */
+    int head;				/* slot of the oldest queued page */
+    int count;				/* number of queued pages */
+    int64_t clist_bytes;		/* band list size of the queued pages */
+    int return_code;			/* first error from a background page */
+    bg_print_t pages[BG_PRINT_MAX_PAGES];
+};
+
 #define gx_prn_device_common\
         gx_device_clist_mutatable_common;\
         gx_printer_device_procs printer_procs;\
@@ -141,8 +181,11 @@ typedef struct bg_print_s {
         bool file_is_new;		/* true iff file just opened */\
         gp_file *file;  		/* output file */\
         bool bg_print_requested;	/* request background printing of page from clist */\
-        bg_print_t *bg_print;           /* background printing data shared with thread */\
+        bg_print_queue_t *bg_print;     /* background printing data shared with threads */\
+        int bg_print_pages_requested;	/* max pages queued for background printing */\
+        size_t bg_print_max_bytes;	/* max band list size of queued pages, 0 = no limit */\
         int num_render_threads_requested;	/* for multiple band rendering threads */\
+        int band_buffers_per_thread;	/* band buffers for each rendering thread */\
         gx_saved_pages_list *saved_pages_list;	/* list when we are saving pages instead of printing */\
         gx_device_procs save_procs_while_delaying_erasepage	/* save device procs while delaying erasepage. */
 
@@ -221,7 +264,10 @@ prn_dev_proc_get_space_params(gx_default_get_space_params);
         0,	        /* *file */\
         0/*false*/,	/* bg_print_requested */\
         0,              /* *bg_print */\
+        1,              /* bg_print_pages_requested */\
+        0,              /* bg_print_max_bytes */\
         0, 		/* num_render_threads_requested */\
+        1,              /* band_buffers_per_thread */\
         0,              /* saved_pages_list */\
         { 0 }           /* save_procs_while_delaying_erasepage */
 #define prn_device_body_rest_(print_page)\
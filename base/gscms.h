@@ -447,6 +447,8 @@ struct gsicc_link_s {
     struct gsicc_link_cache_s *icc_link_cache;
     int ref_count;
     gsicc_link_t *next;
+    gsicc_link_t *hash_next;	/* next link in the same hash bucket */
+    uint64_t last_used;		/* cache use_count when ref_count last went to 0 */
     gx_monitor_t *lock;		/* lock used while changing contents */
     bool includes_softproof;
     bool includes_devlink;
@@ -464,14 +466,31 @@ struct gsicc_link_s {
  * of links does not exceed a (soft) limit.
  */
 
+#define ICC_CACHE_BUCKETS 64	/* Number of hash buckets, must be a power of 2 */
+
+/* Usage counts for a link cache, to see how much the threads sharing
+ * a cache contend for it. Reported with -Zc when the cache is freed.
+ */
+typedef struct gsicc_link_cache_stats_s {
+    uint64_t lookups;		/* calls to gsicc_findcachelink */
+    uint64_t hits;		/* lookups which found a link */
+    uint64_t build_waits;	/* hits on a link another thread was still building */
+    uint64_t full_waits;	/* times a thread waited because the cache was full */
+    uint64_t evictions;		/* unused links removed to make room */
+} gsicc_link_cache_stats_t;
+
 typedef struct gsicc_link_cache_s {
     gsicc_link_t *head;
     int num_links;
+    int max_links;		/* capacity, see gsicc_cache_max_links */
     rc_header rc;
     gs_memory_t *memory;
     gx_monitor_t *lock;		/* handle for the monitor */
     bool cache_full;		/* flag that some thread needs a cache slot */
     gx_semaphore_t *full_wait;	/* semaphore for waiting when the cache is full */
+    gsicc_link_t *buckets[ICC_CACHE_BUCKETS];	/* hash chains, linked through hash_next */
+    uint64_t use_count;		/* clock used to find the least recently used link */
+    gsicc_link_cache_stats_t stats;
 } gsicc_link_cache_t;
 
 /* A linked list structure to keep DeviceN ICC profiles
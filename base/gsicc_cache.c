@@ -34,6 +34,7 @@
 #include "string_.h"  /* Needed for named color structure allocation */
 #include "gxsync.h"
 #include "gzstate.h"
+#include "gslibctx.h"
 #include "stdint_.h"
         /*
          *  Note that the the external memory used to maintain
@@ -44,9 +45,19 @@
          *  We will likely want to do at least have an estimate of the
          *  memory used based upon how the CMS is configured.
          *  This will be done later.  For now, just limit the number
-         *  of links.
+         *  of links. The default limit can be changed at build time by
+         *  defining ICC_CACHE_MAXLINKS, and at run time with the
+         *  MaxICCLinks user parameter. It is held in each cache
+         *  (max_links).
          */
+#ifndef ICC_CACHE_MAXLINKS
 #define ICC_CACHE_MAXLINKS (MAX_THREADS*2)	/* allow up to two active links per thread */
+#endif
+
+/* Select the hash bucket for a link. The link hashcodes for the no-cm and
+   replace links are small integers, so mix the bits before masking. */
+#define ICC_CACHE_BUCKET(hashcode)\
+    ((uint)(((uint64_t)(hashcode) * 0x9E3779B97F4A7C15ULL) >> 58) & (ICC_CACHE_BUCKETS - 1))
 
 /* Static prototypes */
 
@@ -71,15 +82,38 @@ static void rc_gsicc_link_cache_free(gs_memory_t * mem, void *ptr_in, client_nam
 
 struct_proc_finalize(icc_link_finalize);
 
-gs_private_st_ptrs3_final(st_icc_link, gsicc_link_t, "gsiccmanage_link",
+gs_private_st_ptrs4_final(st_icc_link, gsicc_link_t, "gsiccmanage_link",
                     icc_link_enum_ptrs, icc_link_reloc_ptrs, icc_link_finalize,
-                    icc_link_cache, next, lock);
+                    icc_link_cache, next, lock, hash_next);
 
 struct_proc_finalize(icc_linkcache_finalize);
 
-gs_private_st_ptrs3_final(st_icc_linkcache, gsicc_link_cache_t, "gsiccmanage_linkcache",
-                    icc_linkcache_enum_ptrs, icc_linkcache_reloc_ptrs, icc_linkcache_finalize,
-                    head, lock, full_wait);
+static
+ENUM_PTRS_WITH(icc_linkcache_enum_ptrs, gsicc_link_cache_t *link_cache)
+    index -= 3;
+    if (index < ICC_CACHE_BUCKETS)
+        ENUM_RETURN(link_cache->buckets[index]);
+    return 0;
+    case 0: ENUM_RETURN(link_cache->head);
+    case 1: ENUM_RETURN(link_cache->lock);
+    case 2: ENUM_RETURN(link_cache->full_wait);
+ENUM_PTRS_END
+
+static
+RELOC_PTRS_WITH(icc_linkcache_reloc_ptrs, gsicc_link_cache_t *link_cache)
+{
+    int i;
+
+    RELOC_VAR(link_cache->head);
+    RELOC_VAR(link_cache->lock);
+    RELOC_VAR(link_cache->full_wait);
+    for (i = 0; i < ICC_CACHE_BUCKETS; i++)
+        RELOC_VAR(link_cache->buckets[i]);
+}
+RELOC_PTRS_END
+
+gs_private_st_composite_use_final(st_icc_linkcache, gsicc_link_cache_t, "gsiccmanage_linkcache",
+                    icc_linkcache_enum_ptrs, icc_linkcache_reloc_ptrs, icc_linkcache_finalize);
 
 /* These are used to construct a hash for the ICC link based upon the
    render parameters */
@@ -88,6 +122,43 @@ gs_private_st_ptrs3_final(st_icc_linkcache, gsicc_link_cache_t, "gsiccmanage_lin
 #define REND_SHIFT 8
 #define PRESERVE_SHIFT 16
 
+/**
+ * gsicc_cache_max_links: The number of links new caches may hold, as set by
+ * the MaxICCLinks user parameter.
+ **/
+int
+gsicc_cache_max_links(const gs_memory_t *memory)
+{
+    gs_lib_ctx_t *ctx = memory->gs_lib_ctx;
+
+    if (ctx == NULL || ctx->icc_cache_max_links <= 0)
+        return ICC_CACHE_MAXLINKS;
+    return ctx->icc_cache_max_links;
+}
+
+/**
+ * gsicc_cache_set_max_links: Set the number of links held by the cache of a
+ * gstate, and by the caches created after this (such as those of the clist
+ * rendering threads). If the cache holds more links than that, the least
+ * recently used ones are dropped as new links are added.
+ **/
+int
+gsicc_cache_set_max_links(gs_gstate *pgs, int max_links)
+{
+    gsicc_link_cache_t *cache = pgs->icc_link_cache;
+
+    if (max_links < ICC_CACHE_MINLINKS)
+        return_error(gs_error_rangecheck);
+    if (pgs->memory->gs_lib_ctx != NULL)
+        pgs->memory->gs_lib_ctx->icc_cache_max_links = max_links;
+    if (cache != NULL) {
+        gx_monitor_enter(cache->lock);
+        cache->max_links = max_links;
+        gx_monitor_leave(cache->lock);
+    }
+    return 0;
+}
+
 /**
  * gsicc_cache_new: Allocate a new ICC cache manager
  * Return value: Pointer to allocated manager, or NULL on failure.
@@ -106,7 +177,11 @@ gsicc_cache_new(gs_memory_t *memory)
         return(NULL);
     result->head = NULL;
     result->num_links = 0;
+    result->max_links = gsicc_cache_max_links(memory);
     result->cache_full = false;
+    memset(result->buckets, 0, sizeof(result->buckets));
+    result->use_count = 0;
+    memset(&result->stats, 0, sizeof(result->stats));
     result->memory = memory->stable_memory;
     result->lock = gx_monitor_label(gx_monitor_alloc(memory->stable_memory),
                                     "gsicc_cache_new");
@@ -147,6 +222,12 @@ icc_linkcache_finalize(const gs_memory_t *mem, void *ptr)
 {
     gsicc_link_cache_t *link_cache = (gsicc_link_cache_t * ) ptr;
 
+    if_debug6m(gs_debug_flag_icc, mem,
+               "[icc] Link cache "PRI_INTPTR" lookups = %"PRIu64" hits = %"PRIu64
+               " build waits = %"PRIu64" full waits = %"PRIu64" evictions = %"PRIu64"\n",
+               (intptr_t)link_cache, link_cache->stats.lookups, link_cache->stats.hits,
+               link_cache->stats.build_waits, link_cache->stats.full_waits,
+               link_cache->stats.evictions);
     while (link_cache->head != NULL) {
         if (link_cache->head->ref_count != 0) {
             emprintf2(mem, "link at "PRI_INTPTR" being removed, but has ref_count = %d\n",
@@ -198,6 +279,8 @@ gsicc_alloc_link_dev(gs_memory_t *memory, cmm_profile_t *src_profile,
     result->orig_procs.map_color = NULL;
     result->orig_procs.free_link = NULL;
     result->next = NULL;
+    result->hash_next = NULL;
+    result->last_used = 0;
     result->link_handle = NULL;
     result->icc_link_cache = NULL;
     result->procs.map_buffer = gscms_transform_color_buffer;
@@ -281,6 +364,8 @@ gsicc_alloc_link(gs_memory_t *memory, gsicc_hashlink_t hashcode)
     result->orig_procs.map_color = NULL;
     result->orig_procs.free_link = NULL;
     result->next = NULL;
+    result->hash_next = NULL;
+    result->last_used = 0;
     result->link_handle = NULL;
     result->procs.map_buffer = gscms_transform_color_buffer;
     result->procs.map_color = gscms_transform_color;
@@ -525,33 +610,30 @@ gsicc_link_t*
 gsicc_findcachelink(gsicc_hashlink_t hash, gsicc_link_cache_t *icc_link_cache,
                     bool includes_proof, bool includes_devlink)
 {
-    gsicc_link_t *curr, *prev;
+    gsicc_link_t *curr;
     int64_t hashcode = hash.link_hashcode;
 
     /* Look through the cache for the hashcode */
     gx_monitor_enter(icc_link_cache->lock);
+    icc_link_cache->stats.lookups++;
 
-    /* List scanning is fast, so we scan the entire list, this includes   */
-    /* links that are currently unused, but still in the cache (zero_ref) */
-    curr = icc_link_cache->head;
-    prev = NULL;
+    /* Only the links in the matching hash bucket need to be checked, this */
+    /* includes links that are currently unused, but still in the cache   */
+    /* (zero_ref). Nothing is reordered on a hit (the LRU order of unused */
+    /* links is kept by last_used) so the lock is only held briefly.      */
+    curr = icc_link_cache->buckets[ICC_CACHE_BUCKET(hashcode)];
 
     while (curr != NULL ) {
         if (curr->hashcode.link_hashcode == hashcode &&
             includes_proof == curr->includes_softproof &&
             includes_devlink == curr->includes_devlink) {
-            /* move this one to the front of the list hoping we will use it
-               again soon */
-            if (prev != NULL) {
-                /* if prev == NULL, curr is already the head */
-                prev->next = curr->next;
-                curr->next = icc_link_cache->head;
-                icc_link_cache->head = curr;
-            }
+            icc_link_cache->stats.hits++;
             /* bump the ref_count since we will be using this one */
             curr->ref_count++;
             if_debug3m('^', curr->memory, "[^]%s "PRI_INTPTR" ++ => %d\n",
                        "icclink", (intptr_t)curr, curr->ref_count);
+            if (curr->valid == false)
+                icc_link_cache->stats.build_waits++;
             while (curr->valid == false) {
                 gx_monitor_leave(icc_link_cache->lock); /* exit to let other threads run briefly */
                 gx_monitor_enter(curr->lock);			/* wait until we can acquire the lock */
@@ -567,8 +649,7 @@ gsicc_findcachelink(gsicc_hashlink_t hash, gsicc_link_cache_t *icc_link_cache,
             gx_monitor_leave(icc_link_cache->lock);
             return(curr);	/* success */
         }
-        prev = curr;
-        curr = curr->next;
+        curr = curr->hash_next;
     }
     gx_monitor_leave(icc_link_cache->lock);
     return NULL;
@@ -608,6 +689,12 @@ gsicc_remove_link(gsicc_link_t *link, const gs_memory_t *memory)
     /* if curr != link we didn't find it or another thread may have decided to */
     /* use it (ref_count > 0). Skip freeing it if so.                          */
     if (curr == link && link->ref_count == 0) {
+        gsicc_link_t **bucket = &icc_link_cache->buckets[ICC_CACHE_BUCKET(link->hashcode.link_hashcode)];
+
+        while (*bucket != NULL && *bucket != link)
+            bucket = &(*bucket)->hash_next;
+        if (*bucket == link)
+            *bucket = link->hash_next;
         icc_link_cache->num_links--;	/* no longer in the cache */
         if (icc_link_cache->cache_full) {
             icc_link_cache->cache_full = false;
@@ -869,34 +956,29 @@ gsicc_alloc_link_entry(gsicc_link_cache_t *icc_link_cache,
                        bool include_softproof, bool include_devlink)
 {
     gs_memory_t *cache_mem = icc_link_cache->memory;
-    gsicc_link_t *link;
+    gsicc_link_t *link, *curr;
     int retries = 0;
 
     *ret_link = NULL;
     /* First see if we can add a link */
     /* TODO: this should be based on memory usage, not just num_links */
     gx_monitor_enter(icc_link_cache->lock);
-    while (icc_link_cache->num_links >= ICC_CACHE_MAXLINKS) {
-        /* Look through the cache for first zero ref count to re-use that entry.
-           When ref counts go to zero, the icc_link will have been moved to
-           the end of the list, so the first we find is the 'oldest'.
-           If we get to the last entry we release the lock, set the cache_full
+    while (icc_link_cache->num_links >= icc_link_cache->max_links) {
+        /* Look through the cache for the zero ref count entry that was
+           released longest ago (lowest last_used) to re-use that entry.
+           If there isn't one we release the lock, set the cache_full
            flag and wait on full_wait for some other thread to let this thread
            run again after releasing a cache slot. Release the cache lock to
            let other threads run and finish with (release) a cache entry.
         */
-        link = icc_link_cache->head;
-        while (link != NULL ) {
-            if (link->ref_count == 0) {
-                /* we will use this one */
-                if_debug3m('^', cache_mem, "[^]%s "PRI_INTPTR" ++ => %d\n",
-                           "icclink", (intptr_t)link, link->ref_count);
-                break;
-            }
-            link = link->next;
+        link = NULL;
+        for (curr = icc_link_cache->head; curr != NULL; curr = curr->next) {
+            if (curr->ref_count == 0 && (link == NULL || curr->last_used < link->last_used))
+                link = curr;
         }
         if (link == NULL) {
             icc_link_cache->cache_full = true;
+            icc_link_cache->stats.full_waits++;
             /* unlock while waiting for a link to come available */
             gx_monitor_leave(icc_link_cache->lock);
             gx_semaphore_wait(icc_link_cache->full_wait);
@@ -918,6 +1000,9 @@ gsicc_alloc_link_entry(gsicc_link_cache_t *icc_link_cache,
             /* Even if we remove this link, we may still be maxed out so*/
             /* the outermost 'while' will check to make sure some other	*/
             /* thread did not grab the one we remove.			*/
+            if_debug3m('^', cache_mem, "[^]%s "PRI_INTPTR" ++ => %d\n",
+                       "icclink", (intptr_t)link, link->ref_count);
+            icc_link_cache->stats.evictions++;
             gsicc_remove_link(link, cache_mem);
         }
     }
@@ -928,9 +1013,13 @@ gsicc_alloc_link_entry(gsicc_link_cache_t *icc_link_cache,
     /* NB: the link returned will be have the lock owned by this thread */
     /* the lock will be released when the link becomes valid.           */
     if (*ret_link) {
+        gsicc_link_t **bucket = &icc_link_cache->buckets[ICC_CACHE_BUCKET(hash.link_hashcode)];
+
         (*ret_link)->icc_link_cache = icc_link_cache;
         (*ret_link)->next = icc_link_cache->head;
         icc_link_cache->head = *ret_link;
+        (*ret_link)->hash_next = *bucket;
+        *bucket = *ret_link;
         icc_link_cache->num_links++;
     }
     /* unlock before returning */
@@ -1779,39 +1868,10 @@ gsicc_release_link(gsicc_link_t *icclink)
                (intptr_t)icclink, icclink->ref_count - 1);
     /* Decrement the reference count */
     if (--(icclink->ref_count) == 0) {
+        /* Note when it was released, so that the least recently used */
+        /* zero ref_count link is the first to be reused.		  */
+        icclink->last_used = ++icc_link_cache->use_count;
 
-        gsicc_link_t *curr, *prev;
-
-        /* Find link in cache, and move it to the end of the list.  */
-        /* This way zero ref_count links are found LRU first	*/
-        curr = icc_link_cache->head;
-        prev = NULL;
-        while (curr != icclink) {
-            prev = curr;
-            curr = curr->next;
-        };
-        if (prev == NULL) {
-            /* this link was the head */
-            icc_link_cache->head = curr->next;
-        } else {
-            prev->next = curr->next;		/* de-link this one */
-        }
-        /* Find the first zero-ref entry on the list */
-        curr = icc_link_cache->head;
-        prev = NULL;
-        while (curr != NULL && curr->ref_count > 0) {
-            prev = curr;
-            curr = curr->next;
-        }
-        /* Found where to link this one into the tail of the list */
-        if (prev == NULL) {
-            icc_link_cache->head = icclink;
-            icclink->next = icc_link_cache->head->next;
-        } else {
-            /* link this one in here */
-            prev->next = icclink;
-            icclink->next = curr;
-        }
         /* Finally, if some thread was waiting because the cache was full, let it run */
         if (icc_link_cache->cache_full) {
             icc_link_cache->cache_full = false;
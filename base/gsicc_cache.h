@@ -29,7 +29,14 @@ typedef struct gsicc_namedcolor_s {
     unsigned short lab[3];          /* CIELAB D50 values */
 } gsicc_namedcolor_t;
 
+/* A thread may hold several links at once (an image, a transparency group
+ * and its blending space...), and waits for a free slot when the cache is
+ * full, so the cache size can't be set lower than this. */
+#define ICC_CACHE_MINLINKS 8
+
 gsicc_link_cache_t* gsicc_cache_new(gs_memory_t *memory);
+int gsicc_cache_max_links(const gs_memory_t *memory);
+int gsicc_cache_set_max_links(gs_gstate *pgs, int max_links);
 gsicc_link_t* gsicc_findcachelink(gsicc_hashlink_t hashcode,
                                   gsicc_link_cache_t *icc_link_cache,
                                   bool includes_proof, bool includes_devlink);
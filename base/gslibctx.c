@@ -398,6 +398,8 @@ void gs_lib_ctx_fin(gs_memory_t *mem)
 
     sjpxd_destroy(mem);
     gscms_destroy(ctx_mem);
+    if (ctx->free_shading_tess_cache)
+        ctx->free_shading_tess_cache(ctx->shading_tess_cache);
     gs_free_object(ctx_mem, ctx->profiledir,
         "gs_lib_ctx_fin");
 
@@ -439,6 +441,9 @@ void gs_lib_ctx_fin(gs_memory_t *mem)
             entry = next;
         }
 
+        if (ctx->core->free_shared_char_cache)
+            ctx->core->free_shared_char_cache(ctx->core->shared_char_cache);
+
         for (i = 0; i < ctx->core->argc; i++)
             gs_free_object(ctx->core->memory, ctx->core->argv[i], "gs_lib_ctx_arg");
         gs_free_object(ctx->core->memory, ctx->core->argv, "gs_lib_ctx_args");
@@ -137,6 +137,12 @@ typedef struct {
     int arg_max;
     int argc;
     char **argv;
+
+    /* Glyph cache shared by the instances using this core, see gxccshr.h.
+     * It is freed through the pointer so that this file doesn't need to
+     * link with the font machinery. */
+    void *shared_char_cache;
+    void (*free_shared_char_cache)(void *cache);
 } gs_lib_ctx_core_t;
 
 typedef struct gs_lib_ctx_s
@@ -181,6 +187,13 @@ typedef struct gs_lib_ctx_s
     char *default_device_list;
     int gcsignal;
     void *sjpxd_private; /* optional for use of jpx codec */
+    /* Cache of shading decompositions, see gxshtess.h. It is freed through
+     * the pointer so that this file doesn't need to link with the shading
+     * code. */
+    void *shading_tess_cache;
+    void (*free_shading_tess_cache)(void *cache);
+    /* Size of new ICC link caches (MaxICCLinks), 0 for the default. */
+    int icc_cache_max_links;
 } gs_lib_ctx_t;
 
 enum {
@@ -98,6 +98,72 @@ static void record(int rop)
   (ptr)[1] = (byte)((uint)(pixel) >> 8),\
   (ptr)[2] = (byte)(pixel)
 
+#ifdef HAVE_SSE2
+/* SSE2 code for the generic run functions, that can do any rop 16 bytes
+ * at a time. For each of the 4 combinations of S and T, the rop reduces
+ * to a function of D alone (0, D, ~D or 1), which we can write as
+ * (D & a) ^ b. mm_rop3_setup calculates a and b for each of these, and
+ * mm_rop3 then selects between the 4 results using S and T. */
+static void
+mm_rop3_setup(__m128i *masks, int rop)
+{
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        /* i = (T<<1) | S. Bit 0 of f is the result for D=0, bit 1 for D=1 */
+        int f = (rop >> (2*i)) & 3;
+
+        masks[2*i]   = _mm_set1_epi8((char)(f == 1 || f == 2 ? 0xff : 0));
+        masks[2*i+1] = _mm_set1_epi8((char)(f & 1 ? 0xff : 0));
+    }
+}
+
+static inline __m128i
+mm_rop3(const __m128i *masks, __m128i D, __m128i S, __m128i T)
+{
+    __m128i f00 = _mm_xor_si128(_mm_and_si128(D, masks[0]), masks[1]);
+    __m128i f01 = _mm_xor_si128(_mm_and_si128(D, masks[2]), masks[3]);
+    __m128i f10 = _mm_xor_si128(_mm_and_si128(D, masks[4]), masks[5]);
+    __m128i f11 = _mm_xor_si128(_mm_and_si128(D, masks[6]), masks[7]);
+    __m128i f0  = _mm_or_si128(_mm_and_si128(S, f01), _mm_andnot_si128(S, f00));
+    __m128i f1  = _mm_or_si128(_mm_and_si128(S, f11), _mm_andnot_si128(S, f10));
+
+    return _mm_or_si128(_mm_and_si128(T, f1), _mm_andnot_si128(T, f0));
+}
+
+/* Expand a 24 bit constant to the 48 bytes (16 pixels) it makes. */
+static void
+mm_set_pattern24(__m128i *v, rop_operand c)
+{
+    byte pattern[48];
+    int i;
+
+    for (i = 0; i < 48; i += 3)
+        put24(&pattern[i], c);
+    v[0] = _mm_loadu_si128((const __m128i *)pattern);
+    v[1] = _mm_loadu_si128((const __m128i *)(pattern + 16));
+    v[2] = _mm_loadu_si128((const __m128i *)(pattern + 32));
+}
+
+#define MM_GENERIC_SETUP() __m128i mm_masks[8]; mm_rop3_setup(mm_masks, lop_rop(op->rop))
+#define MM_GENERIC_CODE(O,D,S,T) do { _mm_storeu_si128(O,mm_rop3(mm_masks,_mm_loadu_si128(D),S,T)); } while (0 == 1)
+
+/* The byte at a time loops give the 'expected' results when S or T
+ * overlaps D from slightly behind (such as when scrolling a line to the
+ * right). Only use the 16 byte loops when that can't happen. */
+#define MM_NO_OVERLAP(d, s) \
+    ((const byte *)(d) <= (const byte *)(s) || (const byte *)(d) >= (const byte *)(s) + 16)
+
+/* The unit test at the end of this file turns the SSE2 loops off to get
+ * the results of the byte at a time code to compare them with. */
+#ifdef UNIT_TEST
+static int mm_enabled = 1;
+#define MM_ENABLED mm_enabled
+#else
+#define MM_ENABLED 1
+#endif
+#endif
+
 /* Rop specific code */
 /* Rop 0x55 = Invert   dep=1  (all cases) */
 #ifdef USE_TEMPLATES
@@ -575,6 +641,8 @@ static void copys_rop_run24(rop_run_op *op, byte *d, int len)
 /* Generic ROP run code */
 #ifdef USE_TEMPLATES
 #define TEMPLATE_NAME          generic_rop_run1
+#define MM_SETUP()             MM_GENERIC_SETUP()
+#define MM_SPECIFIC_CODE       MM_GENERIC_CODE
 #include "gsroprun1.h"
 #else
 static void generic_rop_run1(rop_run_op *op, byte *d, int len)
@@ -683,6 +751,8 @@ static void generic_rop_run1(rop_run_op *op, byte *d, int len)
 
 #ifdef USE_TEMPLATES
 #define TEMPLATE_NAME          generic_rop_run8
+#define MM_SETUP()             MM_GENERIC_SETUP()
+#define MM_SPECIFIC_CODE       MM_GENERIC_CODE
 #include "gsroprun8.h"
 #else
 static void generic_rop_run8(rop_run_op *op, byte *d, int len)
@@ -700,6 +770,8 @@ static void generic_rop_run8(rop_run_op *op, byte *d, int len)
 
 #ifdef USE_TEMPLATES
 #define TEMPLATE_NAME          generic_rop_run8_1bit
+#define MM_SETUP()             MM_GENERIC_SETUP()
+#define MM_SPECIFIC_CODE       MM_GENERIC_CODE
 #define S_TRANS MAYBE
 #define T_TRANS MAYBE
 #define S_1BIT  MAYBE
@@ -755,6 +827,8 @@ static void generic_rop_run8_1bit(rop_run_op *op, byte *d, int len)
 
 #ifdef USE_TEMPLATES
 #define TEMPLATE_NAME          generic_rop_run24
+#define MM_SETUP()             MM_GENERIC_SETUP()
+#define MM_SPECIFIC_CODE       MM_GENERIC_CODE
 #include "gsroprun24.h"
 #else
 static void generic_rop_run24(rop_run_op *op, byte *d, int len)
@@ -776,6 +850,8 @@ static void generic_rop_run24(rop_run_op *op, byte *d, int len)
 
 #ifdef USE_TEMPLATES
 #define TEMPLATE_NAME          generic_rop_run24_1bit
+#define MM_SETUP()             MM_GENERIC_SETUP()
+#define MM_SPECIFIC_CODE       MM_GENERIC_CODE
 #define S_TRANS MAYBE
 #define T_TRANS MAYBE
 #define S_1BIT MAYBE
@@ -836,6 +912,8 @@ static void generic_rop_run24_1bit(rop_run_op *op, byte *d, int len)
 
 #ifdef USE_TEMPLATES
 #define TEMPLATE_NAME          generic_rop_run1_const_t
+#define MM_SETUP()             MM_GENERIC_SETUP()
+#define MM_SPECIFIC_CODE       MM_GENERIC_CODE
 #define T_CONST
 #include "gsroprun1.h"
 #else
@@ -918,6 +996,8 @@ static void generic_rop_run1_const_t(rop_run_op *op, byte *d, int len)
 
 #ifdef USE_TEMPLATES
 #define TEMPLATE_NAME          generic_rop_run8_const_t
+#define MM_SETUP()             MM_GENERIC_SETUP()
+#define MM_SPECIFIC_CODE       MM_GENERIC_CODE
 #define T_CONST
 #include "gsroprun8.h"
 #else
@@ -967,6 +1047,8 @@ static void generic_rop_run8_1bit_const_t(rop_run_op *op, byte *d, int len)
 
 #ifdef USE_TEMPLATES
 #define TEMPLATE_NAME          generic_rop_run24_const_t
+#define MM_SETUP()             MM_GENERIC_SETUP()
+#define MM_SPECIFIC_CODE       MM_GENERIC_CODE
 #define T_CONST
 #include "gsroprun24.h"
 #else
@@ -1024,6 +1106,8 @@ static void generic_rop_run24_1bit_const_t(rop_run_op *op, byte *d, int len)
 
 #ifdef USE_TEMPLATES
 #define TEMPLATE_NAME          generic_rop_run1_const_st
+#define MM_SETUP()             MM_GENERIC_SETUP()
+#define MM_SPECIFIC_CODE       MM_GENERIC_CODE
 #define T_CONST
 #define S_CONST
 #include "gsroprun1.h"
@@ -1089,6 +1173,8 @@ static void generic_rop_run1_const_st(rop_run_op *op, byte *d, int len)
 
 #ifdef USE_TEMPLATES
 #define TEMPLATE_NAME          generic_rop_run8_const_st
+#define MM_SETUP()             MM_GENERIC_SETUP()
+#define MM_SPECIFIC_CODE       MM_GENERIC_CODE
 #define S_CONST
 #define T_CONST
 #include "gsroprun8.h"
@@ -1109,6 +1195,8 @@ static void generic_rop_run8_const_st(rop_run_op *op, byte *d, int len)
 
 #ifdef USE_TEMPLATES
 #define TEMPLATE_NAME          generic_rop_run24_const_st
+#define MM_SETUP()             MM_GENERIC_SETUP()
+#define MM_SPECIFIC_CODE       MM_GENERIC_CODE
 #define S_CONST
 #define T_CONST
 #include "gsroprun24.h"
@@ -1522,3 +1610,212 @@ void (rop_release_run_op)(rop_run_op *op)
 {
     rop_release_run_op(op);
 }
+
+#if defined(UNIT_TEST) && defined(HAVE_SSE2)
+
+/*
+ * Checks that the SSE2 loops of the run functions give exactly the same
+ * results as the byte (or chunk) at a time loops, for every rop at 1, 8
+ * and 24 bits, with S and T each a bitmap, a constant or (at 8 and 24
+ * bits) a 1 bit bitmap, at unaligned byte and bit positions, and with S
+ * or T overlapping D. It then reports the throughput of the generic
+ * runs with and without SSE2. Build it against the objects of a normal
+ * gs build, compiling this file with the usual flags plus -DUNIT_TEST and
+ * linking it with the objects listed in obj/ldt.tr other than gs.o and
+ * gsroprun.o, for instance:
+ *
+ *   gcc <CFLAGS> -DUNIT_TEST -c base/gsroprun.c -o obj/gsroprun_test.o
+ *   gcc -o gsroprun_test obj/gsroprun_test.o $(tr -d '\\' < obj/ldt.tr | tr ' ' '\n' |
+ *       grep -v -x -e gcc -e -o -e ./bin/gs -e ./obj/gs.o -e ./obj/gsroprun.o)
+ *
+ * It exits non zero on any difference.
+ */
+
+#include "time_.h"
+
+#undef printf
+
+static ulong rop_test_seed = 1;
+
+static uint
+rop_test_random(void)
+{
+    rop_test_seed = rop_test_seed * 1103515245 + 12345;
+    return (uint)(rop_test_seed >> 16) & 0x7fff;
+}
+
+/* D, S and T each have a region of the arena. An S or T that overlaps D
+ * points into the D region instead. The margins take the reads that the
+ * 1 bit code makes before and after the run. */
+#define ROP_TEST_REGION 1024
+#define ROP_TEST_ARENA (ROP_TEST_REGION * 4)
+
+static byte rop_test_arena[2][ROP_TEST_ARENA];
+
+enum { rop_test_bitmap, rop_test_constant, rop_test_1bit };
+
+static const char *const rop_test_kind_names[] = { "bitmap", "constant", "1 bit" };
+
+typedef struct rop_test_operand_s {
+    int kind;
+    int offset;             /* in the arena */
+    int pos;                /* bit position */
+    rop_operand c;          /* constant */
+    gx_color_index colors[2];
+} rop_test_operand;
+
+static rop_operand
+rop_test_color(int depth)
+{
+    rop_operand c = (rop_test_random() << 15) ^ rop_test_random();
+
+    if (depth == 1)
+        return c & 1;
+    if (depth == 8)
+        return c & 0xff;
+    /* Grey often, so that 24 bit runs get folded to 8 bit ones. */
+    if (rop_test_random() & 1)
+        return (c & 0xff) * 0x010101;
+    return c & 0xffffff;
+}
+
+static void
+rop_test_set_operand(rop_test_operand *o, int kind, int depth, int region, int d_offset)
+{
+    o->kind = kind;
+    o->pos = rop_test_random() & 7;
+    o->c = rop_test_color(depth);
+    o->colors[0] = rop_test_color(depth);
+    o->colors[1] = rop_test_color(depth);
+    switch (rop_test_random() & 7) {
+    case 0: /* Overlapping D, from behind or ahead. */
+        o->offset = d_offset + (int)(rop_test_random() % 35) - 17;
+        break;
+    case 1: /* Same alignment as D, which the 1 bit SSE2 loop needs. */
+        o->offset = region + (d_offset & 15);
+        break;
+    default:
+        o->offset = region + (rop_test_random() & 15);
+        break;
+    }
+}
+
+static void
+rop_test_run(int pass, int rop, int depth, const rop_test_operand *s,
+             const rop_test_operand *t, int d_offset, int dpos, int len)
+{
+    byte *arena = rop_test_arena[pass];
+    rop_run_op op;
+    int flags = 0;
+
+    if (s->kind == rop_test_constant) {
+        flags |= rop_s_constant;
+        rop_set_s_constant(&op, s->c);
+    }
+    if (t->kind == rop_test_constant) {
+        flags |= rop_t_constant;
+        rop_set_t_constant(&op, t->c);
+    }
+    if (s->kind == rop_test_1bit)
+        flags |= rop_s_1bit;
+    if (t->kind == rop_test_1bit)
+        flags |= rop_t_1bit;
+    rop_get_run_op(&op, rop, depth, flags);
+    if (s->kind != rop_test_constant)
+        rop_set_s_bitmap_subbyte(&op, arena + s->offset, depth == 1 || s->kind == rop_test_1bit ? s->pos : 0);
+    if (t->kind != rop_test_constant)
+        rop_set_t_bitmap_subbyte(&op, arena + t->offset, depth == 1 || t->kind == rop_test_1bit ? t->pos : 0);
+    rop_set_s_colors(&op, s->colors);
+    rop_set_t_colors(&op, t->colors);
+    mm_enabled = pass;
+    rop_run_subbyte(&op, arena + d_offset, dpos, len);
+    mm_enabled = 1;
+    rop_release_run_op(&op);
+}
+
+static double
+rop_test_throughput(int depth, int flags, int len)
+{
+    static byte d[4096 * 3], s[4096 * 3], t[4096 * 3];
+    rop_run_op op;
+    clock_t start = clock();
+    int i, n = 0;
+
+    rop_set_s_constant(&op, 0x123456);
+    rop_set_t_constant(&op, 0x654321);
+    rop_get_run_op(&op, 0xb8, depth, flags);
+    rop_set_s_bitmap(&op, s);
+    rop_set_t_bitmap(&op, t);
+    do {
+        for (i = 0; i < 1000; i++)
+            rop_run(&op, d, len);
+        n += 1000;
+    } while (clock() - start < CLOCKS_PER_SEC / 2);
+    rop_release_run_op(&op);
+    return (double)n * len * depth / 8 / ((double)(clock() - start) / CLOCKS_PER_SEC) / 1e6;
+}
+
+int main(void);
+
+int
+main(void)
+{
+    static const int depths[] = { 1, 8, 24 };
+    static const int lengths[] = { 1, 7, 15, 16, 17, 31, 33, 64, 100, 129, 300 };
+    static const int flag_sets[] = {
+        0, rop_s_constant, rop_t_constant, rop_s_constant | rop_t_constant
+    };
+    int failures = 0, tests = 0;
+    int di, rop, skind, tkind, trial, i;
+
+    for (di = 0; di < countof(depths); di++) {
+        int depth = depths[di];
+        int kinds = depth == 1 ? 2 : 3;
+
+        for (rop = 0; rop < 256; rop++)
+        for (skind = 0; skind < kinds; skind++)
+        for (tkind = 0; tkind < kinds; tkind++)
+        for (trial = 0; trial < 8; trial++) {
+            rop_test_operand s, t;
+            int len = lengths[rop_test_random() % countof(lengths)];
+            int d_offset = ROP_TEST_REGION + (rop_test_random() & 15);
+            int dpos = depth == 1 ? rop_test_random() & 7 : 0;
+
+            /* Runs of 1 bit pixels must be long enough for the SSE2 loop. */
+            if (depth == 1)
+                len = len * 8 + (rop_test_random() & 7);
+            rop_test_set_operand(&s, skind, depth, ROP_TEST_REGION * 2, d_offset);
+            rop_test_set_operand(&t, tkind, depth, ROP_TEST_REGION * 3, d_offset);
+            if (depth == 1 && (rop_test_random() & 1))
+                s.pos = t.pos = dpos;
+            for (i = 0; i < ROP_TEST_ARENA; i++)
+                rop_test_arena[0][i] = (byte)rop_test_random();
+            memcpy(rop_test_arena[1], rop_test_arena[0], ROP_TEST_ARENA);
+            rop_test_run(0, rop, depth, &s, &t, d_offset, dpos, len);
+            rop_test_run(1, rop, depth, &s, &t, d_offset, dpos, len);
+            tests++;
+            if (memcmp(rop_test_arena[0], rop_test_arena[1], ROP_TEST_ARENA)) {
+                printf("rop %02x, depth %d, S %s at %d.%d, T %s at %d.%d, D at %d.%d, len %d differs\n",
+                       rop, depth, rop_test_kind_names[skind], s.offset, s.pos,
+                       rop_test_kind_names[tkind], t.offset, t.pos, d_offset, dpos, len);
+                failures++;
+            }
+        }
+    }
+    printf("%d of %d rop run tests failed\n", failures, tests);
+
+    for (di = 0; di < countof(depths); di++)
+    for (i = 0; i < countof(flag_sets); i++) {
+        double with, without;
+
+        with = rop_test_throughput(depths[di], flag_sets[i], 4096);
+        mm_enabled = 0;
+        without = rop_test_throughput(depths[di], flag_sets[i], 4096);
+        mm_enabled = 1;
+        printf("depth %2d, S %-8s T %-8s: %7.0f MB/s, %7.0f MB/s without SSE2\n", depths[di],
+               rop_test_kind_names[flag_sets[i] & rop_s_constant ? 1 : 0],
+               rop_test_kind_names[flag_sets[i] & rop_t_constant ? 1 : 0], with, without);
+    }
+    return failures != 0;
+}
+#endif
@@ -31,9 +31,24 @@
  *                               S will be read from a pointer.
  *   T_CONST       (Optional)    If set, T will be taken to be constant, else
  *                               T will be read from a pointer.
+ *
+ * To make use of SSE here, you must also define:
+ *
+ * MM_SPECIFIC_CODE             If set, SSE can be used for the complete
+ *                              chunks in the middle of a run when S and T
+ *                              don't need skewing. Will be invoked as
+ *                              MM_SPECIFIC_CODE(OUT_PTR,D_PTR,S,T), where
+ *                              S and T are __m128i's.
+ * MM_SETUP      (Optional)     If set, will be invoked as MM_SETUP() at the
+ *                              start of the block that runs the SSE loop,
+ *                              so can declare any variables it needs.
  */
 
 #if defined(TEMPLATE_NAME)
+/* Can't do MM_SPECIFIC_CODE if we don't HAVE_SSE2 */
+#ifndef HAVE_SSE2
+#undef MM_SPECIFIC_CODE
+#endif
 
 #ifdef SPECIFIC_ROP
 #if rop3_uses_S(SPECIFIC_ROP)
@@ -114,6 +129,10 @@
 #define SAFE_FETCH_T(L,R)
 #endif /* !defined(T_USED) || defined(T_CONST) */
 
+#ifndef MM_SETUP
+#define MM_SETUP() do { } while (0 == 1)
+#endif
+
 static void TEMPLATE_NAME(rop_run_op *op, byte *d_, int len)
 {
 #ifndef SPECIFIC_CODE
@@ -293,6 +312,51 @@ static void TEMPLATE_NAME(rop_run_op *op, byte *d_, int len)
     }
     if (len > 0) {
         /* Simple middle case (complete destination chunks). */
+#if defined(MM_SPECIFIC_CODE) && (CHUNKSIZE == 8 || CHUNKSIZE == 32)
+        /* SSE version - 128 bits at a time, if S and T are aligned with D */
+        if (MM_ENABLED && len > 128
+#ifdef S_SKEW
+            && s_skew == 0 && MM_NO_OVERLAP(d, s)
+#endif /* defined(S_SKEW) */
+#ifdef T_SKEW
+            && t_skew == 0 && MM_NO_OVERLAP(d, t)
+#endif /* defined(T_SKEW) */
+            )
+        {
+#if defined(S_USED) && defined(S_CONST)
+#if CHUNKSIZE == 8
+            __m128i MM_S = _mm_set1_epi8((char)S);
+#else
+            __m128i MM_S = _mm_set1_epi32((int)S);
+#endif
+#endif /* defined(S_USED) && defined(S_CONST) */
+#if defined(T_USED) && defined(T_CONST)
+#if CHUNKSIZE == 8
+            __m128i MM_T = _mm_set1_epi8((char)T);
+#else
+            __m128i MM_T = _mm_set1_epi32((int)T);
+#endif
+#endif /* defined(T_USED) && defined(T_CONST) */
+            MM_SETUP();
+            do {
+#ifdef S_SKEW
+                __m128i MM_S = _mm_loadu_si128((const __m128i *)s);
+#endif /* defined(S_SKEW) */
+#ifdef T_SKEW
+                __m128i MM_T = _mm_loadu_si128((const __m128i *)t);
+#endif /* defined(T_SKEW) */
+                MM_SPECIFIC_CODE(((__m128i *)d), ((const __m128i *)d), MM_S, MM_T);
+#ifdef S_SKEW
+                s += 128/CHUNKSIZE;
+#endif /* defined(S_SKEW) */
+#ifdef T_SKEW
+                t += 128/CHUNKSIZE;
+#endif /* defined(T_SKEW) */
+                d += 128/CHUNKSIZE;
+                len -= 128;
+            } while (len > 128);
+        }
+#endif /* defined(MM_SPECIFIC_CODE) */
 #ifdef S_SKEW
         if (s_skew == 0) {
 #ifdef T_SKEW
@@ -366,6 +430,8 @@ static void TEMPLATE_NAME(rop_run_op *op, byte *d_, int len)
 #undef T_SKEW
 #undef TEMPLATE_NAME
 #undef ROP_PTRDIFF_T
+#undef MM_SETUP
+#undef MM_SPECIFIC_CODE
 
 #else
 int dummy;
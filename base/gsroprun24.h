@@ -39,9 +39,23 @@
  *                               being a pointer to a 1 bit bitmap to choose
  *                               between scolors[0] and [1]. If set to 1, the
  *                               code will assume that this is the case.
+ *
+ * To make use of SSE here, you must also define:
+ *
+ * MM_SPECIFIC_CODE             If set, SSE can be used. Will be invoked as
+ *                              MM_SPECIFIC_CODE(OUT_PTR,D_PTR,S,T), where
+ *                              S and T are __m128i's holding 16 bytes (not
+ *                              pixels) of S and T.
+ * MM_SETUP      (Optional)     If set, will be invoked as MM_SETUP() at the
+ *                              start of the block that runs the SSE loop,
+ *                              so can declare any variables it needs.
  */
 
 #if defined(TEMPLATE_NAME)
+/* Can't do MM_SPECIFIC_CODE if we don't HAVE_SSE2 */
+#ifndef HAVE_SSE2
+#undef MM_SPECIFIC_CODE
+#endif
 
 #ifdef SPECIFIC_ROP
 #if rop3_uses_S(SPECIFIC_ROP)
@@ -81,6 +95,27 @@
 #define FETCH_T
 #endif /* !defined(T_USED) || defined(T_CONST) */
 
+/* The SSE loop does 16 pixels as 3 lots of 16 bytes; I is which lot. */
+#if defined(S_USED) && !defined(S_CONST)
+#define MM_FETCH_S(I) do { MM_S = _mm_loadu_si128((__m128i const *)s); s += 16; } while (0==1)
+#elif defined(S_USED)
+#define MM_FETCH_S(I) do { MM_S = MM_S3[I]; } while (0==1)
+#else /* !defined(S_USED) */
+#define MM_FETCH_S(I)
+#endif /* !defined(S_USED) */
+
+#if defined(T_USED) && !defined(T_CONST)
+#define MM_FETCH_T(I) do { MM_T = _mm_loadu_si128((__m128i const *)t); t += 16; } while (0==1)
+#elif defined(T_USED)
+#define MM_FETCH_T(I) do { MM_T = MM_T3[I]; } while (0==1)
+#else /* !defined(T_USED) */
+#define MM_FETCH_T(I)
+#endif /* !defined(T_USED) */
+
+#ifndef MM_SETUP
+#define MM_SETUP() do { } while (0 == 1)
+#endif
+
 static void TEMPLATE_NAME(rop_run_op *op, byte *d, int len)
 {
 #ifndef SPECIFIC_CODE
@@ -142,6 +177,59 @@ static void TEMPLATE_NAME(rop_run_op *op, byte *d, int len)
         troll = 0;
 #endif /* T_1BIT == MAYBE */
 #endif /* defined(T_1BIT) */
+
+    /* SSE version - doesn't do 1 bit (for now at least) */
+#if defined(MM_SPECIFIC_CODE) && (!defined(S_1BIT) || S_1BIT == MAYBE) && (!defined(T_1BIT) || T_1BIT == MAYBE)
+    if (MM_ENABLED && len > 16
+#if defined(S_1BIT)
+        && sroll == 0
+#endif
+#if defined(T_1BIT)
+        && troll == 0
+#endif
+#if defined(S_USED) && !defined(S_CONST)
+        && MM_NO_OVERLAP(d, s)
+#endif
+#if defined(T_USED) && !defined(T_CONST)
+        && MM_NO_OVERLAP(d, t)
+#endif
+        )
+    {
+#if defined(S_USED) && defined(S_CONST)
+        __m128i      MM_S3[3];
+#endif
+#if defined(T_USED) && defined(T_CONST)
+        __m128i      MM_T3[3];
+#endif
+        MM_SETUP();
+#if defined(S_USED) && defined(S_CONST)
+        mm_set_pattern24(MM_S3, S);
+#endif
+#if defined(T_USED) && defined(T_CONST)
+        mm_set_pattern24(MM_T3, T);
+#endif
+        while (len > 16)
+        {
+            int i;
+
+            for (i = 0; i < 3; i++) {
+#ifdef S_USED
+                __m128i MM_S;
+#endif /* defined(S_USED) */
+#ifdef T_USED
+                __m128i MM_T;
+#endif /* defined(T_USED) */
+                MM_FETCH_S(i);
+                MM_FETCH_T(i);
+                MM_SPECIFIC_CODE(((__m128i *)d), ((const __m128i *)d), MM_S, MM_T);
+                d += 16;
+            }
+            len -= 16;
+        }
+    }
+#endif
+
+    /* Non SSE loop */
     do {
 #if defined(S_USED) && !defined(S_CONST)
         rop_operand S;
@@ -212,6 +300,10 @@ static void TEMPLATE_NAME(rop_run_op *op, byte *d, int len)
 #undef T_USED
 #undef T_CONST
 #undef TEMPLATE_NAME
+#undef MM_SETUP
+#undef MM_SPECIFIC_CODE
+#undef MM_FETCH_S
+#undef MM_FETCH_T
 
 #else
 int dummy;
@@ -43,8 +43,11 @@
  * To make use of SSE here, you must also define:
  *
  * MM_SPECIFIC_CODE             If set, SSE can be used. Will be invoked as
- *                              MM_SPECIFIC_CODE(OUT_PTR,D_PTR,S,T). Note:
- *                              SPECIFIC_ROP must be set!
+ *                              MM_SPECIFIC_CODE(OUT_PTR,D_PTR,S,T), where
+ *                              S and T are __m128i's.
+ * MM_SETUP      (Optional)     If set, will be invoked as MM_SETUP() at the
+ *                              start of the block that runs the SSE loop,
+ *                              so can declare any variables it needs.
  */
 
 #if defined(TEMPLATE_NAME)
@@ -74,7 +77,7 @@
 
 #if defined(S_USED) && !defined(S_CONST)
 #define FETCH_S      do { S = *s++; } while (0==1)
-#define MM_FETCH_S   do { S = _mm_loadu_si128((__m128i const *)s); s += 16; } while (0==1)
+#define MM_FETCH_S   do { MM_S = _mm_loadu_si128((__m128i const *)s); s += 16; } while (0==1)
 #else /* !defined(S_USED) || defined(S_CONST) */
 #define FETCH_S
 #define MM_FETCH_S
@@ -82,7 +85,7 @@
 
 #if defined(T_USED) && !defined(T_CONST)
 #define FETCH_T      do { T = *t++; } while (0 == 1)
-#define MM_FETCH_T   do { T = _mm_loadu_su128((_m128i const *)t); t += 16; } while (0 == 1)
+#define MM_FETCH_T   do { MM_T = _mm_loadu_si128((__m128i const *)t); t += 16; } while (0 == 1)
 #else /* !defined(T_USED) || defined(T_CONST) */
 #define FETCH_T
 #define MM_FETCH_T
@@ -161,63 +164,33 @@ static void TEMPLATE_NAME(rop_run_op *op, byte *d, int len)
     /* Setup all done, now go for the loops */
 
     /* SSE version - doesn't do 1 bit (for now at least) */
-#if defined(MM_SPECIFIC_CODE)
-#if defined(S_1_BIT)
-    if (sroll == 0)
+#if defined(MM_SPECIFIC_CODE) && (!defined(S_1BIT) || S_1BIT == MAYBE) && (!defined(T_1BIT) || T_1BIT == MAYBE)
+    if (MM_ENABLED && len > 16
+#if defined(S_1BIT)
+        && sroll == 0
 #endif
-#if defined(T_1_BIT)
-    if (troll == 0)
+#if defined(T_1BIT)
+        && troll == 0
 #endif
+#if defined(S_USED) && !defined(S_CONST)
+        && MM_NO_OVERLAP(d, s)
+#endif
+#if defined(T_USED) && !defined(T_CONST)
+        && MM_NO_OVERLAP(d, t)
+#endif
+        )
     {
-#ifdef MM_SETUP
         MM_SETUP();
-#endif
         while (len > 16)
         {
 #if defined(S_USED) && !defined(S_CONST)
-            __mm128i MM_S;
+            __m128i MM_S;
 #endif /* defined(S_USED) && !defined(S_CONST) */
 #if defined(T_USED) && !defined(T_CONST)
-            __mm128i MM_T;
+            __m128i MM_T;
 #endif /* defined(T_USED) && !defined(T_CONST) */
-#if defined(S_1BIT) && S_1BIT == MAYBE
-            if (sroll == 0) {
-#endif /* defined(S_1BIT) && S_1BIT == MAYBE */
-#if !defined(S_1BIT) || S_1BIT == MAYBE
-                MM_FETCH_S;
-#endif /* !defined(S_1BIT) || S_1BIT == MAYBE */
-#if defined(S_1BIT) && S_1BIT == MAYBE
-            } else
-#endif /* defined(S_1BIT) && S_1BIT == MAYBE */
-            {
-#ifdef S_1BIT
-                --sroll;
-                S = scolors[(*s >> sroll) & 1];
-                if (sroll == 0) {
-                    sroll = 8;
-                    s++;
-                }
-#endif /* S_1BIT */
-            }
-#if defined(T_1BIT) && T_1BIT == MAYBE
-            if (troll == 0) {
-#endif /* defined(T_1BIT) && T_1BIT == MAYBE */
-#if !defined(T_1BIT) || T_1BIT == MAYBE
-                MM_FETCH_T;
-#endif /* defined(T_1BIT) && T_1BIT == MAYBE */
-#if defined(T_1BIT) && T_1BIT == MAYBE
-            } else
-#endif /* defined(T_1BIT) && T_1BIT == MAYBE */
-            {
-#ifdef T_1BIT
-                --troll;
-                T = tcolors[(*t >> troll) & 1];
-                if (troll == 0) {
-                    troll = 8;
-                    t++;
-                }
-#endif /* T_1BIT */
-            }
+            MM_FETCH_S;
+            MM_FETCH_T;
             MM_SPECIFIC_CODE(((__m128i *)d), ((const __m128i *)d), MM_S, MM_T);
             d += 16;
             len -= 16;
@@ -29,6 +29,9 @@
 #ifdef WITH_CAL
 #include "cal.h"
 #endif
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+#endif
 
 typedef int art_s32;
 
@@ -2867,6 +2870,184 @@ typedef void (*art_pdf_compose_group_fn)(byte *tos_ptr, bool tos_isolated, int t
                                          gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
                                          const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev);
 
+#ifdef HAVE_SSE2
+/* SSE2 versions of the commonest group compositing cases. These work on
+ * 4 pixels at a time, one pixel per 32 bit lane, and give exactly the
+ * same results as art_pdf_composite_group_8 followed by
+ * art_pdf_composite_pixel_alpha_8_inline. */
+
+/* Load 4 bytes into the 4 lanes */
+static forceinline __m128i
+sse2_load4_u8(const byte *p)
+{
+    __m128i zero = _mm_setzero_si128();
+    int v;
+
+    memcpy(&v, p, 4);
+    return _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(v), zero), zero);
+}
+
+/* Store 4 lanes (each 0 to 255) as bytes */
+static forceinline void
+sse2_store4_u8(byte *p, __m128i x)
+{
+    int v;
+
+    x = _mm_packs_epi32(x, x);
+    v = _mm_cvtsi128_si32(_mm_packus_epi16(x, x));
+    memcpy(p, &v, 4);
+}
+
+/* Low 32 bits of a 32x32 multiply (SSE2 lacks pmulld) */
+static forceinline __m128i
+sse2_mullo_epi32(__m128i a, __m128i b)
+{
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/* a * b / 255 with the rounding used throughout this file, a, b in 0..255 */
+static forceinline __m128i
+sse2_mul_8(__m128i a, __m128i b)
+{
+    __m128i t = _mm_add_epi32(_mm_mullo_epi16(a, b), _mm_set1_epi32(0x80));
+
+    return _mm_srli_epi32(_mm_add_epi32(t, _mm_srli_epi32(t, 8)), 8);
+}
+
+/* n / d rounded down, for 0 <= n < 2^24 and 0 < d < 256. The float
+ * quotient is at most 1 out, which the remainder check corrects. */
+static forceinline __m128i
+sse2_div_u24(__m128i n, __m128i d)
+{
+    __m128i q = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(n), _mm_cvtepi32_ps(d)));
+    __m128i r = _mm_sub_epi32(n, sse2_mullo_epi32(q, d));
+
+    q = _mm_add_epi32(q, _mm_cmplt_epi32(r, _mm_setzero_si128()));
+    return _mm_sub_epi32(q, _mm_cmpgt_epi32(r, _mm_sub_epi32(d, _mm_set1_epi32(1))));
+}
+
+/* Composite the isolated group rows in tos onto nos with no soft mask,
+ * for the Normal, Multiply and Screen blend modes, updating the nos group
+ * alpha if there is one. Only whole groups of 4 pixels are done; returns
+ * the number of columns done. */
+static int
+compose_group_isolated_nomask_sse2(byte *gs_restrict tos_ptr, int tos_planestride, int tos_rowstride,
+                                   byte *gs_restrict nos_ptr, int nos_planestride, int nos_rowstride,
+                                   byte *gs_restrict nos_alpha_g_ptr, byte alpha, gs_blend_mode_t blend_mode, bool additive,
+                                   int n_chan, int width, int height)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i v255 = _mm_set1_epi32(0xff);
+    const __m128i round8 = _mm_set1_epi32(0x80);
+    const __m128i round16 = _mm_set1_epi32(0x8000);
+    const __m128i valpha = _mm_set1_epi32(alpha);
+    bool blend = blend_mode != BLEND_MODE_Normal;
+    int done = width & ~3;
+    int x, y, i;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < done; x += 4) {
+            __m128i a_s, a_b, a_r, skip, scale;
+
+            a_s = sse2_mul_8(sse2_load4_u8(tos_ptr + n_chan * tos_planestride + x), valpha);
+            skip = _mm_cmpeq_epi32(a_s, zero);
+            if (_mm_movemask_epi8(skip) == 0xffff)
+                continue;
+            a_b = sse2_load4_u8(nos_ptr + n_chan * nos_planestride + x);
+            /* Result alpha is Union of backdrop and source alpha */
+            a_r = _mm_sub_epi32(v255, sse2_mul_8(_mm_sub_epi32(v255, a_b), _mm_sub_epi32(v255, a_s)));
+            /* a_s / a_r in 16.16 format. Where a_b is 0 this is 1.0, so the
+               source is copied without any special casing. Lanes to skip
+               may have a_r of 0, so keep the divisor non zero. */
+            scale = sse2_div_u24(_mm_add_epi32(_mm_slli_epi32(a_s, 16), _mm_srli_epi32(a_r, 1)),
+                                 _mm_max_epi16(a_r, _mm_set1_epi32(1)));
+            for (i = 0; i < n_chan; i++) {
+                __m128i c_s = sse2_load4_u8(tos_ptr + i * tos_planestride + x);
+                __m128i nos = sse2_load4_u8(nos_ptr + i * nos_planestride + x);
+                __m128i c_b = nos;
+                __m128i tmp;
+
+                if (!additive) {
+                    c_s = _mm_sub_epi32(v255, c_s);
+                    c_b = _mm_sub_epi32(v255, c_b);
+                }
+                if (blend) {
+                    __m128i c_bl;
+
+                    if (blend_mode == BLEND_MODE_Multiply)
+                        c_bl = sse2_mul_8(c_b, c_s);
+                    else
+                        c_bl = _mm_sub_epi32(v255, sse2_mul_8(_mm_sub_epi32(v255, c_b),
+                                                              _mm_sub_epi32(v255, c_s)));
+                    /* Mix the blend result with the source color */
+                    tmp = _mm_add_epi32(sse2_mullo_epi32(a_b, _mm_sub_epi32(c_bl, c_s)), round8);
+                    c_s = _mm_add_epi32(c_s, _mm_srai_epi32(_mm_add_epi32(_mm_srai_epi32(tmp, 8), tmp), 8));
+                }
+                tmp = _mm_add_epi32(_mm_slli_epi32(c_b, 16),
+                                    sse2_mullo_epi32(scale, _mm_sub_epi32(c_s, c_b)));
+                tmp = _mm_srai_epi32(_mm_add_epi32(tmp, round16), 16);
+                if (!additive)
+                    tmp = _mm_sub_epi32(v255, tmp);
+                tmp = _mm_or_si128(_mm_and_si128(skip, nos), _mm_andnot_si128(skip, tmp));
+                sse2_store4_u8(nos_ptr + i * nos_planestride + x, tmp);
+            }
+            a_r = _mm_or_si128(_mm_and_si128(skip, a_b), _mm_andnot_si128(skip, a_r));
+            sse2_store4_u8(nos_ptr + n_chan * nos_planestride + x, a_r);
+            if (nos_alpha_g_ptr != NULL) {
+                /* Unchanged where a_s is 0 */
+                __m128i a_g = sse2_load4_u8(nos_alpha_g_ptr + x);
+
+                a_g = _mm_sub_epi32(v255, sse2_mul_8(_mm_sub_epi32(v255, a_g), _mm_sub_epi32(v255, a_s)));
+                sse2_store4_u8(nos_alpha_g_ptr + x, a_g);
+            }
+        }
+        tos_ptr += tos_rowstride;
+        nos_ptr += nos_rowstride;
+        if (nos_alpha_g_ptr != NULL)
+            nos_alpha_g_ptr += nos_rowstride;
+    }
+    return done;
+}
+
+/* Non-isolated group with Normal blending, no soft mask and alpha 255:
+ * uncompositing and recompositing cancel out, so the group pixels (color
+ * and alpha) replace the backdrop wherever the group alpha is non zero.
+ * Returns the number of columns done. */
+static int
+compose_group_nonisolated_nomask_sse2(byte *gs_restrict tos_ptr, int tos_planestride, int tos_rowstride,
+                                      int tos_alpha_g_offset,
+                                      byte *gs_restrict nos_ptr, int nos_planestride, int nos_rowstride,
+                                      int n_chan, int width, int height)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int done = width & ~15;
+    int x, y, i;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < done; x += 16) {
+            __m128i keep = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(tos_ptr + tos_alpha_g_offset + x)), zero);
+
+            if (_mm_movemask_epi8(keep) == 0xffff)
+                continue;
+            for (i = 0; i <= n_chan; i++) {
+                __m128i *nos = (__m128i *)(nos_ptr + i * nos_planestride + x);
+                __m128i tos = _mm_loadu_si128((const __m128i *)(tos_ptr + i * tos_planestride + x));
+
+                _mm_storeu_si128(nos, _mm_or_si128(_mm_and_si128(keep, _mm_loadu_si128(nos)),
+                                                   _mm_andnot_si128(keep, tos)));
+            }
+        }
+        tos_ptr += tos_rowstride;
+        nos_ptr += nos_rowstride;
+    }
+    return done;
+}
+#endif
+
 static forceinline void
 template_compose_group(byte *gs_restrict tos_ptr, bool tos_isolated,
                        int tos_planestride, int tos_rowstride,
@@ -3140,6 +3321,33 @@ compose_group_nonknockout_blend(byte *tos_ptr, bool tos_isolated, int tos_planes
         backdrop_ptr, has_matte, n_chan, additive, num_spots, overprint, drawn_comps, x0, y0, x1, y1, pblend_procs, pdev, 1);
 }
 
+#ifdef HAVE_SSE2
+static void
+compose_group_nonknockout_isolated_nomask_sse2(byte *tos_ptr, bool tos_isolated, int tos_planestride, int tos_rowstride, byte alpha, byte shape, gs_blend_mode_t blend_mode, bool tos_has_shape,
+              int tos_shape_offset, int tos_alpha_g_offset, int tos_tag_offset, bool tos_has_tag, byte *tos_alpha_g_ptr,
+              byte *nos_ptr, bool nos_isolated, int nos_planestride, int nos_rowstride, byte *nos_alpha_g_ptr, bool nos_knockout,
+              int nos_shape_offset, int nos_tag_offset,
+              byte *mask_row_ptr, int has_mask, pdf14_buf *maskbuf, byte mask_bg_alpha, const byte *mask_tr_fn,
+              byte *backdrop_ptr,
+              bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
+              const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
+{
+    int done = compose_group_isolated_nomask_sse2(tos_ptr, tos_planestride, tos_rowstride,
+                                                  nos_ptr, nos_planestride, nos_rowstride,
+                                                  nos_alpha_g_ptr, alpha, blend_mode, additive,
+                                                  n_chan, x1 - x0, y1 - y0);
+
+    if (done == x1 - x0)
+        return;
+    template_compose_group(tos_ptr + done, /*tos_isolated*/1, tos_planestride, tos_rowstride, alpha, shape, blend_mode, /*tos_has_shape*/0,
+        tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, /*tos_has_tag*/0, /*tos_alpha_g_ptr*/0,
+        nos_ptr + done, nos_isolated, nos_planestride, nos_rowstride,
+        nos_alpha_g_ptr == NULL ? NULL : nos_alpha_g_ptr + done, /* nos_knockout = */0,
+        /*nos_shape_offset*/0, /*nos_tag_offset*/0, /*mask_row_ptr*/NULL, /*has_mask*/0, /*maskbuf*/NULL, mask_bg_alpha, mask_tr_fn,
+        /*backdrop_ptr*/NULL, /*has_matte*/0, n_chan, additive, /*num_spots*/0, overprint, drawn_comps, x0 + done, y0, x1, y1, pblend_procs, pdev, 1);
+}
+#endif
+
 static void
 compose_group_nonknockout_nonblend_isolated_allmask_common(byte *tos_ptr, bool tos_isolated, int tos_planestride, int tos_rowstride, byte alpha, byte shape, gs_blend_mode_t blend_mode, bool tos_has_shape,
               int tos_shape_offset, int tos_alpha_g_offset, int tos_tag_offset, bool tos_has_tag, byte *tos_alpha_g_ptr,
@@ -3305,6 +3513,18 @@ compose_group_nonknockout_nonblend_isolated_nomask_common(byte *tos_ptr, bool to
               bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
               const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
 {
+#ifdef HAVE_SSE2
+    int done = compose_group_isolated_nomask_sse2(tos_ptr, tos_planestride, tos_rowstride,
+                                                  nos_ptr, nos_planestride, nos_rowstride,
+                                                  NULL, alpha, BLEND_MODE_Normal, /*additive*/1,
+                                                  n_chan, x1 - x0, y1 - y0);
+
+    if (done == x1 - x0)
+        return;
+    tos_ptr += done;
+    nos_ptr += done;
+    x0 += done;
+#endif
     template_compose_group(tos_ptr, /*tos_isolated*/1, tos_planestride, tos_rowstride, alpha, shape, BLEND_MODE_Normal, /*tos_has_shape*/0,
         tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, /*tos_has_tag*/0, /*tos_alpha_g_ptr*/0,
         nos_ptr, /*nos_isolated*/0, nos_planestride, nos_rowstride, /*nos_alpha_g_ptr*/0, /* nos_knockout = */0,
@@ -3339,6 +3559,20 @@ compose_group_nonknockout_nonblend_nonisolated_nomask_common(byte *tos_ptr, bool
               bool has_matte, int n_chan, bool additive, int num_spots, bool overprint, gx_color_index drawn_comps, int x0, int y0, int x1, int y1,
               const pdf14_nonseparable_blending_procs_t *pblend_procs, pdf14_device *pdev)
 {
+#ifdef HAVE_SSE2
+    if (alpha == 255) {
+        int done = compose_group_nonisolated_nomask_sse2(tos_ptr, tos_planestride, tos_rowstride,
+                                                         tos_alpha_g_offset,
+                                                         nos_ptr, nos_planestride, nos_rowstride,
+                                                         n_chan, x1 - x0, y1 - y0);
+
+        if (done == x1 - x0)
+            return;
+        tos_ptr += done;
+        nos_ptr += done;
+        x0 += done;
+    }
+#endif
     template_compose_group(tos_ptr, /*tos_isolated*/0, tos_planestride, tos_rowstride, alpha, shape, BLEND_MODE_Normal, /*tos_has_shape*/0,
         tos_shape_offset, tos_alpha_g_offset, tos_tag_offset, /*tos_has_tag*/0, /*tos_alpha_g_ptr*/0,
         nos_ptr, /*nos_isolated*/0, nos_planestride, nos_rowstride, /*nos_alpha_g_ptr*/0, /* nos_knockout = */0,
@@ -3543,6 +3777,16 @@ do_compose_group(pdf14_buf *tos, pdf14_buf *nos, pdf14_buf *maskbuf,
      * files/devices hit the different options. */
     if (nos_knockout)
         fn = &compose_group_knockout; /* Small %ages, nothing more than 1.1% */
+#ifdef HAVE_SSE2
+    else if ((blend_mode == BLEND_MODE_Normal || blend_mode == BLEND_MODE_Multiply ||
+              blend_mode == BLEND_MODE_Screen) &&
+             tos_isolated && maskbuf == NULL && tos->has_shape == 0 && tos_has_tag == 0 &&
+             nos_shape_offset == 0 && nos_tag_offset == 0 && backdrop_ptr == NULL &&
+             has_matte == 0 && num_spots == 0 && overprint == 0 && tos_alpha_g_ptr == NULL &&
+             (blend_mode != BLEND_MODE_Normal || nos_alpha_g_ptr != NULL))
+        /* Isolated groups in non isolated ones, which the Normal case below doesn't catch */
+        fn = &compose_group_nonknockout_isolated_nomask_sse2;
+#endif
     else if (blend_mode != 0)
         fn = &compose_group_nonknockout_blend; /* Small %ages, nothing more than 2% */
     else if (tos->has_shape == 0 && tos_has_tag == 0 && nos_isolated == 0 && nos_alpha_g_ptr == NULL &&
@@ -5942,3 +6186,160 @@ dump_track_compose_groups(void)
     }
 }
 #endif
+
+#if defined(UNIT_TEST) && defined(HAVE_SSE2)
+
+/*
+ * Checks that the SSE2 group compositing gives exactly the same results as
+ * template_compose_group, on random rows covering every blend mode, alpha
+ * and channel count the SSE2 code takes, with widths that leave a scalar
+ * tail. Build it against the objects of a normal gs build, compiling this
+ * file with the usual flags plus -DUNIT_TEST and linking it with the objects
+ * listed in obj/ldt.tr other than gs.o and gxblend.o, for instance:
+ *
+ *   gcc <CFLAGS> -DUNIT_TEST -c base/gxblend.c -o obj/gxblend_test.o
+ *   gcc -o gxblend_test obj/gxblend_test.o $(tr -d '\\' < obj/ldt.tr | tr ' ' '\n' |
+ *       grep -v -x -e gcc -e -o -e ./bin/gs -e ./obj/gs.o -e ./obj/gxblend.o)
+ *
+ * It exits non zero on any difference.
+ */
+
+#undef printf
+
+static ulong blend_test_seed = 1;
+
+static byte
+blend_test_random(void)
+{
+    blend_test_seed = blend_test_seed * 1103515245 + 12345;
+    return (byte)(blend_test_seed >> 16);
+}
+
+/* Mostly random values, with plenty of the 0 and 255 edge cases. */
+static void
+blend_test_fill(byte *p, int n)
+{
+    while (n-- > 0) {
+        byte r = blend_test_random();
+
+        *p++ = (r < 32 ? 0 : r > 223 ? 255 : blend_test_random());
+    }
+}
+
+#define BLEND_TEST_HEIGHT 3
+#define BLEND_TEST_ROWSTRIDE 48
+#define BLEND_TEST_PLANESTRIDE (BLEND_TEST_ROWSTRIDE * BLEND_TEST_HEIGHT)
+#define BLEND_TEST_SIZE (BLEND_TEST_PLANESTRIDE * (PDF14_MAX_PLANES + 1))
+
+static pdf14_device blend_test_device;
+static byte blend_test_tos[BLEND_TEST_SIZE];
+static byte blend_test_nos[2][BLEND_TEST_SIZE];
+static byte blend_test_alpha_g[2][BLEND_TEST_PLANESTRIDE];
+
+static int
+blend_test_compare(const char *what, int n_chan, bool additive,
+                   gs_blend_mode_t blend_mode, byte alpha, int width, bool has_alpha_g)
+{
+    if (!memcmp(blend_test_nos[0], blend_test_nos[1], BLEND_TEST_SIZE) &&
+        !memcmp(blend_test_alpha_g[0], blend_test_alpha_g[1], BLEND_TEST_PLANESTRIDE))
+        return 0;
+    printf("%s: n_chan %d, %s, blend mode %d, alpha %d, width %d%s differs\n",
+           what, n_chan, additive ? "additive" : "subtractive", blend_mode,
+           alpha, width, has_alpha_g ? ", with nos alpha_g" : "");
+    return 1;
+}
+
+int main(void);
+
+int
+main(void)
+{
+    static const byte alphas[] = { 0, 1, 77, 127, 128, 200, 254, 255 };
+    static const gs_blend_mode_t modes[] = {
+        BLEND_MODE_Normal, BLEND_MODE_Multiply, BLEND_MODE_Screen
+    };
+    int n_chan, additive, mode, a, has_alpha_g, width, pass;
+    int failures = 0, tests = 0;
+
+    blend_test_device.shape = 1.0;
+    for (pass = 0; pass < 20; pass++)
+    for (n_chan = 1; n_chan <= 4; n_chan++)
+    for (additive = 0; additive <= 1; additive++)
+    for (width = 1; width <= 37; width += 3) {
+        int x1 = width, y1 = BLEND_TEST_HEIGHT;
+
+        for (mode = 0; mode < countof(modes); mode++)
+        for (a = 0; a <= countof(alphas); a++)
+        for (has_alpha_g = 0; has_alpha_g <= 1; has_alpha_g++) {
+            byte alpha = a < countof(alphas) ? alphas[a] : blend_test_random();
+            byte *alpha_g[2];
+
+            blend_test_fill(blend_test_tos, BLEND_TEST_SIZE);
+            blend_test_fill(blend_test_nos[0], BLEND_TEST_SIZE);
+            blend_test_fill(blend_test_alpha_g[0], BLEND_TEST_PLANESTRIDE);
+            memcpy(blend_test_nos[1], blend_test_nos[0], BLEND_TEST_SIZE);
+            memcpy(blend_test_alpha_g[1], blend_test_alpha_g[0], BLEND_TEST_PLANESTRIDE);
+            alpha_g[0] = has_alpha_g ? blend_test_alpha_g[0] : NULL;
+            alpha_g[1] = has_alpha_g ? blend_test_alpha_g[1] : NULL;
+
+            template_compose_group(blend_test_tos, 1, BLEND_TEST_PLANESTRIDE, BLEND_TEST_ROWSTRIDE,
+                alpha, 255, modes[mode], 0, 0, 0, 0, 0, NULL,
+                blend_test_nos[0], has_alpha_g, BLEND_TEST_PLANESTRIDE, BLEND_TEST_ROWSTRIDE,
+                alpha_g[0], 0, 0, 0, NULL, 0, NULL, 0, NULL, NULL, 0, n_chan, additive,
+                0, 0, 0, 0, 0, x1, y1, NULL, &blend_test_device, 1);
+            compose_group_nonknockout_isolated_nomask_sse2(blend_test_tos, 1, BLEND_TEST_PLANESTRIDE,
+                BLEND_TEST_ROWSTRIDE, alpha, 255, modes[mode], 0, 0, 0, 0, 0, NULL,
+                blend_test_nos[1], has_alpha_g, BLEND_TEST_PLANESTRIDE, BLEND_TEST_ROWSTRIDE,
+                alpha_g[1], 0, 0, 0, NULL, 0, NULL, 0, NULL, NULL, 0, n_chan, additive,
+                0, 0, 0, 0, 0, x1, y1, NULL, &blend_test_device);
+            failures += blend_test_compare("isolated", n_chan, additive, modes[mode],
+                                           alpha, width, has_alpha_g);
+            tests++;
+        }
+
+        /* The Normal blend mode cases reached without a nos alpha_g */
+        for (a = 0; a <= countof(alphas); a++) {
+            byte alpha = a < countof(alphas) ? alphas[a] : blend_test_random();
+            int tos_alpha_g_offset = (n_chan + 1) * BLEND_TEST_PLANESTRIDE;
+
+            blend_test_fill(blend_test_tos, BLEND_TEST_SIZE);
+            blend_test_fill(blend_test_nos[0], BLEND_TEST_SIZE);
+            memcpy(blend_test_nos[1], blend_test_nos[0], BLEND_TEST_SIZE);
+            memset(blend_test_alpha_g[1], 0, BLEND_TEST_PLANESTRIDE);
+            memset(blend_test_alpha_g[0], 0, BLEND_TEST_PLANESTRIDE);
+
+            template_compose_group(blend_test_tos, 1, BLEND_TEST_PLANESTRIDE, BLEND_TEST_ROWSTRIDE,
+                alpha, 255, BLEND_MODE_Normal, 0, 0, 0, 0, 0, NULL,
+                blend_test_nos[0], 0, BLEND_TEST_PLANESTRIDE, BLEND_TEST_ROWSTRIDE,
+                NULL, 0, 0, 0, NULL, 0, NULL, 0, NULL, NULL, 0, n_chan, 1,
+                0, 0, 0, 0, 0, x1, y1, NULL, &blend_test_device, 1);
+            compose_group_nonknockout_nonblend_isolated_nomask_common(blend_test_tos, 1,
+                BLEND_TEST_PLANESTRIDE, BLEND_TEST_ROWSTRIDE, alpha, 255, BLEND_MODE_Normal,
+                0, 0, 0, 0, 0, NULL, blend_test_nos[1], 0, BLEND_TEST_PLANESTRIDE,
+                BLEND_TEST_ROWSTRIDE, NULL, 0, 0, 0, NULL, 0, NULL, 0, NULL, NULL, 0,
+                n_chan, 1, 0, 0, 0, 0, 0, x1, y1, NULL, &blend_test_device);
+            failures += blend_test_compare("isolated Normal", n_chan, 1, BLEND_MODE_Normal,
+                                           alpha, width, 0);
+
+            blend_test_fill(blend_test_nos[0], BLEND_TEST_SIZE);
+            memcpy(blend_test_nos[1], blend_test_nos[0], BLEND_TEST_SIZE);
+
+            template_compose_group(blend_test_tos, 0, BLEND_TEST_PLANESTRIDE, BLEND_TEST_ROWSTRIDE,
+                alpha, 255, BLEND_MODE_Normal, 0, 0, tos_alpha_g_offset, 0, 0, NULL,
+                blend_test_nos[0], 0, BLEND_TEST_PLANESTRIDE, BLEND_TEST_ROWSTRIDE,
+                NULL, 0, 0, 0, NULL, 0, NULL, 0, NULL, NULL, 0, n_chan, 1,
+                0, 0, 0, 0, 0, x1, y1, NULL, &blend_test_device, 1);
+            compose_group_nonknockout_nonblend_nonisolated_nomask_common(blend_test_tos, 0,
+                BLEND_TEST_PLANESTRIDE, BLEND_TEST_ROWSTRIDE, alpha, 255, BLEND_MODE_Normal,
+                0, 0, tos_alpha_g_offset, 0, 0, NULL, blend_test_nos[1], 0,
+                BLEND_TEST_PLANESTRIDE, BLEND_TEST_ROWSTRIDE, NULL, 0, 0, 0, NULL, 0, NULL,
+                0, NULL, NULL, 0, n_chan, 1, 0, 0, 0, 0, 0, x1, y1, NULL, &blend_test_device);
+            failures += blend_test_compare("non isolated Normal", n_chan, 1, BLEND_MODE_Normal,
+                                           alpha, width, 0);
+            tests += 2;
+        }
+    }
+    printf("%d of %d group compositing tests failed\n", failures, tests);
+    return failures != 0;
+}
+#endif
@@ -31,6 +31,7 @@
 #include "gxchar.h"
 #include "gxfont.h"
 #include "gxfcache.h"
+#include "gxccshr.h"
 #include "gxxfont.h"
 #include "gximask.h"
 #include "gscspace.h"		/* for gsimage.h */
@@ -109,7 +110,8 @@ gx_lookup_fm_pair(gs_font * pfont, const gs_matrix *char_tm,
                 continue;
         } else {
             if (!uid_equal(&pair->UID, &uid) ||
-                pair->FontType != pfont->FontType
+                pair->FontType != pfont->FontType ||
+                pair->content_XUID != pfont->content_XUID
                 )
                 continue;
         }
@@ -120,6 +122,8 @@ gx_lookup_fm_pair(gs_font * pfont, const gs_matrix *char_tm,
 
             if (pair->font == 0) {
                 pair->font = pfont;
+                /* Make sure freeing pfont unlinks it from the pair again. */
+                pfont->is_cached = true;
                 if_debug2m('k', pfont->memory, "[k]updating pair "PRI_INTPTR" with font "PRI_INTPTR"\n",
                            (intptr_t)pair, (intptr_t)pfont);
             } else {
@@ -166,7 +170,9 @@ gx_lookup_cached_char(const gs_font * pfont, const cached_fm_pair * pair,
     }
     if_debug3m('K', pfont->memory, "[K]not found: glyph=0x%lx, wmode=%d, depth=%d\n",
               (ulong) glyph, wmode, depth);
-    return 0;
+    /* Another instance may have rendered it already. */
+    return gx_lookup_shared_cached_char(pfont, pair, glyph, wmode, depth,
+                                        subpix_origin);
 }
 
 /* Copy a cached character to the screen. */
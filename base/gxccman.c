@@ -31,6 +31,7 @@
 #include "gxchar.h"
 #include "gxfont.h"
 #include "gxfcache.h"
+#include "gxccshr.h"
 #include "gxxfont.h"
 #include "gxttfb.h"
 #include "gxfont42.h"
@@ -340,6 +341,9 @@ gx_add_fm_pair(register gs_font_dir * dir, gs_font * font, const gs_uid * puid,
         uid_set_invalid(&pair->UID);
         return code;
     }
+    pair->content_XUID = font->content_XUID;
+    if (fm_pair_has_content_XUID(pair))
+        gx_shared_char_cache_add_font(dir->memory, pair);
     pair->FontType = font->FontType;
     pair->hash = (uint) (dir->hash % 549);	/* scramble bits */
     dir->hash += 371;
@@ -611,6 +615,40 @@ gx_alloc_char_bits(gs_font_dir * dir, gx_device_memory * dev,
     return 0;
 }
 
+/*
+ * Allocate a cache entry for a character that has already been rendered,
+ * such as one found in the shared cache (see gxccshr.c).  The caller
+ * copies in the bits and the rest of the entry, and then links it with
+ * gx_add_cached_char passing a NULL device.
+ */
+int
+gx_alloc_cached_char(gs_font_dir * dir, ushort width, ushort height,
+                     uint raster, int depth, cached_char **pcc)
+{
+    cached_char *cc;
+    int code;
+
+    *pcc = 0;
+    if (raster != 0 && height > dir->ccache.upper / raster)
+        return 0;		/* too big */
+    code = alloc_char(dir, (ulong)raster * height + sizeof_cached_char, &cc);
+    if (code < 0 || cc == 0)
+        return code;
+
+    cc_set_depth(cc, depth);
+    cc->xglyph = gx_no_xglyph;
+    cc->width = width;
+    cc->height = height;
+    cc->shift = 0;
+    cc_set_raster(cc, raster);
+    cc_set_pair_only(cc, 0);	/* not linked in yet */
+    cc->id = gs_next_ids(dir->memory, 1);
+    cc->subpix_origin.x = cc->subpix_origin.y = 0;
+    cc->linked = false;
+    *pcc = cc;
+    return 0;
+}
+
 /* Open the cache device. */
 void
 gx_open_cache_device(gx_device_memory * dev, cached_char * cc)
@@ -647,7 +685,7 @@ int
 gx_add_cached_char(gs_font_dir * dir, gx_device_memory * dev,
 cached_char * cc, cached_fm_pair * pair, const gs_log2_scale_point * pscale)
 {
-    if_debug5m('k', dev->memory,
+    if_debug5m('k', dir->memory,
                "[k]chaining char "PRI_INTPTR": pair="PRI_INTPTR", glyph=0x%lx, wmode=%d, depth=%d\n",
                (intptr_t)cc, (intptr_t)pair, (ulong)cc->code,
                cc->wmode, cc_depth(cc));
@@ -687,6 +725,9 @@ cached_char * cc, cached_fm_pair * pair, const gs_log2_scale_point * pscale)
         cc_set_pair(cc, pair);
         pair->num_chars++;
     }
+    /* Let other instances have what we have just rendered. */
+    if (dev != NULL && cc_has_bits(cc))
+        gx_add_shared_cached_char(dir, pair, cc);
     return 0;
 }
 
@@ -0,0 +1,924 @@
+/* Copyright (C) 2001-2026 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Character cache shared between instances */
+#include "memory_.h"
+#include "stdio_.h"
+#include "string_.h"
+#include "gx.h"
+#include "gp.h"
+#include "gserrors.h"
+#include "gsstruct.h"
+#include "gslibctx.h"
+#include "gssprintf.h"
+#include "gxsync.h"
+#include "gsmd5.h"
+#include "gxfixed.h"
+#include "gxfont.h"
+#include "gxfcache.h"
+#include "gxchar.h"
+#include "gxccshr.h"
+
+/* Both must be powers of 2. */
+#define SHARED_CHAR_STRIPES 16
+#define SHARED_CHAR_BUCKETS 1024
+
+/* The budget used when only a directory is given. */
+#define SHARED_CHAR_DEFAULT_SIZE (8 * 1024 * 1024)
+
+/* The most fonts whose files one process reads; must be a power of 2. */
+#define SHARED_CHAR_MAX_FILES 256
+#define SHARED_CHAR_FILE_BUCKETS 64
+
+/* How many bytes of new entries a file collects before being written. */
+#define SHARED_CHAR_FILE_PENDING (64 * 1024)
+
+/*
+ * The key is compared and hashed as raw bytes, so it is always cleared
+ * before being filled in.
+ */
+typedef struct shared_char_key_s {
+    long digest[4];		/* d0..d3 of the content XUID */
+    int FontType;
+    float mxx, mxy, myx, myy;
+    int design_grid;
+    int align_to_pixels;
+    uint grid_fit_tt;
+    gs_glyph glyph;		/* GS_NO_GLYPH for a named glyph */
+    uint name_size;
+    int wmode;
+    int depth;
+    fixed subpix_x, subpix_y;
+} shared_char_key;
+
+typedef struct shared_char_s shared_char;
+struct shared_char_s {
+    shared_char *next;		/* hash chain */
+    shared_char *prev_used, *next_used;	/* most recently used first */
+    uint hash;
+    size_t size;		/* of the whole entry */
+    shared_char_key key;
+    ushort width, height;
+    uint raster;
+    gs_fixed_point wxy;
+    gs_fixed_point offset;
+    /* The glyph name (if any) and then the bits follow. */
+};
+
+#define shared_char_name(sc) ((byte *)((sc) + 1))
+#define shared_char_bits(sc) (shared_char_name(sc) + (sc)->key.name_size)
+
+typedef struct shared_char_stripe_s {
+    gx_monitor_t *lock;
+    shared_char *table[SHARED_CHAR_BUCKETS];
+    shared_char *first_used, *last_used;
+    size_t used;
+    size_t max_used;		/* this stripe's share of max_bytes */
+} shared_char_stripe;
+
+/* The file of a font. */
+typedef struct shared_char_file_s shared_char_file;
+struct shared_char_file_s {
+    shared_char_file *next;	/* hash chain */
+    long digest[4];
+    shared_char *pending;	/* copies of entries not written yet */
+    size_t pending_size;
+    bool damaged;		/* write it again even with nothing pending */
+};
+
+struct gx_shared_char_cache_s {
+    gs_memory_t *memory;	/* thread safe */
+    size_t max_bytes;		/* protected by the core's monitor */
+    shared_char_stripe stripes[SHARED_CHAR_STRIPES];
+    /* The following are only used when the cache is kept on disk. */
+    gx_monitor_t *file_lock;	/* protects the following */
+    char *file_dir;		/* 0 if not */
+    uint num_files;
+    shared_char_file *files[SHARED_CHAR_FILE_BUCKETS];
+    uint temp_count;		/* for naming files being written */
+};
+
+/*
+ * A cache file is a header followed by records, each immediately
+ * followed by size bytes of glyph name and bits. The check is an MD5
+ * digest of the record from the key on, and of the bytes following it.
+ * Records are written in native byte order; a file from a machine with
+ * a different byte order or key layout fails the header test. (Its name
+ * doesn't: the digests in content XUIDs are computed the same way on
+ * every host, so such a file is simply replaced when next written.)
+ */
+#define SHARED_CHAR_FILE_MAGIC 0x47534743	/* "GSGC" */
+#define SHARED_CHAR_FILE_VERSION 2
+
+typedef struct shared_char_file_header_s {
+    uint magic;
+    uint version;
+    uint key_size;
+    uint record_size;
+} shared_char_file_header;
+
+typedef struct shared_char_record_s {
+    uint size;
+    byte check[16];
+    shared_char_key key;
+    ushort width, height;
+    uint raster;
+    gs_fixed_point wxy;
+    gs_fixed_point offset;
+} shared_char_record;
+
+#define shared_char_record_check_start(rec) ((const byte *)&(rec)->key)
+#define shared_char_record_check_size\
+  (sizeof(shared_char_record) - offset_of(shared_char_record, key))
+
+/* Define a scale factor of 1. */
+static const gs_log2_scale_point scale_log2_1 =
+{0, 0};
+
+/*
+ * Return the cache for mem's library context, or 0 if there is none in
+ * use, and its budget if pmax_bytes isn't 0. The budget may be changed as
+ * soon as this returns; the stripes check their own share of it again.
+ */
+static gx_shared_char_cache *
+shared_char_cache(const gs_memory_t *mem, size_t *pmax_bytes)
+{
+    gs_lib_ctx_t *ctx = mem->gs_lib_ctx;
+    gx_shared_char_cache *cache;
+    size_t max_bytes = 0;
+
+    if (ctx == NULL)
+        return 0;
+    gx_monitor_enter((gx_monitor_t *)ctx->core->monitor);
+    cache = (gx_shared_char_cache *)ctx->core->shared_char_cache;
+    if (cache != 0)
+        max_bytes = cache->max_bytes;
+    gx_monitor_leave((gx_monitor_t *)ctx->core->monitor);
+    if (max_bytes == 0)
+        return 0;
+    if (pmax_bytes)
+        *pmax_bytes = max_bytes;
+    return cache;
+}
+
+bool
+gx_shared_char_cache_enabled(const gs_memory_t *mem)
+{
+    return shared_char_cache(mem, NULL) != 0;
+}
+
+/*
+ * Build the key for a glyph of a font/matrix pair. Return false if the
+ * glyph can't be shared.
+ */
+static bool
+shared_char_make_key(const gs_font_dir *dir, const gs_font *font,
+                     const cached_fm_pair *pair, gs_glyph glyph, int wmode,
+                     int depth, const gs_fixed_point *subpix_origin,
+                     shared_char_key *key, gs_const_string *gname)
+{
+    int i;
+
+    if (!fm_pair_has_content_XUID(pair))
+        return false;
+    memset(key, 0, sizeof(*key));
+    for (i = 0; i < 4; i++)
+        key->digest[i] = uid_XUID_values(&pair->UID)[i + 1];
+    key->FontType = pair->FontType;
+    key->mxx = pair->mxx;
+    key->mxy = pair->mxy;
+    key->myx = pair->myx;
+    key->myy = pair->myy;
+    key->design_grid = pair->design_grid;
+    key->align_to_pixels = dir->align_to_pixels;
+    key->grid_fit_tt = dir->grid_fit_tt;
+    gname->data = 0;
+    gname->size = 0;
+    if (glyph >= GS_MIN_CID_GLYPH)
+        key->glyph = glyph;
+    else {
+        /* Name glyphs are numbered differently in every instance. */
+        if (font == 0 || glyph == GS_NO_GLYPH ||
+            font->procs.glyph_name((gs_font *)font, glyph, gname) < 0 ||
+            gname->data == 0)
+            return false;
+        key->glyph = GS_NO_GLYPH;
+        key->name_size = gname->size;
+    }
+    key->wmode = wmode;
+    key->depth = depth;
+    key->subpix_x = subpix_origin->x;
+    key->subpix_y = subpix_origin->y;
+    return true;
+}
+
+/* FNV-1a */
+static uint
+shared_char_hash_bytes(uint hash, const byte *p, size_t size)
+{
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        hash = (hash ^ p[i]) * 16777619u;
+    return hash;
+}
+
+static uint
+shared_char_hash(const shared_char_key *key, const byte *name)
+{
+    uint hash = 2166136261u;
+
+    hash = shared_char_hash_bytes(hash, (const byte *)key, sizeof(*key));
+    return shared_char_hash_bytes(hash, name, key->name_size);
+}
+
+#define shared_char_stripe_index(hash) (((hash) >> 16) & (SHARED_CHAR_STRIPES - 1))
+#define shared_char_bucket_index(hash) ((hash) & (SHARED_CHAR_BUCKETS - 1))
+
+/* The following require the stripe to be locked. */
+
+static shared_char *
+shared_char_find(shared_char_stripe *stripe, uint hash,
+                 const shared_char_key *key, const byte *name)
+{
+    shared_char *sc = stripe->table[shared_char_bucket_index(hash)];
+
+    for (; sc != 0; sc = sc->next)
+        if (sc->hash == hash && !memcmp(&sc->key, key, sizeof(*key)) &&
+            !memcmp(shared_char_name(sc), name, key->name_size))
+            return sc;
+    return 0;
+}
+
+static void
+shared_char_unlink_used(shared_char_stripe *stripe, shared_char *sc)
+{
+    if (sc->prev_used)
+        sc->prev_used->next_used = sc->next_used;
+    else
+        stripe->first_used = sc->next_used;
+    if (sc->next_used)
+        sc->next_used->prev_used = sc->prev_used;
+    else
+        stripe->last_used = sc->prev_used;
+}
+
+static void
+shared_char_link_used(shared_char_stripe *stripe, shared_char *sc)
+{
+    sc->prev_used = 0;
+    sc->next_used = stripe->first_used;
+    if (stripe->first_used)
+        stripe->first_used->prev_used = sc;
+    else
+        stripe->last_used = sc;
+    stripe->first_used = sc;
+}
+
+static void
+shared_char_remove(gx_shared_char_cache *cache, shared_char_stripe *stripe,
+                   shared_char *sc)
+{
+    shared_char **psc = &stripe->table[shared_char_bucket_index(sc->hash)];
+
+    while (*psc != sc)
+        psc = &(*psc)->next;
+    *psc = sc->next;
+    shared_char_unlink_used(stripe, sc);
+    stripe->used -= sc->size;
+    gs_free_object(cache->memory, sc, "shared_char_remove");
+}
+
+/* Discard the least recently used entries until size more bytes fit. */
+static void
+shared_char_trim(gx_shared_char_cache *cache, shared_char_stripe *stripe,
+                 size_t size)
+{
+    size_t max_used = stripe->max_used;
+
+    while (stripe->last_used != 0 &&
+           (size > max_used || stripe->used > max_used - size))
+        shared_char_remove(cache, stripe, stripe->last_used);
+}
+
+/*
+ * Enter a filled in entry into the cache. Return false, and free the
+ * entry, if the glyph was there already or doesn't fit the budget.
+ */
+static bool
+shared_char_insert(gx_shared_char_cache *cache, shared_char *sc)
+{
+    shared_char_stripe *stripe =
+        &cache->stripes[shared_char_stripe_index(sc->hash)];
+
+    gx_monitor_enter(stripe->lock);
+    if (sc->size > stripe->max_used ||
+        shared_char_find(stripe, sc->hash, &sc->key,
+                         shared_char_name(sc)) != 0) {
+        /* Another instance got there first, or the budget shrank. */
+        gx_monitor_leave(stripe->lock);
+        gs_free_object(cache->memory, sc, "shared_char_insert");
+        return false;
+    }
+    shared_char_trim(cache, stripe, sc->size);
+    sc->next = stripe->table[shared_char_bucket_index(sc->hash)];
+    stripe->table[shared_char_bucket_index(sc->hash)] = sc;
+    shared_char_link_used(stripe, sc);
+    stripe->used += sc->size;
+    gx_monitor_leave(stripe->lock);
+    return true;
+}
+
+/* ------ Cache files ------ */
+
+/*
+ * The directory is given by whoever runs Ghostscript, not by a job, so
+ * the files are opened, renamed and deleted with the _impl functions,
+ * which don't consult the permitted file paths: a SAFER job can't reach
+ * them at all.
+ */
+static gp_file *
+shared_char_file_open(const gs_memory_t *mem, const char *fname,
+                      const char *mode)
+{
+    gp_file *file = gp_file_FILE_alloc(mem);
+
+    if (file == NULL)
+        return NULL;
+    if (gp_file_FILE_set(file, gp_fopen_impl(mem->non_gc_memory, fname, mode),
+                         NULL))
+        return NULL;
+    return file;
+}
+
+static void
+shared_char_file_name(const gx_shared_char_cache *cache, const long digest[4],
+                      char fname[gp_file_name_sizeof])
+{
+    gs_snprintf(fname, gp_file_name_sizeof, "%s%s%08lx%08lx%08lx%08lx.gcc",
+                cache->file_dir, gp_file_name_directory_separator(),
+                digest[0] & 0xffffffffL, digest[1] & 0xffffffffL,
+                digest[2] & 0xffffffffL, digest[3] & 0xffffffffL);
+}
+
+static void
+shared_char_record_digest(const shared_char_record *rec, const byte *data,
+                          byte check[16])
+{
+    gs_md5_state_t md5;
+
+    gs_md5_init(&md5);
+    gs_md5_append(&md5, shared_char_record_check_start(rec),
+                  shared_char_record_check_size);
+    gs_md5_append(&md5, data, rec->size);
+    gs_md5_finish(&md5, check);
+}
+
+/* Check that a record describes a bitmap we could have made. */
+static bool
+shared_char_record_ok(const shared_char_record *rec)
+{
+    int depth = rec->key.depth;
+
+    return depth > 0 && depth <= 8 && (depth & (depth - 1)) == 0 &&
+        rec->key.name_size <= rec->size &&
+        rec->raster >= ((ulong)rec->width * depth + 7) >> 3 &&
+        rec->size == rec->key.name_size + (size_t)rec->raster * rec->height;
+}
+
+static bool
+shared_char_file_read_header(gp_file *f)
+{
+    shared_char_file_header header;
+
+    return gp_fread(&header, sizeof(header), 1, f) == 1 &&
+        header.magic == SHARED_CHAR_FILE_MAGIC &&
+        header.version == SHARED_CHAR_FILE_VERSION &&
+        header.key_size == sizeof(shared_char_key) &&
+        header.record_size == sizeof(shared_char_record);
+}
+
+static bool
+shared_char_file_write_header(gp_file *f)
+{
+    shared_char_file_header header;
+
+    header.magic = SHARED_CHAR_FILE_MAGIC;
+    header.version = SHARED_CHAR_FILE_VERSION;
+    header.key_size = sizeof(shared_char_key);
+    header.record_size = sizeof(shared_char_record);
+    return gp_fwrite(&header, sizeof(header), 1, f) == 1;
+}
+
+/*
+ * Read the next record of a cache file into a new entry. Return 1 and
+ * set *psc (to 0 if the record doesn't fit in max_size), or return 0 at
+ * the end of the file or at the first damaged record, which (with what
+ * follows it) is dropped when the file is next written, or return an
+ * error if there is no memory for the entry.
+ */
+static int
+shared_char_file_read_record(gx_shared_char_cache *cache, gp_file *f,
+                             size_t max_size, shared_char **psc)
+{
+    shared_char_record rec;
+    shared_char *sc;
+    byte check[16];
+
+    *psc = 0;
+    if (gp_fread(&rec, 1, sizeof(rec), f) != sizeof(rec) ||
+        !shared_char_record_ok(&rec))
+        return 0;
+    if (sizeof(shared_char) + rec.size > max_size) {
+        /* Rendered under a larger budget; skip it. */
+        return gp_fseek(f, rec.size, SEEK_CUR) < 0 ? 0 : 1;
+    }
+    sc = (shared_char *)gs_alloc_bytes(cache->memory,
+                                       sizeof(shared_char) + rec.size,
+                                       "shared_char_file_read_record");
+    if (sc == 0)
+        return_error(gs_error_VMerror);
+    if (gp_fread(shared_char_name(sc), 1, rec.size, f) != rec.size) {
+        gs_free_object(cache->memory, sc, "shared_char_file_read_record");
+        return 0;
+    }
+    shared_char_record_digest(&rec, shared_char_name(sc), check);
+    if (memcmp(check, rec.check, sizeof(check))) {
+        gs_free_object(cache->memory, sc, "shared_char_file_read_record");
+        return 0;
+    }
+    sc->key = rec.key;
+    sc->hash = shared_char_hash(&sc->key, shared_char_name(sc));
+    sc->size = sizeof(shared_char) + rec.size;
+    sc->width = rec.width;
+    sc->height = rec.height;
+    sc->raster = rec.raster;
+    sc->wxy = rec.wxy;
+    sc->offset = rec.offset;
+    *psc = sc;
+    return 1;
+}
+
+static bool
+shared_char_file_write_record(gp_file *f, const shared_char *sc)
+{
+    shared_char_record rec;
+
+    /* Clear the padding, which is part of the check. */
+    memset(&rec, 0, sizeof(rec));
+    rec.size = sc->size - sizeof(shared_char);
+    rec.key = sc->key;
+    rec.width = sc->width;
+    rec.height = sc->height;
+    rec.raster = sc->raster;
+    rec.wxy = sc->wxy;
+    rec.offset = sc->offset;
+    shared_char_record_digest(&rec, shared_char_name(sc), rec.check);
+    return gp_fwrite(&rec, sizeof(rec), 1, f) == 1 &&
+        gp_fwrite(shared_char_name(sc), 1, rec.size, f) == rec.size;
+}
+
+/* Return the file of a font, or 0 if it has none. The files must be locked. */
+static shared_char_file *
+shared_char_file_find(gx_shared_char_cache *cache, const long digest[4])
+{
+    shared_char_file *scf =
+        cache->files[digest[0] & (SHARED_CHAR_FILE_BUCKETS - 1)];
+
+    for (; scf != 0; scf = scf->next)
+        if (!memcmp(scf->digest, digest, sizeof(scf->digest)))
+            return scf;
+    return 0;
+}
+
+/*
+ * Write the file of a font again: the good records of the file as it is
+ * now, followed by the pending ones, as far as they fit in max_bytes.
+ * The new file is written under a name of its own and then renamed, so
+ * that other processes only ever see a whole file; if two processes
+ * write the same file at once, the records added by one of them are
+ * lost, which only costs rendering those glyphs again. The files must
+ * be locked.
+ */
+static void
+shared_char_file_write(gx_shared_char_cache *cache, const gs_memory_t *mem,
+                       shared_char_file *scf, size_t max_bytes)
+{
+    char fname[gp_file_name_sizeof], tname[gp_file_name_sizeof];
+    size_t total = sizeof(shared_char_file_header);
+    gp_file *in, *out;
+    shared_char *sc;
+    bool ok;
+    int code;
+    long now[2];
+
+    if (scf->pending == 0 && !scf->damaged)
+        return;
+    shared_char_file_name(cache, scf->digest, fname);
+    gp_get_realtime(now);
+    gs_snprintf(tname, sizeof(tname), "%s.%lx%lx%lx%x.tmp", fname,
+                (ulong)(size_t)cache, now[0], now[1], cache->temp_count++);
+    out = shared_char_file_open(mem, tname, "wb");
+    ok = out != NULL && shared_char_file_write_header(out);
+
+    in = shared_char_file_open(mem, fname, "rb");
+    if (in != NULL) {
+        if (ok && shared_char_file_read_header(in)) {
+            while (ok && (code = shared_char_file_read_record(cache, in,
+                                    max_bytes / SHARED_CHAR_STRIPES, &sc)) != 0) {
+                if (code < 0)
+                    ok = false;	/* Don't lose the rest of the file. */
+                if (sc == 0)
+                    continue;
+                if (total + sizeof(shared_char_record) + sc->size -
+                        sizeof(shared_char) <= max_bytes) {
+                    ok = shared_char_file_write_record(out, sc);
+                    total += sizeof(shared_char_record) + sc->size -
+                        sizeof(shared_char);
+                }
+                gs_free_object(cache->memory, sc, "shared_char_file_write");
+            }
+        }
+        gp_fclose(in);
+    }
+    while ((sc = scf->pending) != 0) {
+        scf->pending = sc->next;
+        if (ok && total + sizeof(shared_char_record) + sc->size -
+                sizeof(shared_char) <= max_bytes) {
+            ok = shared_char_file_write_record(out, sc);
+            total += sizeof(shared_char_record) + sc->size -
+                sizeof(shared_char);
+        }
+        gs_free_object(cache->memory, sc, "shared_char_file_write");
+    }
+    scf->pending_size = 0;
+    scf->damaged = false;
+
+    if (out == NULL)
+        return;
+    if (gp_ferror(out))
+        ok = false;
+    if (gp_fclose(out) != 0)
+        ok = false;
+    if (!ok || gp_rename_impl((gs_memory_t *)mem, tname, fname) != 0) {
+        if_debug1m('K', mem, "[K]couldn't write cache file %s\n", fname);
+        gp_unlink_impl((gs_memory_t *)mem, tname);
+    }
+}
+
+/* Write the files with pending records and forget them all. */
+static void
+shared_char_files_free(gx_shared_char_cache *cache, const gs_memory_t *mem,
+                       size_t max_bytes)
+{
+    int i;
+
+    for (i = 0; i < SHARED_CHAR_FILE_BUCKETS; i++) {
+        shared_char_file *scf;
+
+        while ((scf = cache->files[i]) != 0) {
+            cache->files[i] = scf->next;
+            if (max_bytes != 0)
+                shared_char_file_write(cache, mem, scf, max_bytes);
+            gs_free_object(cache->memory, scf, "shared_char_files_free");
+        }
+    }
+    cache->num_files = 0;
+}
+
+void
+gx_shared_char_cache_add_font(const gs_memory_t *mem,
+                              const cached_fm_pair *pair)
+{
+    size_t max_bytes;
+    gx_shared_char_cache *cache = shared_char_cache(mem, &max_bytes);
+    char fname[gp_file_name_sizeof];
+    shared_char_file *scf;
+    shared_char *sc;
+    long digest[4];
+    gp_file *f;
+    int i;
+
+    if (cache == 0 || !fm_pair_has_content_XUID(pair))
+        return;
+    for (i = 0; i < 4; i++)
+        digest[i] = uid_XUID_values(&pair->UID)[i + 1];
+
+    gx_monitor_enter(cache->file_lock);
+    if (cache->file_dir == 0 || shared_char_file_find(cache, digest) != 0 ||
+        cache->num_files == SHARED_CHAR_MAX_FILES) {
+        gx_monitor_leave(cache->file_lock);
+        return;
+    }
+    scf = (shared_char_file *)gs_alloc_bytes(cache->memory, sizeof(*scf),
+                                             "gx_shared_char_cache_add_font");
+    if (scf == 0) {
+        gx_monitor_leave(cache->file_lock);
+        return;
+    }
+    memset(scf, 0, sizeof(*scf));
+    memcpy(scf->digest, digest, sizeof(scf->digest));
+    scf->next = cache->files[digest[0] & (SHARED_CHAR_FILE_BUCKETS - 1)];
+    cache->files[digest[0] & (SHARED_CHAR_FILE_BUCKETS - 1)] = scf;
+    cache->num_files++;
+    shared_char_file_name(cache, digest, fname);
+    f = shared_char_file_open(mem, fname, "rb");
+    gx_monitor_leave(cache->file_lock);
+    if (f == NULL)
+        return;			/* Not written yet. */
+
+    if (shared_char_file_read_header(f)) {
+        int code;
+
+        while ((code = shared_char_file_read_record(cache, f,
+                                max_bytes / SHARED_CHAR_STRIPES, &sc)) > 0)
+            if (sc != 0)
+                shared_char_insert(cache, sc);
+        /* Stopped short of the end? */
+        if (code == 0 && gp_fgetc(f) != EOF) {
+            if_debug1m('K', mem, "[K]truncating damaged cache file %s\n", fname);
+            gx_monitor_enter(cache->file_lock);
+            scf->damaged = true;
+            gx_monitor_leave(cache->file_lock);
+        }
+    } else {
+        if_debug1m('K', mem, "[K]replacing cache file %s\n", fname);
+        gx_monitor_enter(cache->file_lock);
+        scf->damaged = true;
+        gx_monitor_leave(cache->file_lock);
+    }
+    gp_fclose(f);
+}
+
+/*
+ * Queue a copy of a new entry to be written to the file of its font,
+ * writing the file if enough have been queued.
+ */
+static void
+shared_char_file_add(gx_shared_char_cache *cache, const gs_memory_t *mem,
+                     const shared_char *sc, size_t max_bytes)
+{
+    shared_char_file *scf;
+    shared_char *copy;
+
+    gx_monitor_enter(cache->file_lock);
+    scf = cache->file_dir == 0 ? 0 : shared_char_file_find(cache, sc->key.digest);
+    if (scf != 0) {
+        copy = (shared_char *)gs_alloc_bytes(cache->memory, sc->size,
+                                             "shared_char_file_add");
+        if (copy != 0) {
+            memcpy(copy, sc, sc->size);
+            copy->next = scf->pending;
+            scf->pending = copy;
+            scf->pending_size += sc->size;
+            if (scf->pending_size >= SHARED_CHAR_FILE_PENDING)
+                shared_char_file_write(cache, mem, scf, max_bytes);
+        }
+    }
+    gx_monitor_leave(cache->file_lock);
+}
+
+/* ------ Lookup and addition ------ */
+
+cached_char *
+gx_lookup_shared_cached_char(const gs_font *pfont, const cached_fm_pair *pair,
+                             gs_glyph glyph, int wmode, int depth,
+                             const gs_fixed_point *subpix_origin)
+{
+    gx_shared_char_cache *cache = shared_char_cache(pfont->memory, NULL);
+    gs_font_dir *dir = pfont->dir;
+    shared_char_key key;
+    gs_const_string gname;
+    shared_char_stripe *stripe;
+    shared_char *sc;
+    cached_char *cc = 0;
+    uint hash;
+
+    if (cache == 0 ||
+        !shared_char_make_key(dir, pfont, pair, glyph, wmode, depth,
+                              subpix_origin, &key, &gname))
+        return 0;
+    hash = shared_char_hash(&key, gname.data);
+    stripe = &cache->stripes[shared_char_stripe_index(hash)];
+
+    gx_monitor_enter(stripe->lock);
+    sc = shared_char_find(stripe, hash, &key, gname.data);
+    if (sc != 0) {
+        shared_char_unlink_used(stripe, sc);
+        shared_char_link_used(stripe, sc);
+        /* An error here only means we render the glyph ourselves. */
+        if (gx_alloc_cached_char(dir, sc->width, sc->height, sc->raster,
+                                 depth, &cc) < 0)
+            cc = 0;
+        if (cc != 0) {
+            memcpy(cc_bits(cc), shared_char_bits(sc),
+                   (size_t)sc->raster * sc->height);
+            cc->wxy = sc->wxy;
+            cc->offset = sc->offset;
+        }
+    }
+    gx_monitor_leave(stripe->lock);
+    if (cc == 0)
+        return 0;
+
+    cc->code = glyph;
+    cc->wmode = wmode;
+    cc->subpix_origin = *subpix_origin;
+    if (gx_add_cached_char(dir, NULL, cc, (cached_fm_pair *)pair,
+                           &scale_log2_1) < 0) {
+        gx_free_cached_char(dir, cc);
+        return 0;
+    }
+    if_debug4m('K', pfont->memory,
+               "[K]shared "PRI_INTPTR" (depth=%d) for glyph=0x%lx, wmode=%d\n",
+               (intptr_t)cc, depth, (ulong)glyph, wmode);
+    return cc;
+}
+
+void
+gx_add_shared_cached_char(gs_font_dir *dir, const cached_fm_pair *pair,
+                          const cached_char *cc)
+{
+    size_t max_bytes;
+    gx_shared_char_cache *cache = shared_char_cache(dir->memory, &max_bytes);
+    shared_char_key key;
+    gs_const_string gname;
+    shared_char *sc;
+    size_t bits_size, size;
+
+    if (cache == 0 ||
+        !shared_char_make_key(dir, pair->font, pair, cc->code, cc->wmode,
+                              cc_depth(cc), &cc->subpix_origin, &key, &gname))
+        return;
+    bits_size = (size_t)cc_raster(cc) * cc->height;
+    size = sizeof(shared_char) + key.name_size + bits_size;
+    if (size > max_bytes / SHARED_CHAR_STRIPES)
+        return;
+
+    /* Fill in the entry before taking the lock. */
+    sc = (shared_char *)gs_alloc_bytes(cache->memory, size,
+                                       "gx_add_shared_cached_char");
+    if (sc == 0)
+        return;		/* The cache is only an optimisation. */
+    sc->hash = shared_char_hash(&key, gname.data);
+    sc->size = size;
+    sc->key = key;
+    sc->width = cc->width;
+    sc->height = cc->height;
+    sc->raster = cc_raster(cc);
+    sc->wxy = cc->wxy;
+    sc->offset = cc->offset;
+    if (key.name_size)
+        memcpy(shared_char_name(sc), gname.data, key.name_size);
+    memcpy(shared_char_bits(sc), cc_const_bits(cc), bits_size);
+
+    /*
+     * Queue the entry for the file before entering it, as it may be
+     * discarded by another instance as soon as it is in the cache. Only
+     * glyphs that weren't in the cache, and so probably aren't in the
+     * file, get here.
+     */
+    shared_char_file_add(cache, dir->memory, sc, max_bytes);
+    shared_char_insert(cache, sc);
+}
+
+/* ------ Creation and destruction ------ */
+
+static void
+shared_char_cache_free(void *data)
+{
+    gx_shared_char_cache *cache = (gx_shared_char_cache *)data;
+    int i;
+
+    if (cache == 0)
+        return;
+    /* Nothing else is using the cache now, so it needn't be locked. */
+    if (cache->file_dir != 0)
+        shared_char_files_free(cache, cache->memory, cache->max_bytes);
+    for (i = 0; i < SHARED_CHAR_STRIPES; i++) {
+        shared_char_stripe *stripe = &cache->stripes[i];
+
+        while (stripe->last_used != 0)
+            shared_char_remove(cache, stripe, stripe->last_used);
+        if (stripe->lock)
+            gx_monitor_free(stripe->lock);
+    }
+    if (cache->file_lock)
+        gx_monitor_free(cache->file_lock);
+    gs_free_object(cache->memory, cache->file_dir, "shared_char_cache_free");
+    gs_free_object(cache->memory, cache, "shared_char_cache_free");
+}
+
+static int
+shared_char_cache_alloc(gs_memory_t *mem, gx_shared_char_cache **pcache)
+{
+    gx_shared_char_cache *cache;
+    int i;
+
+    *pcache = 0;
+    cache = (gx_shared_char_cache *)gs_alloc_bytes(mem, sizeof(*cache),
+                                                   "shared_char_cache_alloc");
+    if (cache == 0)
+        return_error(gs_error_VMerror);
+    memset(cache, 0, sizeof(*cache));
+    cache->memory = mem;
+    for (i = 0; i < SHARED_CHAR_STRIPES; i++) {
+        cache->stripes[i].lock = gx_monitor_label(gx_monitor_alloc(mem),
+                                                  "shared char cache");
+        if (cache->stripes[i].lock == 0) {
+            shared_char_cache_free(cache);
+            return_error(gs_error_VMerror);
+        }
+    }
+    cache->file_lock = gx_monitor_label(gx_monitor_alloc(mem),
+                                        "shared char cache files");
+    if (cache->file_lock == 0) {
+        shared_char_cache_free(cache);
+        return_error(gs_error_VMerror);
+    }
+    *pcache = cache;
+    return 0;
+}
+
+int
+gx_shared_char_cache_set_size(const gs_memory_t *mem, size_t max_bytes)
+{
+    gs_lib_ctx_core_t *core = mem->gs_lib_ctx->core;
+    gx_shared_char_cache *cache;
+    int i, code = 0;
+
+    gx_monitor_enter((gx_monitor_t *)core->monitor);
+    cache = (gx_shared_char_cache *)core->shared_char_cache;
+    if (cache == 0 && max_bytes != 0) {
+        code = shared_char_cache_alloc(core->memory->thread_safe_memory, &cache);
+        if (code >= 0) {
+            core->shared_char_cache = cache;
+            core->free_shared_char_cache = shared_char_cache_free;
+        }
+    }
+    if (cache != 0)
+        cache->max_bytes = max_bytes;
+    gx_monitor_leave((gx_monitor_t *)core->monitor);
+    if (cache == 0)
+        return code;
+
+    for (i = 0; i < SHARED_CHAR_STRIPES; i++) {
+        shared_char_stripe *stripe = &cache->stripes[i];
+
+        gx_monitor_enter(stripe->lock);
+        stripe->max_used = max_bytes / SHARED_CHAR_STRIPES;
+        shared_char_trim(cache, stripe, 0);
+        gx_monitor_leave(stripe->lock);
+    }
+    return 0;
+}
+
+int
+gx_shared_char_cache_set_directory(const gs_memory_t *mem, const char *dir_name)
+{
+    gx_shared_char_cache *cache;
+    const char *sep = gp_file_name_directory_separator();
+    size_t len = strlen(dir_name);
+    size_t max_bytes;
+    char *file_dir;
+    int code;
+
+    if (len == 0 || len + strlen(sep) + 1 >= gp_file_name_sizeof)
+        return_error(gs_error_rangecheck);
+    cache = shared_char_cache(mem, &max_bytes);
+    if (cache == 0) {
+        code = gx_shared_char_cache_set_size(mem, SHARED_CHAR_DEFAULT_SIZE);
+        if (code < 0)
+            return code;
+        cache = shared_char_cache(mem, &max_bytes);
+        if (cache == 0)
+            return_error(gs_error_VMerror);
+    }
+
+    file_dir = (char *)gs_alloc_bytes(cache->memory, len + 1,
+                                      "gx_shared_char_cache_set_directory");
+    if (file_dir == 0)
+        return_error(gs_error_VMerror);
+    memcpy(file_dir, dir_name, len + 1);
+    gx_monitor_enter(cache->file_lock);
+    if (cache->file_dir != 0)
+        shared_char_files_free(cache, mem, max_bytes);
+    gs_free_object(cache->memory, cache->file_dir,
+                   "gx_shared_char_cache_set_directory");
+    cache->file_dir = file_dir;
+    gx_monitor_leave(cache->file_lock);
+    return 0;
+}
@@ -0,0 +1,122 @@
+/* Copyright (C) 2001-2026 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Character cache shared between instances */
+/* Requires gsfont.h */
+
+#ifndef gxccshr_INCLUDED
+#  define gxccshr_INCLUDED
+
+#include "gxfcache.h"
+
+/*
+ * Instances created from one another (see gsapi_new_instance) share a
+ * library context core. If asked, the core also holds a cache of
+ * rendered glyphs that all of those instances consult when a glyph is
+ * missing from the character cache of their own font directory, and
+ * add to whenever they render one.
+ *
+ * A gs_font pointer means nothing to another instance, so entries are
+ * keyed by the content of the font instead: only fonts to which the
+ * interpreter has given a "content XUID" take part. A content XUID is
+ *      [ gx_content_XUID_org d0 d1 d2 d3 ]
+ * where d0..d3 are the 4 big-endian 32 bit words of an MD5 digest of
+ * everything that decides how the font's glyphs are drawn (the font
+ * program and any metrics the client overrides). The rest of the key is
+ * the glyph (by name for named glyphs), the character matrix, the
+ * writing mode, the alpha depth, the subpixel origin and the
+ * AlignToPixels and GridFitTT settings of the directory.
+ *
+ * The cache is split into stripes, each with its own lock, hash table
+ * and share of the memory budget, so that instances looking up glyphs
+ * that hash to different stripes don't wait for each other. Entries are
+ * discarded least recently used first.
+ *
+ * The cache can also be kept in a directory, so that later processes
+ * start with the glyphs earlier ones rendered. Each content XUID has a
+ * file of its own there, named after the digest, which is read when the
+ * font is first paired with a matrix. Newly rendered glyphs are collected
+ * and the file is written again, to a new file that is then renamed over
+ * it, when enough have been or when the cache is freed. Every record
+ * carries an MD5 digest of its contents; a file is only read up to its
+ * first damaged record, and cut short there when it is next written.
+ *
+ * The files are read and written without consulting the permitted file
+ * paths, and no job can reach them. The glyphs in them are trusted,
+ * though, so the directory must not be writable by anyone whose glyphs
+ * another user's jobs shouldn't draw: don't share it between trust
+ * domains.
+ */
+
+#define gx_content_XUID_org 1000001
+#define gx_content_XUID_size 5
+
+#define uid_is_content_XUID(puid)\
+  (uid_is_XUID(puid) && uid_XUID_size(puid) == gx_content_XUID_size &&\
+   uid_XUID_values(puid)[0] == gx_content_XUID_org)
+
+/*
+ * Only a content XUID the interpreter computed itself may be trusted: a
+ * job can give a font any XUID it likes. The interpreter sets the font's
+ * content_XUID flag when it makes one, and the flag is carried over to
+ * the font/matrix pairs of the font. Clients must also refuse content
+ * XUIDs that jobs supply (see build_gs_simple_font).
+ */
+#define fm_pair_has_content_XUID(pair)\
+  ((pair)->content_XUID && uid_is_content_XUID(&(pair)->UID))
+
+typedef struct gx_shared_char_cache_s gx_shared_char_cache;
+
+/*
+ * Set the memory budget of the cache shared by the instances using
+ * mem's library context, creating the cache if needed. A budget of 0
+ * empties the cache and stops it from being used.
+ */
+int gx_shared_char_cache_set_size(const gs_memory_t *mem, size_t max_bytes);
+
+/*
+ * Keep the cache shared by the instances using mem's library context in
+ * the directory dir_name, creating the cache with a default budget if
+ * needed. This should be done before any of the instances renders text.
+ */
+int gx_shared_char_cache_set_directory(const gs_memory_t *mem,
+                                       const char *dir_name);
+
+/*
+ * Read the cache file for the font with UID puid, if the cache is kept
+ * on disk, the UID is a content XUID and the file hasn't been read yet.
+ */
+void gx_shared_char_cache_add_font(const gs_memory_t *mem,
+                                   const cached_fm_pair *pair);
+
+/* Return true if mem's library context has a shared cache in use. */
+bool gx_shared_char_cache_enabled(const gs_memory_t *mem);
+
+/*
+ * Look up a glyph missing from pfont's directory in the shared cache.
+ * If it is there, copy it into the directory's cache, link it to pair,
+ * and return it; otherwise return 0.
+ */
+cached_char *gx_lookup_shared_cached_char(const gs_font *pfont,
+                                          const cached_fm_pair *pair,
+                                          gs_glyph glyph, int wmode, int depth,
+                                          const gs_fixed_point *subpix_origin);
+
+/* Offer a newly rendered character to the shared cache. */
+void gx_add_shared_cached_char(gs_font_dir *dir, const cached_fm_pair *pair,
+                               const cached_char *cc);
+
+#endif /* gxccshr_INCLUDED */
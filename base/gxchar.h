@@ -38,6 +38,7 @@ int gx_current_char(const gs_text_enum_t * pte);
 
 int  gx_alloc_char_bits(gs_font_dir *, gx_device_memory *, gx_device_memory *, ushort, ushort, const gs_log2_scale_point *, int, cached_char **);
 void gx_open_cache_device(gx_device_memory *, cached_char *);
+int  gx_alloc_cached_char(gs_font_dir *, ushort, ushort, uint, int, cached_char **);
 void gx_free_cached_char(gs_font_dir *, cached_char *);
 int  gx_add_cached_char(gs_font_dir *, gx_device_memory *, cached_char *, cached_fm_pair *, const gs_log2_scale_point *);
 void gx_add_char_bits(gs_font_dir *, cached_char *, const gs_log2_scale_point *);
@@ -94,5 +94,6 @@ typedef struct clist_io_procs_s clist_io_procs_t;
 
 extern const clist_io_procs_t *clist_io_procs_file_global;
 extern const clist_io_procs_t *clist_io_procs_memory_global;
+extern const clist_io_procs_t *clist_io_procs_memory_compressed_global;
 
 #endif /* gxclio_INCLUDED */
@@ -184,17 +184,22 @@ clist_initialize_device_procs(gx_device *dev)
  */
 const clist_io_procs_t *clist_io_procs_file_global = NULL;
 const clist_io_procs_t *clist_io_procs_memory_global = NULL;
+const clist_io_procs_t *clist_io_procs_memory_compressed_global = NULL;
 
 void
-clist_init_io_procs(gx_device_clist *pclist_dev, bool in_memory)
+clist_init_io_procs(gx_device_clist *pclist_dev, bool in_memory, bool compress)
 {
 #ifdef PACIFY_VALGRIND
     VALGRIND_HG_DISABLE_CHECKING(&clist_io_procs_file_global, sizeof(clist_io_procs_file_global));
     VALGRIND_HG_DISABLE_CHECKING(&clist_io_procs_memory_global, sizeof(clist_io_procs_memory_global));
+    VALGRIND_HG_DISABLE_CHECKING(&clist_io_procs_memory_compressed_global, sizeof(clist_io_procs_memory_compressed_global));
 #endif
+    /* The compressed memory band list is always kept in memory */
+    if (compress && clist_io_procs_memory_compressed_global != NULL)
+        pclist_dev->common.page_info.io_procs = clist_io_procs_memory_compressed_global;
     /* if clist_io_procs_file_global is NULL, then BAND_LIST_STORAGE=memory */
     /* was specified in the build, and "file" is not available */
-    if (in_memory || clist_io_procs_file_global == NULL)
+    else if (in_memory || clist_io_procs_file_global == NULL)
         pclist_dev->common.page_info.io_procs = clist_io_procs_memory_global;
     else
         pclist_dev->common.page_info.io_procs = clist_io_procs_file_global;
@@ -1371,7 +1376,7 @@ clist_make_accum_device(gs_memory_t *mem, gx_device *target, const char *dname,
         gx_device_fill_in_procs((gx_device *)cwdev);
         gx_device_copy_color_params((gx_device *)cwdev, target);
         rc_assign(cwdev->target, target, "clist_make_accum_device");
-        clist_init_io_procs(cdev, use_memory_clist);
+        clist_init_io_procs(cdev, use_memory_clist, false);
         cwdev->data = base;
         cwdev->data_size = space;
         memcpy (&(cwdev->buf_procs), buf_procs, sizeof(gx_device_buf_procs_t));
@@ -1495,7 +1500,7 @@ open_c:
     pdev->buf = base;
     pdev->buffer_space = space;
     pclist_dev->common.orig_spec_op = dev_spec_op;
-    clist_init_io_procs(pclist_dev, pdev->BLS_force_memory);
+    clist_init_io_procs(pclist_dev, pdev->BLS_force_memory, pdev->BLS_compress);
     clist_init_params(pclist_dev, base, space, target,
                       *buf_procs,
                       space_params->band,
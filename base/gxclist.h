@@ -381,6 +381,7 @@ struct gx_device_clist_writer_s {
 #define clist_disable_copy_alpha (1 << 6) /* target does not support copy_alpha */
 
 typedef struct clist_render_thread_control_s clist_render_thread_control_t;
+typedef struct clist_render_workers_s clist_render_workers_t;
 
 /* Define the state of a band list when reading. */
 /* For normal rasterizing, pages and num_pages are both 0. */
@@ -398,6 +399,9 @@ typedef struct gx_device_clist_reader_s {
     int curr_render_thread;		/* index into array */
     int thread_lookahead_direction;	/* +1 or -1 */
     int next_band;			/* may be < 0 or >= num bands when no more remain to render */
+    clist_render_workers_t *render_workers;	/* limits the number of bands rendered at the same time */
+    ulong *band_render_time;		/* per band render time (microseconds) for this page */
+    ulong *band_playback_time;		/* the part of that spent playing back the clist */
 
 } gx_device_clist_reader;
 
@@ -435,7 +439,7 @@ extern_st(st_device_clist);
 
 void clist_initialize_device_procs(gx_device *dev);
 
-void clist_init_io_procs(gx_device_clist *pclist_dev, bool in_memory);
+void clist_init_io_procs(gx_device_clist *pclist_dev, bool in_memory, bool compress);
 
 /* Reset (or prepare to append to) the command list after printing a page. */
 int clist_finish_page(gx_device * dev, bool flush);
@@ -20,6 +20,7 @@
 #include "gserrors.h"
 #include "gxclmem.h"
 #include "gssprintf.h"
+#include "gxsync.h"
 
 #include "valgrind.h"
 
@@ -111,6 +112,31 @@ DECOMPRESSION.
    [Note: I expected to be able to use smaller buffer sizes for some cases,
     but this resulted in a high level of thrashing...RJJ]
 
+FAST COMPRESSION.
+
+   A file opened through clist_io_procs_memory_compressed (BandListStorage
+   'compressed') has 'fast_compress' set, and does not wait for the
+   COMPRESSION_THRESHOLD. Every logical block except the last is compressed
+   as soon as it has been filled, with the small LZ codec below instead of
+   the stream compressor. Each compressed block is stored in the chain of
+   physical blocks as a 2 byte (little endian) length followed by that many
+   bytes of data. A length of MEMFILE_DATA_SIZE means that the block did not
+   compress and is stored as is.
+
+   The compression itself is handed to a helper thread, so that the writer
+   can fill the next block meanwhile. Only one block is in flight: it is
+   collected (appended to the physical chain by the writer) when the next
+   block is full, or before the file is read. Until then the logical block
+   still points to its raw physical block. On the reading side, when a
+   block is decompressed the following one is decompressed on the helper
+   thread into a raw buffer taken off the tail of the cache.
+
+   There is one helper thread per file, started by the writer and shared
+   by all the reader instances (one per rendering thread), and it does one
+   job at a time. If it is busy the writer compresses the block inline and
+   a reader simply doesn't read ahead. If no thread can be started,
+   everything is done inline.
+
 LIMITATIONS.
 
    The most serious limitation is caused by the way 'memfile_fwrite' decides
@@ -233,12 +259,612 @@ allocateWithReserve(
     return block;
 }
 
+/* ---------------- Fast compression ---------------- */
+
+/*
+ * The codec is in the style of LZ4: a sequence is a token byte holding the
+ * literal count (high nibble) and the match length - 4 (low nibble), 15
+ * meaning that more length bytes follow (each adding up to 255), then the
+ * literals, then a 2 byte little endian match offset and any match length
+ * bytes. The last sequence has no match.
+ */
+#define MEMFILE_LZ_HASH_BITS 12
+#define MEMFILE_LZ_MIN_MATCH 4
+
+/* The helper thread, owned by the file that was written. */
+typedef struct memfile_worker_s {
+    gx_monitor_t *lock;		/* protects job */
+    gx_semaphore_t *start;
+    gp_thread_id thread;
+    bool quit;
+    struct memfile_async_s *job;	/* NULL if idle */
+} memfile_worker_t;
+
+/* The (de)compression state of one writer or reader instance. */
+typedef struct memfile_async_s {
+    memfile_worker_t *worker;	/* NULL if the work is done inline */
+    gx_semaphore_t *done;
+    bool pending;		/* started and not yet collected */
+    bool threaded;		/* pending on the worker */
+    /* The job */
+    bool compress;
+    const byte *src;
+    int src_len;
+    byte *dst;
+    int dst_len;		/* result, < 0 if it failed */
+    LOG_MEMFILE_BLK *log_blk;	/* block being (de)compressed */
+    RAW_BUFFER *raw;		/* reader: target buffer, off the raw list */
+    PHYS_MEMFILE_BLK *spare;	/* writer: raw block ready for re-use */
+    ushort table[1 << MEMFILE_LZ_HASH_BITS];
+    byte cbuf[MEMFILE_DATA_SIZE];
+} memfile_async_t;
+
+static inline uint
+memfile_lz_hash(const byte *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, 4);
+    return (v * 2654435761U) >> (32 - MEMFILE_LZ_HASH_BITS);
+}
+
+static byte *
+memfile_lz_put_length(byte *op, int len)
+{
+    for (; len >= 255; len -= 255)
+        *op++ = 255;
+    *op++ = len;
+    return op;
+}
+
+/* Returns the compressed length, or -1 if it doesn't fit in dst_max. */
+static int
+memfile_lz_compress(const byte *src, int len, byte *dst, int dst_max, ushort *table)
+{
+    const byte *ip = src, *anchor = src;
+    const byte *iend = src + len;
+    const byte *mlimit = iend - MEMFILE_LZ_MIN_MATCH;
+    byte *op = dst, *oend = dst + dst_max;
+
+    memset(table, 0, sizeof(ushort) << MEMFILE_LZ_HASH_BITS);
+    while (ip <= mlimit) {
+        uint h = memfile_lz_hash(ip);
+        const byte *ref = src + table[h];
+        const byte *mp;
+        int lit, mlen;
+        uint offset;
+
+        table[h] = ip - src;
+        if (ref >= ip || memcmp(ref, ip, MEMFILE_LZ_MIN_MATCH) != 0) {
+            /* Skip faster through data that doesn't compress */
+            ip += 1 + ((ip - anchor) >> 6);
+            continue;
+        }
+        offset = ip - ref;
+        for (mp = ip + MEMFILE_LZ_MIN_MATCH; mp < iend && *mp == mp[-(int)offset]; mp++)
+            ;
+        lit = ip - anchor;
+        mlen = mp - ip - MEMFILE_LZ_MIN_MATCH;
+        if (oend - op < 1 + lit / 255 + 1 + lit + 2 + mlen / 255 + 1)
+            return -1;
+        *op++ = ((lit < 15 ? lit : 15) << 4) | (mlen < 15 ? mlen : 15);
+        if (lit >= 15)
+            op = memfile_lz_put_length(op, lit - 15);
+        memcpy(op, anchor, lit);
+        op += lit;
+        *op++ = offset & 0xff;
+        *op++ = offset >> 8;
+        if (mlen >= 15)
+            op = memfile_lz_put_length(op, mlen - 15);
+        ip = anchor = mp;
+    }
+    len = iend - anchor;
+    if (oend - op < 1 + len / 255 + 1 + len)
+        return -1;
+    *op++ = (len < 15 ? len : 15) << 4;
+    if (len >= 15)
+        op = memfile_lz_put_length(op, len - 15);
+    memcpy(op, anchor, len);
+    op += len;
+    return op - dst;
+}
+
+/* Returns the decompressed length, or -1 if the data is bad. */
+static int
+memfile_lz_decompress(const byte *src, int len, byte *dst, int dst_len)
+{
+    const byte *ip = src, *iend = src + len;
+    byte *op = dst, *oend = dst + dst_len;
+
+    while (ip < iend) {
+        int token = *ip++;
+        int lit = token >> 4, mlen = token & 15;
+        uint offset;
+        int b;
+
+        if (lit == 15)
+            do {
+                if (ip >= iend)
+                    return -1;
+                b = *ip++;
+                lit += b;
+            } while (b == 255);
+        if (lit > iend - ip || lit > oend - op)
+            return -1;
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (ip == iend)
+            break;              /* the last sequence */
+        if (iend - ip < 2)
+            return -1;
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (mlen == 15)
+            do {
+                if (ip >= iend)
+                    return -1;
+                b = *ip++;
+                mlen += b;
+            } while (b == 255);
+        mlen += MEMFILE_LZ_MIN_MATCH;
+        if (offset == 0 || offset > op - dst || mlen > oend - op)
+            return -1;
+        if (offset >= mlen)
+            memcpy(op, op - offset, mlen);
+        else {
+            /* Overlapping copy: repeats the last 'offset' bytes */
+            const byte *ref = op - offset;
+
+            while (mlen--)
+                *op++ = *ref++;
+            continue;
+        }
+        op += mlen;
+    }
+    return op - dst;
+}
+
+static void
+memfile_async_run(memfile_async_t *a)
+{
+    if (a->compress)
+        a->dst_len = memfile_lz_compress(a->src, a->src_len, a->dst,
+                                         MEMFILE_DATA_SIZE - 1, a->table);
+    else if (a->src_len == MEMFILE_DATA_SIZE) {
+        memcpy(a->dst, a->src, MEMFILE_DATA_SIZE);
+        a->dst_len = MEMFILE_DATA_SIZE;
+    } else
+        a->dst_len = memfile_lz_decompress(a->src, a->src_len, a->dst,
+                                           MEMFILE_DATA_SIZE);
+}
+
+static void
+memfile_worker_thread(void *arg)
+{
+    memfile_worker_t *w = (memfile_worker_t *)arg;
+    memfile_async_t *a;
+
+    for (;;) {
+        gx_semaphore_wait(w->start);
+        if (w->quit)
+            break;
+        a = w->job;
+        memfile_async_run(a);
+        /* Free for the next job before telling the owner of this one */
+        gx_monitor_enter(w->lock);
+        w->job = NULL;
+        gx_monitor_leave(w->lock);
+        gx_semaphore_signal(a->done);
+    }
+}
+
+/* Start the helper thread of a file being written. Failing to is not fatal,
+ * we just do the work inline. */
+static void
+memfile_worker_init(MEMFILE * f)
+{
+    memfile_worker_t *w = MALLOC(f, sizeof(*w), "memfile_worker_init");
+
+    if (w == NULL)
+        return;
+    w->quit = false;
+    w->job = NULL;
+    w->thread = NULL;
+    w->lock = gx_monitor_label(gx_monitor_alloc(f->memory), "memfile worker");
+    w->start = gx_semaphore_label(gx_semaphore_alloc(f->memory), "memfile start");
+    if (w->lock == NULL || w->start == NULL ||
+        gp_thread_start(memfile_worker_thread, w, &w->thread) < 0) {
+        if (w->lock != NULL)
+            gx_monitor_free(w->lock);
+        if (w->start != NULL)
+            gx_semaphore_free(w->start);
+        gs_free_object(f->data_memory, w, "memfile_worker_init");
+        return;
+    }
+    gp_thread_label(w->thread, "Memfile");
+    f->total_space += sizeof(*w);
+    f->worker = w;
+}
+
+/* Stop the helper thread. All the reader instances have been closed. */
+static void
+memfile_worker_free(MEMFILE * f)
+{
+    memfile_worker_t *w = f->worker;
+
+    if (w == NULL)
+        return;
+    w->quit = true;
+    gx_semaphore_signal(w->start);
+    gp_thread_finish(w->thread);
+    gx_monitor_free(w->lock);
+    gx_semaphore_free(w->start);
+    FREE(f, w, "memfile_worker_free");
+    f->worker = NULL;
+}
+
+static int
+memfile_async_init(MEMFILE * f)
+{
+    memfile_async_t *a;
+
+    /* Reader instances share the thread of the file that was written */
+    if (f->worker == NULL && f->base_memfile == NULL)
+        memfile_worker_init(f);
+    a = MALLOC(f, sizeof(*a), "memfile_async_init");
+    if (a == NULL)
+        return_error(gs_error_VMerror);
+    f->total_space += sizeof(*a);
+    a->pending = false;
+    a->threaded = false;
+    a->log_blk = NULL;
+    a->raw = NULL;
+    a->spare = NULL;
+    a->worker = f->base_memfile != NULL ? f->base_memfile->worker : f->worker;
+    a->done = NULL;
+    if (a->worker != NULL) {
+        a->done = gx_semaphore_label(gx_semaphore_alloc(f->memory), "memfile done");
+        if (a->done == NULL)
+            a->worker = NULL;
+    }
+    f->async = a;
+    return 0;
+}
+
+/* Reserve the helper thread for a job, returns false if it is busy (or
+ * there isn't one). */
+static bool
+memfile_async_claim(memfile_async_t *a)
+{
+    memfile_worker_t *w = a->worker;
+    bool claimed;
+
+    if (w == NULL)
+        return false;
+    gx_monitor_enter(w->lock);
+    claimed = w->job == NULL;
+    if (claimed)
+        w->job = a;
+    gx_monitor_leave(w->lock);
+    return claimed;
+}
+
+/* Start the job on the helper thread if we claimed it, otherwise do it now. */
+static void
+memfile_async_start(memfile_async_t *a, bool claimed)
+{
+    a->pending = true;
+    a->threaded = claimed;
+    if (claimed)
+        gx_semaphore_signal(a->worker->start);
+    else
+        memfile_async_run(a);
+}
+
+static void
+memfile_async_wait(memfile_async_t *a)
+{
+    if (!a->pending)
+        return;
+    if (a->threaded)
+        gx_semaphore_wait(a->done);
+    a->pending = false;
+    a->threaded = false;
+}
+
+/* Wait for any job in flight and free everything this instance holds. A
+ * pending compression is simply dropped: its logical block still points
+ * to the raw data. */
+static void
+memfile_async_free(MEMFILE * f)
+{
+    memfile_async_t *a = f->async;
+
+    if (a == NULL)
+        return;
+    memfile_async_wait(a);
+    if (a->done != NULL)
+        gx_semaphore_free(a->done);
+    if (a->raw != NULL)
+        FREE(f, a->raw, "memfile_async_free(raw)");
+    if (a->spare != NULL)
+        FREE(f, a->spare, "memfile_async_free(spare)");
+    FREE(f, a, "memfile_async_free");
+    f->async = NULL;
+}
+
+/* Append data to the chain of compressed physical blocks. If bp is not
+ * NULL, this is the start of the data for that logical block. */
+static int      /* ret 0 ok, -ve error, or +ve low-memory warning */
+memfile_fast_append(MEMFILE * f, LOG_MEMFILE_BLK * bp, const byte *data, int len)
+{
+    int ecode = 0, code;
+
+    while (len > 0) {
+        int count;
+
+        if (f->phys_curr == NULL || f->wt.ptr == f->wt.limit) {
+            PHYS_MEMFILE_BLK *newphys =
+                allocateWithReserve(f, sizeof(*newphys), &code, "memfile newphys",
+                        "memfile_fast_append: MALLOC for 'newphys' failed\n");
+
+            if (code < 0)
+                return code;
+            ecode |= code;
+            newphys->link = NULL;
+            if (f->phys_curr != NULL)
+                f->phys_curr->link = newphys;
+            f->phys_curr = newphys;
+            f->wt.ptr = (byte *)(newphys->data) - 1;
+            f->wt.limit = f->wt.ptr + MEMFILE_DATA_SIZE;
+        }
+        if (bp != NULL) {
+            bp->phys_blk = f->phys_curr;
+            bp->phys_pdata = (char *)(f->wt.ptr) + 1;
+            bp = NULL;
+        }
+        count = f->wt.limit - f->wt.ptr;
+        if (count > len)
+            count = len;
+        memcpy(f->wt.ptr + 1, data, count);
+        f->wt.ptr += count;
+        f->phys_curr->data_limit = (char *)(f->wt.ptr);
+        data += count;
+        len -= count;
+    }
+    return ecode;
+}
+
+/* Store the result of the pending compression, if any. */
+static int      /* ret 0 ok, -ve error, or +ve low-memory warning */
+memfile_fast_collect(MEMFILE * f)
+{
+    memfile_async_t *a = f->async;
+    LOG_MEMFILE_BLK *bp;
+    PHYS_MEMFILE_BLK *raw;
+    const byte *data;
+    byte header[2];
+    int len, code, ecode;
+
+    if (a == NULL || !a->pending || !a->compress)
+        return 0;
+    memfile_async_wait(a);
+    bp = a->log_blk;
+    raw = bp->phys_blk;
+    if (a->dst_len < 0) {
+        /* Didn't compress, store it as is */
+        data = (const byte *)raw->data;
+        len = MEMFILE_DATA_SIZE;
+    } else {
+        data = a->cbuf;
+        len = a->dst_len;
+    }
+    header[0] = len & 0xff;
+    header[1] = len >> 8;
+    ecode = memfile_fast_append(f, bp, header, 2);
+    if (ecode < 0)
+        return ecode;
+    code = memfile_fast_append(f, NULL, data, len);
+    if (code < 0)
+        return code;
+    ecode |= code;
+#ifdef DEBUG
+    tot_compressed += len + 2;
+#endif
+    if (a->spare != NULL)
+        FREE(f, a->spare, "memfile_fast_collect(spare)");
+    a->spare = raw;
+    return ecode;
+}
+
+/* Internal routine to handle the end of a logical block for fast_compress:
+ * start compressing it, and set up the next one. */
+static int      /* ret 0 ok, -ve error, or +ve low-memory warning */
+memfile_next_blk_fast(MEMFILE * f)
+{
+    LOG_MEMFILE_BLK *bp = f->log_curr_blk;
+    LOG_MEMFILE_BLK *newbp;
+    PHYS_MEMFILE_BLK *newphys;
+    memfile_async_t *a;
+    int ecode = 0, code;
+
+    if (f->async == NULL && (code = memfile_async_init(f)) < 0)
+        return code;
+    a = f->async;
+    /* Only one block is in flight, so store the previous one first */
+    if ((code = memfile_fast_collect(f)) < 0)
+        return code;
+    ecode |= code;
+    newphys = a->spare;
+    a->spare = NULL;
+    if (newphys == NULL) {
+        newphys =
+            allocateWithReserve(f, sizeof(*newphys), &code, "memfile newphys",
+                        "memfile_next_blk_fast: MALLOC for 'newphys' failed\n");
+        if (code < 0)
+            return code;
+        ecode |= code;
+    }
+    newphys->link = NULL;
+    newphys->data_limit = NULL;         /* raw                          */
+    newbp =
+        allocateWithReserve(f, sizeof(*newbp), &code, "memfile newbp",
+                    "memfile_next_blk_fast: MALLOC for 'newbp' failed\n");
+    if (code < 0) {
+        a->spare = newphys;
+        return code;
+    }
+    ecode |= code;
+    bp->link = newbp;
+    newbp->link = NULL;
+    newbp->raw_block = NULL;
+    newbp->phys_blk = newphys;
+    newbp->phys_pdata = NULL;
+    f->pdata = newphys->data;
+    f->pdata_end = f->pdata + MEMFILE_DATA_SIZE;
+    f->log_curr_blk = newbp;
+
+    a->compress = true;
+    a->log_blk = bp;
+    a->src = (const byte *)bp->phys_blk->data;
+    a->src_len = MEMFILE_DATA_SIZE;
+    a->dst = a->cbuf;
+    memfile_async_start(a, memfile_async_claim(a));
+    return ecode;
+}
+
+/* Copy len bytes of compressed data, following the physical block chain. */
+static int
+memfile_fast_read(PHYS_MEMFILE_BLK **pphys, const byte **pptr, byte *dst, int len)
+{
+    while (len > 0) {
+        int count = (const byte *)(*pphys)->data_limit + 1 - *pptr;
+
+        if (count <= 0) {
+            *pphys = (*pphys)->link;
+            if (*pphys == NULL || (*pphys)->data_limit == NULL)
+                return_error(gs_error_ioerror);
+            *pptr = (const byte *)(*pphys)->data;
+            continue;
+        }
+        if (count > len)
+            count = len;
+        memcpy(dst, *pptr, count);
+        dst += count;
+        *pptr += count;
+        len -= count;
+    }
+    return 0;
+}
+
+/* Find the compressed data for a logical block, gathering it into the
+ * async buffer if it spans physical blocks. */
+static int
+memfile_fast_source(MEMFILE * f, LOG_MEMFILE_BLK * bp, const byte **psrc, int *plen)
+{
+    PHYS_MEMFILE_BLK *phys = bp->phys_blk;
+    const byte *ptr = (const byte *)bp->phys_pdata;
+    byte header[2];
+    int len, code;
+
+    if ((code = memfile_fast_read(&phys, &ptr, header, 2)) < 0)
+        return code;
+    len = header[0] | (header[1] << 8);
+    if (len > MEMFILE_DATA_SIZE)
+        return_error(gs_error_ioerror);
+    if ((const byte *)phys->data_limit + 1 - ptr >= len)
+        *psrc = ptr;
+    else {
+        if ((code = memfile_fast_read(&phys, &ptr, f->async->cbuf, len)) < 0)
+            return code;
+        *psrc = f->async->cbuf;
+    }
+    *plen = len;
+    return 0;
+}
+
+/* Put the buffer from a pending read ahead (if any) back on the raw list. */
+static void
+memfile_prefetch_collect(MEMFILE * f)
+{
+    memfile_async_t *a = f->async;
+    RAW_BUFFER *raw;
+
+    if (a == NULL || !a->pending || a->compress)
+        return;
+    memfile_async_wait(a);
+    raw = a->raw;
+    a->raw = NULL;
+    raw->back = NULL;
+    raw->fwd = f->raw_head;
+    f->raw_head->back = raw;
+    f->raw_head = raw;
+    if (a->dst_len == MEMFILE_DATA_SIZE) {
+        raw->log_blk = a->log_blk;
+        a->log_blk->raw_block = raw;
+    } else
+        raw->log_blk = NULL;    /* memfile_get_pdata will report the error */
+}
+
+/* Start decompressing bp on the helper thread, if it is worth it and the
+ * thread isn't busy with another instance's block. */
+static void
+memfile_prefetch_start(MEMFILE * f, LOG_MEMFILE_BLK * bp)
+{
+    memfile_async_t *a = f->async;
+    RAW_BUFFER *raw = f->raw_tail;
+
+    if (bp == NULL || a == NULL || a->worker == NULL || a->pending ||
+        bp->raw_block != NULL || bp->phys_blk->data_limit == NULL)
+        return;
+    /* Leave at least 2 buffers on the list for memfile_get_pdata */
+    if (raw == f->raw_head || raw->back == f->raw_head)
+        return;
+    if (memfile_fast_source(f, bp, &a->src, &a->src_len) < 0)
+        return;
+    if (!memfile_async_claim(a))
+        return;
+    if (raw->log_blk != NULL)
+        raw->log_blk->raw_block = NULL;
+    raw->log_blk = NULL;
+    f->raw_tail = raw->back;
+    f->raw_tail->fwd = NULL;
+    a->compress = false;
+    a->log_blk = bp;
+    a->raw = raw;
+    a->dst = (byte *)raw->data;
+    memfile_async_start(a, true);
+}
+
+static int
+memfile_fast_decompress(MEMFILE * f, LOG_MEMFILE_BLK * bp, byte *dst)
+{
+    memfile_async_t *a;
+    int code;
+
+    if (f->async == NULL && (code = memfile_async_init(f)) < 0)
+        return code;
+    a = f->async;
+    if ((code = memfile_fast_source(f, bp, &a->src, &a->src_len)) < 0)
+        return code;
+    a->compress = false;
+    a->dst = dst;
+    memfile_async_run(a);
+    if (a->dst_len != MEMFILE_DATA_SIZE) {
+        emprintf(f->memory, "memfile: bad compressed block\n");
+        return_error(gs_error_ioerror);
+    }
+    return 0;
+}
+
 /* ---------------- Open/close/unlink ---------------- */
 
 static int
-memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
-              clist_file_ptr /*MEMFILE * */  * pf,
-              gs_memory_t *mem, gs_memory_t *data_mem, bool ok_to_compress)
+memfile_fopen_mode(char fname[gp_file_name_sizeof], const char *fmode,
+                   clist_file_ptr /*MEMFILE * */  * pf,
+                   gs_memory_t *mem, gs_memory_t *data_mem, bool ok_to_compress,
+                   bool fast_compress)
 {
     MEMFILE *f = NULL;
     int code = 0;
@@ -256,6 +882,10 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
             code = gs_note_error(gs_error_ioerror);
             goto finish;
         }
+        /* Store the block still being compressed, if any */
+        if ((code = memfile_fast_collect(base_f)) < 0)
+            goto finish;
+        code = 0;
         /* Reopen an existing file for 'read' */
         if (base_f->is_open == false) {
             /* File is not is use, just re-use it. */
@@ -289,6 +919,8 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
             f->log_curr_pos = 0;
             f->raw_head = NULL;
             f->error_code = 0;
+            f->async = NULL;
+            f->worker = NULL;           /* we use base_f's */
 
             if (f->log_head->phys_blk->data_limit != NULL) {
                 /* The file is compressed, so we need to copy the logical block */
@@ -315,6 +947,8 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
                 f->log_head = new_log_block;
 
                 /* NB: don't need compress_state for reading */
+                if (f->fast_compress)
+                    goto clone_done;
                 f->decompress_state =
                     gs_alloc_struct(mem, stream_state, decompress_template->stype,
                                     "memfile_open_scratch(decompress_state)");
@@ -330,6 +964,7 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
                 if (decompress_template->set_defaults)
                     (*decompress_template->set_defaults) (f->decompress_state);
             }
+clone_done:
             f->log_curr_blk = f->log_head;
             memfile_get_pdata(f);               /* set up the initial block */
 
@@ -358,6 +993,9 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
     f->reservePhysBlockCount = 0;
     f->reserveLogBlockChain = NULL;
     f->reserveLogBlockCount = 0;
+    f->fast_compress = fast_compress;
+    f->async = NULL;
+    f->worker = NULL;
     /* init an empty file           */
     if ((code = memfile_init_empty(f)) < 0)
         goto finish;
@@ -370,7 +1008,7 @@ memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
     f->ok_to_compress = /*ok_to_compress */ true;
     f->compress_state = 0;      /* make clean for GC */
     f->decompress_state = 0;
-    if (f->ok_to_compress) {
+    if (f->ok_to_compress && !f->fast_compress) {
         const stream_template *compress_template = clist_compressor_template();
         const stream_template *decompress_template = clist_decompressor_template();
 
@@ -426,6 +1064,22 @@ finish:
     return code;
 }
 
+static int
+memfile_fopen(char fname[gp_file_name_sizeof], const char *fmode,
+              clist_file_ptr /*MEMFILE * */  * pf,
+              gs_memory_t *mem, gs_memory_t *data_mem, bool ok_to_compress)
+{
+    return memfile_fopen_mode(fname, fmode, pf, mem, data_mem, ok_to_compress, false);
+}
+
+static int
+memfile_fopen_compressed(char fname[gp_file_name_sizeof], const char *fmode,
+                         clist_file_ptr /*MEMFILE * */  * pf,
+                         gs_memory_t *mem, gs_memory_t *data_mem, bool ok_to_compress)
+{
+    return memfile_fopen_mode(fname, fmode, pf, mem, data_mem, ok_to_compress, true);
+}
+
 static int
 memfile_fclose(clist_file_ptr cf, const char *fname, bool delete)
 {
@@ -449,18 +1103,14 @@ memfile_fclose(clist_file_ptr cf, const char *fname, bool delete)
                 return_error(gs_error_invalidfileaccess);
             }
             prev_f->openlist = f->openlist;     /* link around the one being fclosed */
+            memfile_async_free(f);
             /* Now delete this MEMFILE reader instance */
             /* NB: we don't delete 'base' instances until we delete */
             /* If the file is compressed, free the logical blocks, but not */
             /* the phys_blk info (that is still used by the base memfile   */
             if (f->log_head->phys_blk->data_limit != NULL) {
-                LOG_MEMFILE_BLK *tmpbp, *bp = f->log_head;
-
-                while (bp != NULL) {
-                    tmpbp = bp->link;
-                    FREE(f, bp, "memfile_free_mem(log_blk)");
-                    bp = tmpbp;
-                }
+                /* The copy was allocated as a single array by memfile_fopen */
+                gs_free_object(f->data_memory, f->log_head, "memfile_free_mem(log_blk)");
                 f->log_head = NULL;
 
                 /* Free any internal compressor state. */
@@ -497,6 +1147,7 @@ memfile_fclose(clist_file_ptr cf, const char *fname, bool delete)
     } else {
         /* Free the memory used by this memfile */
         memfile_free_mem(f);
+        memfile_worker_free(f);
 
         /* Free reserve blocks; don't do it in memfile_free_mem because */
         /* that routine gets called to reinit file */
@@ -685,6 +1336,8 @@ memfile_next_blk(MEMFILE * f)
     int ecode = 0;              /* accumulate low-memory warnings */
     int code;
 
+    if (f->fast_compress)
+        return memfile_next_blk_fast(f);
     if (f->phys_curr == NULL) { /* means NOT compressing                */
         /* allocate a new block                                           */
         newphys =
@@ -895,13 +1548,15 @@ memfile_get_pdata(MEMFILE * f)
             num_raw_buffers = i + 1;    /* if MALLOC failed, then OK    */
             if_debug1m(':', f->memory, "[:]Number of raw buffers allocated=%d\n",
                        num_raw_buffers);
-            if (f->decompress_state->templat->init != 0)
+            if (!f->fast_compress && f->decompress_state->templat->init != 0)
                 code = (*f->decompress_state->templat->init)
                     (f->decompress_state);
             if (code < 0)
                 return_error(gs_error_VMerror);
 
         }                       /* end allocating the raw buffer pool (first time only)           */
+        if (f->fast_compress)
+            memfile_prefetch_collect(f);
         if (bp->raw_block == NULL) {
 #ifdef DEBUG
             tot_cache_miss++;   /* count every decompress       */
@@ -924,6 +1579,14 @@ memfile_get_pdata(MEMFILE * f)
             f->raw_head->back = NULL;
             f->raw_head->log_blk = bp;
 
+            if (f->fast_compress) {
+                if ((code = memfile_fast_decompress(f, bp, (byte *)f->raw_head->data)) < 0) {
+                    f->raw_head->log_blk = NULL;
+                    f->error_code = code;
+                    return code;
+                }
+                goto decompressed;
+            }
             /* Decompress the data into this raw block                     */
             /* Initialize the decompressor                              */
             if (f->decompress_state->templat->reinit != 0)
@@ -967,6 +1630,7 @@ memfile_get_pdata(MEMFILE * f)
                     return_error(gs_error_Fatal);
                 }
             }
+decompressed:
             bp->raw_block = f->raw_head;        /* point to raw block           */
         }
         /* end if( raw_block == NULL ) meaning need to decompress data    */
@@ -995,6 +1659,8 @@ memfile_get_pdata(MEMFILE * f)
         f->pdata_end = f->pdata + MEMFILE_DATA_SIZE;
         /* NOTE: last block is never compressed, so a compressed block    */
         /*        is always full size.                                    */
+        if (f->fast_compress)
+            memfile_prefetch_start(f, bp->link);
     }                           /* end else (when data was compressed)                             */
 
     return 0;
@@ -1067,6 +1733,12 @@ memfile_rewind(clist_file_ptr cf, bool discard_data, const char *ignore_fname)
         /* We have to call memfile_init_empty to preserve invariants. */
         memfile_init_empty(f);
     } else {
+        int code = memfile_fast_collect(f);
+
+        if (code < 0) {
+            f->error_code = code;
+            return code;
+        }
         f->log_curr_blk = f->log_head;
         f->log_curr_pos = 0;
         memfile_get_pdata(f);
@@ -1098,6 +1770,8 @@ memfile_fseek(clist_file_ptr cf, int64_t offset, int mode, const char *ignore_fn
     }
     if (new_pos < 0 || new_pos > f->log_length)
         return -1;
+    if (memfile_fast_collect(f) < 0)
+        return -1;
     if ((f->pdata == f->pdata_end) && (f->log_curr_blk->link != NULL)) {
         /* log_curr_blk is actually one block behind log_curr_pos         */
         f->log_curr_blk = f->log_curr_blk->link;
@@ -1149,6 +1823,9 @@ memfile_free_mem(MEMFILE * f)
     tot_swap_out = 0;
 #endif
 
+    /* Stop any (de)compression in flight before freeing its blocks    */
+    memfile_async_free(f);
+
     /* Free up memory that was allocated for the memfile              */
     bp = f->log_head;
 
@@ -1249,6 +1926,19 @@ memfile_init_empty(MEMFILE * f)
     return 0;
 }
 
+clist_io_procs_t clist_io_procs_memory_compressed = {
+    memfile_fopen_compressed,
+    memfile_fclose,
+    memfile_unlink,
+    memfile_fwrite_chars,
+    memfile_fread_chars,
+    memfile_set_memory_warning,
+    memfile_ferror_code,
+    memfile_ftell,
+    memfile_rewind,
+    memfile_fseek,
+};
+
 clist_io_procs_t clist_io_procs_memory = {
     memfile_fopen,
     memfile_fclose,
@@ -1268,7 +1958,9 @@ gs_gxclmem_init(gs_memory_t *mem)
 {
 #ifdef PACIFY_VALGRIND
     VALGRIND_HG_DISABLE_CHECKING(&clist_io_procs_memory_global, sizeof(clist_io_procs_memory_global));
+    VALGRIND_HG_DISABLE_CHECKING(&clist_io_procs_memory_compressed_global, sizeof(clist_io_procs_memory_compressed_global));
 #endif
     clist_io_procs_memory_global = &clist_io_procs_memory;
+    clist_io_procs_memory_compressed_global = &clist_io_procs_memory_compressed;
     return 0;
 }
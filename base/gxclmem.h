@@ -120,6 +120,16 @@ struct MEMFILE_s {
     bool compressor_initialized;
     stream_state *compress_state;
     stream_state *decompress_state;					/******* READER INSTANCE *******/
+        /*
+         * With fast_compress, every block except the last is compressed as
+         * soon as it is full, using a small LZ codec rather than the stream
+         * compressor, and the work is handed to a helper thread if we can
+         * start one (see memfile_async_t in gxclmem.c). The thread belongs
+         * to the file that was written, and is shared by its reader instances.
+         */
+    bool fast_compress;
+    struct memfile_async_s *async;	/* or NULL */			/******* READER INSTANCE *******/
+    struct memfile_worker_s *worker;	/* or NULL, not set in reader instances */
 };
 typedef struct MEMFILE_s MEMFILE;
 
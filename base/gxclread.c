@@ -583,6 +583,9 @@ clist_render_init(gx_device_clist *dev)
     crdev->icc_table = NULL;
     crdev->color_usage_array = NULL;
     crdev->render_threads = NULL;
+    crdev->render_workers = NULL;
+    crdev->band_render_time = NULL;
+    crdev->band_playback_time = NULL;
 
     return 0;
 }
@@ -42,6 +42,79 @@
 static int clist_start_render_thread(gx_device *dev, int thread_index, int band);
 static void clist_render_thread(void *param);
 
+static clist_render_workers_t *
+clist_alloc_render_workers(gs_memory_t *mem)
+{
+    clist_render_workers_t *workers;
+
+    workers = (clist_render_workers_t *)gs_alloc_bytes(mem, sizeof(clist_render_workers_t),
+                                                       "clist_alloc_render_workers");
+    if (workers == NULL)
+        return NULL;
+    workers->lock = gx_monitor_label(gx_monitor_alloc(mem), "Workers");
+    if (workers->lock == NULL) {
+        gs_free_object(mem, workers, "clist_alloc_render_workers");
+        return NULL;
+    }
+    workers->free = 0;
+    workers->head = workers->tail = NULL;
+    return workers;
+}
+
+static void
+clist_free_render_workers(gs_memory_t *mem, clist_render_workers_t *workers)
+{
+    if (workers == NULL)
+        return;
+    gx_monitor_free(workers->lock);
+    gs_free_object(mem, workers, "clist_free_render_workers");
+}
+
+/* Called by a rendering thread before it starts on its band. If all the */
+/* workers are busy, queue this thread and wait until one is passed to   */
+/* it by clist_release_render_worker.                                    */
+static void
+clist_acquire_render_worker(clist_render_thread_control_t *thread)
+{
+    clist_render_workers_t *workers = thread->workers;
+
+    gx_monitor_enter(workers->lock);
+    if (workers->free > 0) {
+        workers->free--;
+        gx_monitor_leave(workers->lock);
+        return;
+    }
+    thread->next_waiting = NULL;
+    if (workers->tail == NULL)
+        workers->head = thread;
+    else
+        workers->tail->next_waiting = thread;
+    workers->tail = thread;
+    gx_monitor_leave(workers->lock);
+    gx_semaphore_wait(thread->sema_start);
+}
+
+/* Called by a rendering thread when it has finished its band. Hand the */
+/* worker on to the first queued thread, if there is one.               */
+static void
+clist_release_render_worker(clist_render_thread_control_t *thread)
+{
+    clist_render_workers_t *workers = thread->workers;
+    clist_render_thread_control_t *next;
+
+    gx_monitor_enter(workers->lock);
+    next = workers->head;
+    if (next != NULL) {
+        workers->head = next->next_waiting;
+        if (workers->head == NULL)
+            workers->tail = NULL;
+    } else
+        workers->free++;
+    gx_monitor_leave(workers->lock);
+    if (next != NULL)
+        gx_semaphore_signal(next->sema_start);
+}
+
 /* clone a device and set params and its chunk memory                   */
 /* The chunk_base_mem MUST be thread safe                               */
 /* Return NULL on error, or the cloned device with the dev->memory set  */
@@ -315,6 +388,7 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     int code = 0;
     int band_count = cdev->nbands;
     int band_height = crdev->page_info.band_params.BandHeight;
+    int num_workers = pdev->num_render_threads_requested;
     byte **reserve_memory_array = NULL;
     int reserve_pdf14_memory_size = 0;
     /* space for the halftone cache plus 2Mb for other allocations during rendering (paths, etc.) */
@@ -323,7 +397,13 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     clist_icctable_entry_t *curr_entry;
     bool deep = device_is_deep(dev);
 
-    crdev->num_render_threads = pdev->num_render_threads_requested;
+    /* Each requested rendering thread gets BandBuffersPerThread band buffers (and thread
+     * devices). Only NumRenderingThreads bands are rendered at once, the extra buffers let
+     * a thread that has finished its band go on to the following bands while an expensive
+     * band (transparency, shadings) is still being rendered, rather than waiting for the
+     * caller to consume the bands in order.
+     */
+    crdev->num_render_threads = num_workers * max(1, pdev->band_buffers_per_thread);
 
     if(gs_debug[':'] != 0)
         dmprintf1(mem, "%% %d rendering threads requested.\n", pdev->num_render_threads_requested);
@@ -345,6 +425,8 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     /* don't exceed our limit (allow for BGPrint and main thread) */
     if (crdev->num_render_threads > MAX_THREADS - 2)
         crdev->num_render_threads = MAX_THREADS - 2;
+    if (num_workers > crdev->num_render_threads)
+        num_workers = crdev->num_render_threads;
 
     /* Allocate and initialize an array of thread control structures */
     crdev->render_threads = (clist_render_thread_control_t *)
@@ -369,6 +451,14 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     memset(reserve_memory_array, 0, crdev->num_render_threads * sizeof(void *));
     memset(crdev->render_threads, 0, crdev->num_render_threads *
             sizeof(clist_render_thread_control_t));
+    crdev->render_workers = clist_alloc_render_workers(mem);
+    if (crdev->render_workers == NULL) {
+        gs_free_object(mem, reserve_memory_array, "clist_setup_render_threads");
+        gs_free_object(mem, crdev->render_threads, "clist_setup_render_threads");
+        crdev->render_threads = NULL;
+        emprintf(mem, " VMerror prevented threads from starting.\n");
+        return_error(gs_error_VMerror);
+    }
 
     crdev->main_thread_data = cdev->data;               /* save data area */
     /* Based on the line number requested, decide the order of band rendering */
@@ -423,6 +513,7 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
         thread->cdev = ndev;
         thread->memory = ndev->memory;
         thread->band = -1;              /* a value that won't match any valid band */
+        thread->workers = crdev->render_workers;
         thread->options = options;
         thread->buffer = NULL;
         if (options && options->init_buffer_fn) {
@@ -438,7 +529,8 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
                                 thread->memory, &(crdev->color_usage_array[0]))) < 0)
             break;
         if ((thread->sema_this = gx_semaphore_label(gx_semaphore_alloc(thread->memory), "Band")) == NULL ||
-            (thread->sema_group = gx_semaphore_label(gx_semaphore_alloc(thread->memory), "Group")) == NULL) {
+            (thread->sema_group = gx_semaphore_label(gx_semaphore_alloc(thread->memory), "Group")) == NULL ||
+            (thread->sema_start = gx_semaphore_label(gx_semaphore_alloc(thread->memory), "Start")) == NULL) {
             code = gs_error_VMerror;
             break;
         }
@@ -450,6 +542,7 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     if (code < 0) {
         /* NB: 'band' will be the one that failed, so will be the next_band needed to start */
         /* the following relies on 'free' ignoring NULL pointers */
+        gx_semaphore_free(crdev->render_threads[i].sema_start);
         gx_semaphore_free(crdev->render_threads[i].sema_group);
         gx_semaphore_free(crdev->render_threads[i].sema_this);
         if (crdev->render_threads[i].bdev != NULL)
@@ -487,6 +580,8 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
         }
         gs_free_object(mem, crdev->render_threads, "clist_setup_render_threads");
         crdev->render_threads = NULL;
+        clist_free_render_workers(mem, crdev->render_workers);
+        crdev->render_workers = NULL;
         /* restore the file pointers */
         if (cdev->page_info.cfile == NULL) {
             char fmode[4];
@@ -503,6 +598,19 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
         emprintf1(mem, "Rendering threads not started, code=%d.\n", code);
         return_error(code);
     }
+    /* Let the first num_workers of the threads run at once */
+    if (num_workers > i)
+        num_workers = i;
+    crdev->render_workers->free = num_workers;
+    /* Somewhere to record how long each band takes, not fatal if we can't */
+    crdev->band_render_time = (ulong *)gs_alloc_byte_array(mem, band_count, sizeof(ulong),
+                                                          "clist_setup_render_threads");
+    if (crdev->band_render_time != NULL)
+        memset(crdev->band_render_time, 0, band_count * sizeof(ulong));
+    crdev->band_playback_time = (ulong *)gs_alloc_byte_array(mem, band_count, sizeof(ulong),
+                                                            "clist_setup_render_threads");
+    if (crdev->band_playback_time != NULL)
+        memset(crdev->band_playback_time, 0, band_count * sizeof(ulong));
     /* Free up any "reserve" memory we may have allocated, and start the
      * threads since we deferred that in the thread setup loop above.
      * We know if we get here we can start at least 1 thread.
@@ -518,7 +626,7 @@ clist_setup_render_threads(gx_device *dev, int y, gx_process_page_options_t *opt
     crdev->next_band = band;
 
     if(gs_debug[':'] != 0)
-        dmprintf1(mem, "%% Using %d rendering threads\n", i);
+        dmprintf2(mem, "%% Using %d rendering threads, with %d band buffers\n", num_workers, i);
 
     return code;
 }
@@ -586,6 +694,40 @@ teardown_device_and_mem_for_thread(gx_device *dev, gp_thread_id thread_id, bool
     gs_memory_chunk_release(thread_memory);
 }
 
+/* Report the time taken by each band rendered by the threads, and how
+ * unevenly the work was spread between the bands. The playback time is
+ * the part spent playing back the clist; the rest went to the device's
+ * own processing of the band.
+ */
+static void
+clist_report_band_times(gx_device_clist_reader *crdev, gs_memory_t *mem)
+{
+    int band, band_count = crdev->nbands, rendered = 0, max_band = -1;
+    ulong total = 0, max_time = 0, playback = 0;
+
+    for (band = 0; band < band_count; band++) {
+        ulong t = crdev->band_render_time[band];
+        ulong p = crdev->band_playback_time != NULL ? crdev->band_playback_time[band] : 0;
+
+        if (t == 0)
+            continue;
+        dmprintf3(mem, "%% Band %d render time %lu usec, playback %lu usec\n", band, t, p);
+        rendered++;
+        total += t;
+        playback += p;
+        if (t > max_time) {
+            max_time = t;
+            max_band = band;
+        }
+    }
+    if (rendered > 0) {
+        dmprintf5(mem, "%% %d bands rendered in %lu usec, mean %lu usec, slowest band %d took %lu usec\n",
+                  rendered, total, total / rendered, max_band, max_time);
+        dmprintf2(mem, "%% clist played back in %lu usec, %lu usec processing the bands\n",
+                  playback, total - min(playback, total));
+    }
+}
+
 void
 clist_teardown_render_threads(gx_device *dev)
 {
@@ -603,12 +745,21 @@ clist_teardown_render_threads(gx_device *dev)
             if (thread->status == THREAD_BUSY)
                 gx_semaphore_wait(thread->sema_this);
         }
+        if (crdev->band_render_time != NULL) {
+            if (gs_debug[':'] != 0)
+                clist_report_band_times(crdev, mem);
+            gs_free_object(mem, crdev->band_render_time, "clist_teardown_render_threads");
+            crdev->band_render_time = NULL;
+        }
+        gs_free_object(mem, crdev->band_playback_time, "clist_teardown_render_threads");
+        crdev->band_playback_time = NULL;
         /* then free each thread's memory */
         for (i = (crdev->num_render_threads - 1); i >= 0; i--) {
             clist_render_thread_control_t *thread = &(crdev->render_threads[i]);
             gx_device_clist_common *thread_cdev = (gx_device_clist_common *)thread->cdev;
 
             /* Free control semaphores */
+            gx_semaphore_free(thread->sema_start);
             gx_semaphore_free(thread->sema_group);
             gx_semaphore_free(thread->sema_this);
             /* destroy the thread's buffer device */
@@ -636,6 +787,8 @@ clist_teardown_render_threads(gx_device *dev)
         }
         gs_free_object(mem, crdev->render_threads, "clist_teardown_render_threads");
         crdev->render_threads = NULL;
+        clist_free_render_workers(mem, crdev->render_workers);
+        crdev->render_workers = NULL;
 
         /* Now re-open the clist temp files so we can write to them */
         if (cdev->page_info.cfile == NULL) {
@@ -690,9 +843,16 @@ clist_render_thread(void *data)
     int band_begin_line = band * band_height;
     int band_end_line = band_begin_line + band_height;
     int band_num_lines;
+    long realstart[2], realend[2], playend[2];
 #ifdef DEBUG
     long starttime[2], endtime[2];
+#endif
 
+    /* Wait until there is a free worker, so that no more than the requested */
+    /* number of bands are rendered at once.                                  */
+    clist_acquire_render_worker(thread);
+    gp_get_realtime(realstart);
+#ifdef DEBUG
     gp_get_usertime(starttime); /* thread start time */
 #endif
     if (band_end_line > dev->height)
@@ -707,6 +867,9 @@ clist_render_thread(void *data)
     band_rect.q.y = band_end_line;
     if (code >= 0)
         code = clist_render_rectangle(cldev, &band_rect, bdev, NULL, true);
+    gp_get_realtime(playend);
+    thread->playback_time = (playend[0] - realstart[0]) * 1000000 +
+             (playend[1] - realstart[1]) / 1000;
 
     if (code >= 0 && thread->options && thread->options->process_fn)
         code = thread->options->process_fn(thread->options->arg, dev, bdev, &band_rect, thread->buffer);
@@ -725,6 +888,11 @@ clist_render_thread(void *data)
     thread->cputime += (endtime[0] - starttime[0]) * 1000 +
              (endtime[1] - starttime[1]) / 1000000;
 #endif
+    gp_get_realtime(realend);
+    thread->render_time = (realend[0] - realstart[0]) * 1000000 +
+             (realend[1] - realstart[1]) / 1000;
+    /* Let the next band start rendering */
+    clist_release_render_worker(thread);
     /*
      * Signal the semaphores. We signal the 'group' first since even if
      * the waiter is released on the group, it still needs to check
@@ -802,6 +970,10 @@ clist_get_band_from_thread(gx_device *dev, int band_needed, gx_process_page_opti
     thread->thread = NULL;
     if (thread->status == THREAD_ERROR)
         return_error(gs_error_unknownerror);          /* FAIL */
+    if (crdev->band_render_time != NULL)
+        crdev->band_render_time[band_needed] = thread->render_time == 0 ? 1 : thread->render_time;
+    if (crdev->band_playback_time != NULL)
+        crdev->band_playback_time[band_needed] = thread->playback_time;
 
     if (options && options->output_fn) {
         code = options->output_fn(options->arg, dev, thread->buffer);
@@ -46,6 +46,24 @@ typedef enum {
     THREAD_BUSY = 2
 } thread_status;
 
+/* Shared by the rendering threads for a page so that no more than 'free'
+ * (initially NumRenderingThreads) bands are rendered at the same time.
+ * Threads waiting for a worker are queued, and given one in the order they
+ * were started as other threads finish their bands.
+ *
+ * This single queue stands in for work stealing. A band is the smallest
+ * unit of work (playback renders a whole band into one band buffer), and
+ * each band gets its own thread, so there are no per worker queues to
+ * steal from: a worker that finishes its band takes the oldest band that
+ * is waiting, whichever thread device it was started on.
+ */
+struct clist_render_workers_s {
+    gx_monitor_t *lock;
+    int free;				/* number of idle workers */
+    clist_render_thread_control_t *head;	/* first thread waiting for a worker */
+    clist_render_thread_control_t *tail;	/* last thread waiting for a worker */
+};
+
 struct clist_render_thread_control_s {
     thread_status status;	/* 0: not started, 1: done, 2: busy, < 0: error */
                                 /* values allow waiting until status < 2 */
@@ -56,6 +74,11 @@ struct clist_render_thread_control_s {
     gx_device *bdev;	/* this thread's buffer device */
     int band;
     gp_thread_id thread;
+    clist_render_workers_t *workers;	/* shared by all the threads */
+    gx_semaphore_t *sema_start;	/* signalled when a waiting thread is given a worker */
+    clist_render_thread_control_t *next_waiting;	/* next thread waiting for a worker */
+    ulong render_time;		/* real time (microseconds) taken to render 'band' */
+    ulong playback_time;	/* the part of render_time spent playing back the clist */
 
     /* For process_page mode */
     gx_process_page_options_t *options;
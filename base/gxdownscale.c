@@ -20,6 +20,19 @@
 #include "gdevprn.h"
 #include "assert_.h"
 
+#ifdef HAVE_SSE2
+#include <emmintrin.h>
+
+/* The unit test at the end of this file turns the SSE2 loops off to get
+ * the results of the scalar code to compare them with. */
+#ifdef UNIT_TEST
+static int mm_enabled = 1;
+#define MM_ENABLED mm_enabled
+#else
+#define MM_ENABLED 1
+#endif
+#endif
+
 #ifdef WITH_CAL
 #include "cal_ets.h"
 #else
@@ -63,11 +76,52 @@ enum {
 
 /* Mono downscale/error diffusion/min feature size code */
 
+#ifdef HAVE_SSE2
+static const byte bitreverse[] =
+{ 0x00, 0x80, 0x40, 0xC0, 0x20, 0xA0, 0x60, 0xE0, 0x10, 0x90, 0x50, 0xD0,
+  0x30, 0xB0, 0x70, 0xF0, 0x08, 0x88, 0x48, 0xC8, 0x28, 0xA8, 0x68, 0xE8,
+  0x18, 0x98, 0x58, 0xD8, 0x38, 0xB8, 0x78, 0xF8, 0x04, 0x84, 0x44, 0xC4,
+  0x24, 0xA4, 0x64, 0xE4, 0x14, 0x94, 0x54, 0xD4, 0x34, 0xB4, 0x74, 0xF4,
+  0x0C, 0x8C, 0x4C, 0xCC, 0x2C, 0xAC, 0x6C, 0xEC, 0x1C, 0x9C, 0x5C, 0xDC,
+  0x3C, 0xBC, 0x7C, 0xFC, 0x02, 0x82, 0x42, 0xC2, 0x22, 0xA2, 0x62, 0xE2,
+  0x12, 0x92, 0x52, 0xD2, 0x32, 0xB2, 0x72, 0xF2, 0x0A, 0x8A, 0x4A, 0xCA,
+  0x2A, 0xAA, 0x6A, 0xEA, 0x1A, 0x9A, 0x5A, 0xDA, 0x3A, 0xBA, 0x7A, 0xFA,
+  0x06, 0x86, 0x46, 0xC6, 0x26, 0xA6, 0x66, 0xE6, 0x16, 0x96, 0x56, 0xD6,
+  0x36, 0xB6, 0x76, 0xF6, 0x0E, 0x8E, 0x4E, 0xCE, 0x2E, 0xAE, 0x6E, 0xEE,
+  0x1E, 0x9E, 0x5E, 0xDE, 0x3E, 0xBE, 0x7E, 0xFE, 0x01, 0x81, 0x41, 0xC1,
+  0x21, 0xA1, 0x61, 0xE1, 0x11, 0x91, 0x51, 0xD1, 0x31, 0xB1, 0x71, 0xF1,
+  0x09, 0x89, 0x49, 0xC9, 0x29, 0xA9, 0x69, 0xE9, 0x19, 0x99, 0x59, 0xD9,
+  0x39, 0xB9, 0x79, 0xF9, 0x05, 0x85, 0x45, 0xC5, 0x25, 0xA5, 0x65, 0xE5,
+  0x15, 0x95, 0x55, 0xD5, 0x35, 0xB5, 0x75, 0xF5, 0x0D, 0x8D, 0x4D, 0xCD,
+  0x2D, 0xAD, 0x6D, 0xED, 0x1D, 0x9D, 0x5D, 0xDD, 0x3D, 0xBD, 0x7D, 0xFD,
+  0x03, 0x83, 0x43, 0xC3, 0x23, 0xA3, 0x63, 0xE3, 0x13, 0x93, 0x53, 0xD3,
+  0x33, 0xB3, 0x73, 0xF3, 0x0B, 0x8B, 0x4B, 0xCB, 0x2B, 0xAB, 0x6B, 0xEB,
+  0x1B, 0x9B, 0x5B, 0xDB, 0x3B, 0xBB, 0x7B, 0xFB, 0x07, 0x87, 0x47, 0xC7,
+  0x27, 0xA7, 0x67, 0xE7, 0x17, 0x97, 0x57, 0xD7, 0x37, 0xB7, 0x77, 0xF7,
+  0x0F, 0x8F, 0x4F, 0xCF, 0x2F, 0xAF, 0x6F, 0xEF, 0x1F, 0x9F, 0x5F, 0xDF,
+  0x3F, 0xBF, 0x7F, 0xFF };
+#endif
+
 /* Subsidiary function to pack the data from 8 bits to 1 */
 static void pack_8to1(byte *outp, byte *inp, int w)
 {
     int mask  = 128;
     int value = 0;
+#ifdef HAVE_SSE2
+    /* 16 pixels at a time. We never write ahead of what we have read, so
+     * packing in place is still fine. */
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; MM_ENABLED && w >= 16; w -= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)inp);
+        int bits = _mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) ^ 0xFFFF;
+
+        *outp++ = bitreverse[bits & 0xFF];
+        *outp++ = bitreverse[bits >> 8];
+        inp += 16;
+    }
+#endif
     for (; w > 0; w--)
     {
         if (*inp++)
@@ -1317,8 +1371,37 @@ static void down_core8_2(gx_downscaler_t *ds,
 
     inp = in_buffer;
 
+    x = awidth;
+#ifdef HAVE_SSE2
+    {
+        /* 16 output pixels at a time. Treating the input as 16 bit words,
+         * (w & 0xFF) + (w >> 8) is the sum of each horizontal pair. */
+        const __m128i lo = _mm_set1_epi16(0xFF);
+        const __m128i two = _mm_set1_epi16(2);
+
+        for (; MM_ENABLED && x >= 16; x -= 16)
+        {
+            __m128i a0 = _mm_loadu_si128((const __m128i *)inp);
+            __m128i a1 = _mm_loadu_si128((const __m128i *)(inp + 16));
+            __m128i b0 = _mm_loadu_si128((const __m128i *)(inp + span));
+            __m128i b1 = _mm_loadu_si128((const __m128i *)(inp + span + 16));
+            __m128i s0, s1;
+
+            s0 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a0, lo), _mm_srli_epi16(a0, 8)),
+                               _mm_add_epi16(_mm_and_si128(b0, lo), _mm_srli_epi16(b0, 8)));
+            s1 = _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a1, lo), _mm_srli_epi16(a1, 8)),
+                               _mm_add_epi16(_mm_and_si128(b1, lo), _mm_srli_epi16(b1, 8)));
+            s0 = _mm_srli_epi16(_mm_add_epi16(s0, two), 2);
+            s1 = _mm_srli_epi16(_mm_add_epi16(s1, two), 2);
+            _mm_storeu_si128((__m128i *)outp, _mm_packus_epi16(s0, s1));
+            outp += 16;
+            inp += 32;
+        }
+    }
+#endif
+
     /* Left to Right pass (no min feature size) */
-    for (x = awidth; x > 0; x--)
+    for (; x > 0; x--)
     {
         *outp++ = (inp[0] + inp[1] + inp[span] + inp[span+1] + 2)>>2;
         inp += 2;
@@ -1393,8 +1476,44 @@ static void down_core8_4(gx_downscaler_t *ds,
 
     inp = in_buffer;
 
+    x = awidth;
+#ifdef HAVE_SSE2
+    {
+        /* 16 output pixels at a time. Sum horizontal pairs as for factor
+         * 2, add the 4 rows together, then _mm_madd_epi16 adds the pairs
+         * of pairs. */
+        const __m128i lo = _mm_set1_epi16(0xFF);
+        const __m128i one = _mm_set1_epi16(1);
+        const __m128i eight = _mm_set1_epi32(8);
+        __m128i q[4];
+        int i, y;
+
+        for (; MM_ENABLED && x >= 16; x -= 16)
+        {
+            for (i = 0; i < 4; i++)
+            {
+                __m128i s = _mm_setzero_si128();
+
+                for (y = 0; y < 4; y++)
+                {
+                    __m128i v = _mm_loadu_si128((const __m128i *)(inp + y*span + i*16));
+
+                    s = _mm_add_epi16(s, _mm_add_epi16(_mm_and_si128(v, lo), _mm_srli_epi16(v, 8)));
+                }
+                s = _mm_madd_epi16(s, one);
+                q[i] = _mm_srli_epi32(_mm_add_epi32(s, eight), 4);
+            }
+            _mm_storeu_si128((__m128i *)outp,
+                             _mm_packus_epi16(_mm_packs_epi32(q[0], q[1]),
+                                              _mm_packs_epi32(q[2], q[3])));
+            outp += 16;
+            inp += 64;
+        }
+    }
+#endif
+
     /* Left to Right pass (no min feature size) */
-    for (x = awidth; x > 0; x--)
+    for (; x > 0; x--)
     {
         *outp++ = (inp[0     ] + inp[       1] + inp[       2] + inp[       3] +
                    inp[span  ] + inp[span  +1] + inp[span  +2] + inp[span  +3] +
@@ -1632,11 +1751,43 @@ static void down_core32(gx_downscaler_t *ds,
     }
 
     inp = in_buffer;
+    x = awidth;
+#ifdef HAVE_SSE2
+    if (MM_ENABLED && factor == 2)
+    {
+        /* 4 output pixels at a time, summing the components of each pair
+         * of input pixels as 16 bit values. */
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i two = _mm_set1_epi16(2);
+        __m128i s[2];
+        int i;
+
+        for (; x >= 4; x -= 4)
+        {
+            for (i = 0; i < 2; i++)
+            {
+                __m128i a = _mm_loadu_si128((const __m128i *)(inp + i*16));
+                __m128i b = _mm_loadu_si128((const __m128i *)(inp + span + i*16));
+                __m128i alo = _mm_unpacklo_epi8(a, zero), ahi = _mm_unpackhi_epi8(a, zero);
+                __m128i blo = _mm_unpacklo_epi8(b, zero), bhi = _mm_unpackhi_epi8(b, zero);
+                __m128i v = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi64(alo, ahi),
+                                                        _mm_unpackhi_epi64(alo, ahi)),
+                                          _mm_add_epi16(_mm_unpacklo_epi64(blo, bhi),
+                                                        _mm_unpackhi_epi64(blo, bhi)));
+
+                s[i] = _mm_srli_epi16(_mm_add_epi16(v, two), 2);
+            }
+            _mm_storeu_si128((__m128i *)outp, _mm_packus_epi16(s[0], s[1]));
+            outp += 16;
+            inp += 32;
+        }
+    }
+#endif
     {
         /* Left to Right pass (no min feature size) */
         const int back  = span * factor - 4;
         const int back2 = factor * 4 - 1;
-        for (x = awidth; x > 0; x--)
+        for (; x > 0; x--)
         {
             /* C */
             value = 0;
@@ -3219,7 +3370,8 @@ static int downscaler_process_fn(void *arg_, gx_device *dev, gx_device *bdev, co
     code = dev_proc(bdev, get_bits_rectangle)(bdev, &in_rect, &params);
     if (code < 0)
         return code;
-    raster_in = params.raster;
+    /* Returning a pointer leaves the raster standard, but doesn't set it. */
+    raster_in = gx_device_raster(bdev, true);
     in_ptr = params.data[0];
 
     /* Where do we write it to? */
@@ -3227,7 +3379,7 @@ static int downscaler_process_fn(void *arg_, gx_device *dev, gx_device *bdev, co
         code = dev_proc(bdev, get_bits_rectangle)(buffer->bdev, &out_rect, &params);
         if (code < 0)
             return code;
-        raster_out = params.raster;
+        raster_out = gx_device_raster(buffer->bdev, true);
         out_ptr = params.data[0];
     } else {
         raster_out = raster_in;
@@ -3566,3 +3718,192 @@ void ets_free(void *malloc_arg, void *p)
 
     gs_free_object((gs_memory_t *)malloc_arg, p, "ets_malloc");
 }
+
+#if defined(UNIT_TEST) && defined(HAVE_SSE2)
+
+/*
+ * Checks that the SSE2 code in pack_8to1, down_core8_2, down_core8_4 and
+ * down_core32 gives exactly the same results as their scalar loops (and,
+ * for the box filters, as the general down_core8 and down_core32), for
+ * widths that aren't multiples of the 16 (or 4) pixels the SSE2 code does
+ * at a time, with and without white padding. It then reports the
+ * throughput of each with and without SSE2. Build it against the objects
+ * of a normal gs build, compiling this file with the usual flags plus
+ * -DUNIT_TEST and linking it with the objects listed in obj/ldt.tr other
+ * than gs.o and gxdownscale.o, for instance:
+ *
+ *   gcc <CFLAGS> -DUNIT_TEST -c base/gxdownscale.c -o obj/gxdownscale_test.o
+ *   gcc -o gxdownscale_test obj/gxdownscale_test.o $(tr -d '\\' < obj/ldt.tr | tr ' ' '\n' |
+ *       grep -v -x -e gcc -e -o -e ./bin/gs -e ./obj/gs.o -e ./obj/gxdownscale.o)
+ *
+ * It exits non zero on any difference.
+ */
+
+#include "time_.h"
+
+#undef printf
+
+static ulong ds_test_seed = 1;
+
+static byte
+ds_test_random(void)
+{
+    ds_test_seed = ds_test_seed * 1103515245 + 12345;
+    return (byte)(ds_test_seed >> 16);
+}
+
+/* Mostly random values, with plenty of the 0 and 255 edge cases. */
+static void
+ds_test_fill(byte *p, int n)
+{
+    while (n-- > 0) {
+        byte r = ds_test_random();
+
+        *p++ = (r < 48 ? 0 : r > 207 ? 255 : ds_test_random());
+    }
+}
+
+#define DS_TEST_MAX_WIDTH 2400
+#define DS_TEST_SPAN (DS_TEST_MAX_WIDTH * 4 * 4 + 64)
+
+static byte ds_test_in[3][DS_TEST_SPAN * 4];
+static byte ds_test_out[3][DS_TEST_MAX_WIDTH * 4 + 64];
+
+typedef struct ds_test_core_s {
+    const char *name;
+    gx_downscale_core *core;
+    gx_downscale_core *general;
+    int factor;
+    int bytes_per_pixel;
+} ds_test_core;
+
+static const ds_test_core ds_test_cores[] = {
+    { "down_core8_2", down_core8_2, down_core8, 2, 1 },
+    { "down_core8_4", down_core8_4, down_core8, 4, 1 },
+    { "down_core32", down_core32, down_core32, 2, 4 }
+};
+
+/* Run a core on copy i of the input. */
+static void
+ds_test_run(const ds_test_core *c, gx_downscale_core *core, int i, int sse2,
+            int width, int awidth)
+{
+    gx_downscaler_t ds;
+
+    memset(&ds, 0, sizeof(ds));
+    ds.width = width;
+    ds.awidth = awidth;
+    ds.factor = c->factor;
+    memset(ds_test_out[i], 0x55, sizeof(ds_test_out[i]));
+    mm_enabled = sse2;
+    core(&ds, ds_test_out[i], ds_test_in[i], 0, 0, DS_TEST_SPAN);
+    mm_enabled = 1;
+}
+
+static double
+ds_test_time_core(const ds_test_core *c, int sse2)
+{
+    gx_downscaler_t ds;
+    clock_t start = clock();
+    int n = 0;
+
+    memset(&ds, 0, sizeof(ds));
+    ds.width = ds.awidth = DS_TEST_MAX_WIDTH;
+    ds.factor = c->factor;
+    mm_enabled = sse2;
+    do {
+        int i;
+
+        for (i = 0; i < 100; i++)
+            c->core(&ds, ds_test_out[0], ds_test_in[0], 0, 0, DS_TEST_SPAN);
+        n += 100;
+    } while (clock() - start < CLOCKS_PER_SEC / 2);
+    mm_enabled = 1;
+    /* Input megapixels per second. */
+    return (double)n * DS_TEST_MAX_WIDTH * c->factor * c->factor /
+        ((double)(clock() - start) / CLOCKS_PER_SEC) / 1e6;
+}
+
+static double
+ds_test_time_pack(int sse2)
+{
+    clock_t start = clock();
+    int n = 0;
+
+    mm_enabled = sse2;
+    do {
+        int i;
+
+        for (i = 0; i < 100; i++)
+            pack_8to1(ds_test_out[0], ds_test_in[0], DS_TEST_MAX_WIDTH);
+        n += 100;
+    } while (clock() - start < CLOCKS_PER_SEC / 2);
+    mm_enabled = 1;
+    return (double)n * DS_TEST_MAX_WIDTH / ((double)(clock() - start) / CLOCKS_PER_SEC) / 1e6;
+}
+
+int main(void);
+
+int
+main(void)
+{
+    int failures = 0, tests = 0;
+    int width, pad, pass, i;
+
+    for (pass = 0; pass < 20; pass++)
+    for (width = 1; width <= 150; width++) {
+        /* pack_8to1, separately and in place. */
+        ds_test_fill(ds_test_in[0], width);
+        for (i = 0; i < width; i++)
+            if (ds_test_in[0][i] > 100)
+                ds_test_in[0][i] = 0;
+        memcpy(ds_test_in[1], ds_test_in[0], width);
+        memcpy(ds_test_in[2], ds_test_in[0], width);
+        memset(ds_test_out[0], 0x55, sizeof(ds_test_out[0]));
+        memset(ds_test_out[1], 0x55, sizeof(ds_test_out[1]));
+        mm_enabled = 0;
+        pack_8to1(ds_test_out[0], ds_test_in[0], width);
+        mm_enabled = 1;
+        pack_8to1(ds_test_out[1], ds_test_in[1], width);
+        pack_8to1(ds_test_in[2], ds_test_in[2], width);
+        tests++;
+        if (memcmp(ds_test_out[0], ds_test_out[1], sizeof(ds_test_out[0])) ||
+            memcmp(ds_test_out[0], ds_test_in[2], (width + 7) >> 3)) {
+            printf("pack_8to1: width %d differs\n", width);
+            failures++;
+        }
+
+        for (i = 0; i < countof(ds_test_cores); i++)
+        for (pad = 0; pad <= 3; pad += 3) {
+            const ds_test_core *c = &ds_test_cores[i];
+            int awidth = width + pad;
+            int j;
+
+            ds_test_fill(ds_test_in[0], DS_TEST_SPAN * c->factor);
+            memcpy(ds_test_in[1], ds_test_in[0], DS_TEST_SPAN * c->factor);
+            memcpy(ds_test_in[2], ds_test_in[0], DS_TEST_SPAN * c->factor);
+            ds_test_run(c, c->core, 0, 0, width, awidth);
+            ds_test_run(c, c->core, 1, 1, width, awidth);
+            ds_test_run(c, c->general, 2, 0, width, awidth);
+            tests++;
+            for (j = 1; j <= 2; j++) {
+                if (memcmp(ds_test_out[0], ds_test_out[j], sizeof(ds_test_out[0]))) {
+                    printf("%s: width %d, awidth %d differs from %s\n", c->name, width, awidth,
+                           j == 1 ? "its SSE2 code" : "the general core");
+                    failures++;
+                    break;
+                }
+            }
+        }
+    }
+    printf("%d of %d downscaler tests failed\n", failures, tests);
+
+    ds_test_fill(ds_test_in[0], sizeof(ds_test_in[0]));
+    printf("%-13s %7.0f Mpixel/s, %7.0f Mpixel/s without SSE2\n", "pack_8to1",
+           ds_test_time_pack(1), ds_test_time_pack(0));
+    for (i = 0; i < countof(ds_test_cores); i++)
+        printf("%-13s %7.0f Mpixel/s, %7.0f Mpixel/s without SSE2\n", ds_test_cores[i].name,
+               ds_test_time_core(&ds_test_cores[i], 1), ds_test_time_core(&ds_test_cores[i], 0));
+    return failures != 0;
+}
+#endif
@@ -65,6 +65,7 @@ struct cached_fm_pair_s {
     ttfFont *ttf;		/* True Type interpreter data. */
     gx_ttfReader *ttr;		/* True Type interpreter data. */
     bool design_grid;           /* A charpath font face.  */
+    bool content_XUID;          /* font->content_XUID when added. */
     uint prev, next;            /* list of pairs. */
 };
 
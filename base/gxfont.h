@@ -374,6 +374,8 @@ typedef struct gs_font_name_s {
         gs_memory_t *memory;		/* allocator for this font */\
         gs_font_dir *dir;		/* directory where registered */\
         bool is_resource;\
+        bool content_XUID;		/* UID is a content XUID made by */\
+                                        /* the interpreter (see gxccshr.h) */\
         gs_notify_list_t notify_list;	/* clients to notify when freeing */\
         gs_id id;			/* internal ID (no relation to UID) */\
         gs_font *base;			/* original (unscaled) base font */\
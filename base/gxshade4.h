@@ -113,6 +113,9 @@ struct patch_color_s {
        and from patch_fill_state_s::num_components. */
 };
 
+/* A recording of the device calls of a fill, see gxshtess.h. */
+typedef struct gx_shading_tess_s gx_shading_tess_t;
+
 /* Define the common state for rendering Coons and tensor patches. */
 struct patch_fill_state_s {
     mesh_fill_state_common;
@@ -141,6 +144,7 @@ struct patch_fill_state_s {
     byte *color_stack_limit;
     gs_memory_t *memory; /* Where color_buffer is allocated. */
     gs_color_index_cache_t *pcic;
+    gx_shading_tess_t *tess; /* Records the device calls, may be NULL. */
 } ;
 
 /* Define a structure for mesh or patch vertex. */
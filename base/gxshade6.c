@@ -31,6 +31,7 @@
 #include "gxshade.h"
 #include "gxdevcli.h"
 #include "gxshade4.h"
+#include "gxshtess.h"
 #include "gxarith.h"
 #include "gzpath.h"
 #include "stdint_.h"
@@ -295,6 +296,7 @@ init_patch_fill_state(patch_fill_state_t *pfs)
     pfs->color_stack = NULL;
     pfs->color_stack_limit = NULL;
     pfs->unlinear = !is_linear_color_applicable(pfs);
+    pfs->tess = NULL;
     return alloc_patch_fill_memory(pfs, pfs->pgs->memory, pcs);
 }
 
@@ -461,13 +463,17 @@ gs_shading_Cp_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
         return code;
     }
 
-    curve[0].straight = curve[1].straight = curve[2].straight = curve[3].straight = false;
-    shade_next_init(&cs, (const gs_shading_mesh_params_t *)&psh->params, pgs);
-    while ((code = shade_next_patch(&cs, psh->params.BitsPerFlag,
-                                    curve, NULL)) == 0 &&
-           (code = patch_fill(&state, curve, NULL, Cp_transform)) >= 0
-        ) {
-        DO_NOTHING;
+    code = gx_shading_tess_begin(&state, (const gs_shading_mesh_t *)psh0);
+    if (code == 0) {
+        curve[0].straight = curve[1].straight = curve[2].straight = curve[3].straight = false;
+        shade_next_init(&cs, (const gs_shading_mesh_params_t *)&psh->params, pgs);
+        while ((code = shade_next_patch(&cs, psh->params.BitsPerFlag,
+                                        curve, NULL)) == 0 &&
+               (code = patch_fill(&state, curve, NULL, Cp_transform)) >= 0
+            ) {
+            DO_NOTHING;
+        }
+        code = gx_shading_tess_end(&state, code);
     }
     if (term_patch_fill_state(&state))
         return_error(gs_error_unregistered); /* Must not happen. */
@@ -548,23 +554,27 @@ gs_shading_Tpp_fill_rectangle(const gs_shading_t * psh0, const gs_rect * rect,
     code = init_patch_fill_state(&state);
     if(code < 0)
         return code;
-    curve[0].straight = curve[1].straight = curve[2].straight = curve[3].straight = false;
-    shade_next_init(&cs, (const gs_shading_mesh_params_t *)&psh->params, pgs);
-    while ((code = shade_next_patch(&cs, psh->params.BitsPerFlag,
-                                    curve, interior)) == 0) {
-        /*
-         * The order of points appears to be consistent with that for Coons
-         * patches, which is different from that documented in Red Book 3.
-         */
-        gs_fixed_point swapped_interior[4];
+    code = gx_shading_tess_begin(&state, (const gs_shading_mesh_t *)psh0);
+    if (code == 0) {
+        curve[0].straight = curve[1].straight = curve[2].straight = curve[3].straight = false;
+        shade_next_init(&cs, (const gs_shading_mesh_params_t *)&psh->params, pgs);
+        while ((code = shade_next_patch(&cs, psh->params.BitsPerFlag,
+                                        curve, interior)) == 0) {
+            /*
+             * The order of points appears to be consistent with that for Coons
+             * patches, which is different from that documented in Red Book 3.
+             */
+            gs_fixed_point swapped_interior[4];
 
-        swapped_interior[0] = interior[0];
-        swapped_interior[1] = interior[3];
-        swapped_interior[2] = interior[2];
-        swapped_interior[3] = interior[1];
-        code = patch_fill(&state, curve, swapped_interior, Tpp_transform);
-        if (code < 0)
-            break;
+            swapped_interior[0] = interior[0];
+            swapped_interior[1] = interior[3];
+            swapped_interior[2] = interior[2];
+            swapped_interior[3] = interior[1];
+            code = patch_fill(&state, curve, swapped_interior, Tpp_transform);
+            if (code < 0)
+                break;
+        }
+        code = gx_shading_tess_end(&state, code);
     }
     if (term_patch_fill_state(&state))
         return_error(gs_error_unregistered); /* Must not happen. */
@@ -855,6 +865,21 @@ make_trapezoid(const gs_fixed_point q[4],
     adjust_swapped_boundary(&re->end.x, swap_axes);
 }
 
+/* Fill a constant color trapezoid, recording it if the fill is being cached. */
+static inline int
+patch_fill_trapezoid(patch_fill_state_t *pfs,
+        const gs_fixed_edge *le, const gs_fixed_edge *re,
+        fixed ybot, fixed ytop, bool swap_axes, const gx_device_color *pdevc)
+{
+    int code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+                        le, re, ybot, ytop, swap_axes, pdevc, pfs->pgs->log_op);
+
+    if (code >= 0 && pfs->tess != NULL)
+        gx_shading_tess_record_trapezoid(pfs->tess, le, re, ybot, ytop,
+                                         swap_axes, pdevc);
+    return code;
+}
+
 static inline int
 gx_shade_trapezoid(patch_fill_state_t *pfs, const gs_fixed_point q[4],
         int vi0, int vi1, int vi2, int vi3, fixed ybot0, fixed ytop0,
@@ -1136,20 +1161,20 @@ gx_shade_trapezoid(patch_fill_state_t *pfs, const gs_fixed_point q[4],
                  *  ---+-----+---
                  *     |     |
                  */
-                code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+                code = patch_fill_trapezoid(pfs,
                                         &lenew, &re, ybot, ytl,
-                                        swap_axes, pdevc, pfs->pgs->log_op);
+                                        swap_axes, pdevc);
                 if (code < 0)
                     return code;
-                code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+                code = patch_fill_trapezoid(pfs,
                                         &le, &re, ytl, ybr,
-                                        swap_axes, pdevc, pfs->pgs->log_op);
+                                        swap_axes, pdevc);
                 if (code < 0)
                     return code;
                 ybot = ybr;
-                return dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+                return patch_fill_trapezoid(pfs,
                                         &le, &renew, ybr, ytop,
-                                        swap_axes, pdevc, pfs->pgs->log_op);
+                                        swap_axes, pdevc);
             } else if (ytr < ybl) {
                 /*     |     |
                  *  ---+-----+----
@@ -1159,19 +1184,19 @@ gx_shade_trapezoid(patch_fill_state_t *pfs, const gs_fixed_point q[4],
                  *  ---+-----+---
                  *     |     |
                  */
-                code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+                code = patch_fill_trapezoid(pfs,
                                         &le, &renew, ybot, ytr,
-                                        swap_axes, pdevc, pfs->pgs->log_op);
+                                        swap_axes, pdevc);
                 if (code < 0)
                     return code;
-                code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+                code = patch_fill_trapezoid(pfs,
                                         &le, &re, ytr, ybl,
-                                        swap_axes, pdevc, pfs->pgs->log_op);
+                                        swap_axes, pdevc);
                 if (code < 0)
                     return code;
-                return dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+                return patch_fill_trapezoid(pfs,
                                         &le, &re, ybl, ytop,
-                                        swap_axes, pdevc, pfs->pgs->log_op);
+                                        swap_axes, pdevc);
             }
             /* Fill in any section where both left and right edges are
              * diagonal at the bottom */
@@ -1184,9 +1209,9 @@ gx_shade_trapezoid(patch_fill_state_t *pfs, const gs_fixed_point q[4],
                  *  ---+----+---    ---+----+---
                  *     |    |          |    |
                  */
-                code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+                code = patch_fill_trapezoid(pfs,
                                         &le, &re, ybot, ymid,
-                                        swap_axes, pdevc, pfs->pgs->log_op);
+                                        swap_axes, pdevc);
                 if (code < 0)
                     return code;
                 ybot = ymid;
@@ -1202,9 +1227,9 @@ gx_shade_trapezoid(patch_fill_state_t *pfs, const gs_fixed_point q[4],
                  *     |/7\ |    or    | /7\|
                  *     |   \|          |/   |
                  */
-                code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+                code = patch_fill_trapezoid(pfs,
                                         &le, &re, ymid, ytop,
-                                        swap_axes, pdevc, pfs->pgs->log_op);
+                                        swap_axes, pdevc);
                 if (code < 0)
                     return code;
                 ytop = ymid;
@@ -1216,9 +1241,9 @@ gx_shade_trapezoid(patch_fill_state_t *pfs, const gs_fixed_point q[4],
                  *  ---+----+---
                  *     |    |
                  */
-                code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+                code = patch_fill_trapezoid(pfs,
                                         &le, &renew, ybot, ybl,
-                                        swap_axes, pdevc, pfs->pgs->log_op);
+                                        swap_axes, pdevc);
                 if (code < 0)
                     return code;
                 ybot = ybl;
@@ -1228,9 +1253,9 @@ gx_shade_trapezoid(patch_fill_state_t *pfs, const gs_fixed_point q[4],
                  *  ---+----+---
                  *     |    |
                  */
-                code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+                code = patch_fill_trapezoid(pfs,
                                         &lenew, &re, ybot, ybr,
-                                        swap_axes, pdevc, pfs->pgs->log_op);
+                                        swap_axes, pdevc);
                 if (code < 0)
                     return code;
                 ybot = ybr;
@@ -1242,9 +1267,9 @@ gx_shade_trapezoid(patch_fill_state_t *pfs, const gs_fixed_point q[4],
                  *     |/888|
                  *     |    |
                  */
-                code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+                code = patch_fill_trapezoid(pfs,
                                         &le, &renew, ytl, ytop,
-                                        swap_axes, pdevc, pfs->pgs->log_op);
+                                        swap_axes, pdevc);
                 if (code < 0)
                     return code;
                 ytop = ytl;
@@ -1254,9 +1279,9 @@ gx_shade_trapezoid(patch_fill_state_t *pfs, const gs_fixed_point q[4],
                  *     |999\|
                  *     |    |
                  */
-                code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+                code = patch_fill_trapezoid(pfs,
                                         &lenew, &re, ytr, ytop,
-                                        swap_axes, pdevc, pfs->pgs->log_op);
+                                        swap_axes, pdevc);
                 if (code < 0)
                     return code;
                 ytop = ytr;
@@ -1265,13 +1290,13 @@ gx_shade_trapezoid(patch_fill_state_t *pfs, const gs_fixed_point q[4],
              * the middle */
             if (ybot > ytop)
                 return 0;
-            return dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
+            return patch_fill_trapezoid(pfs,
                                         &lenew, &renew, ybot, ytop,
-                                        swap_axes, pdevc, pfs->pgs->log_op);
+                                        swap_axes, pdevc);
         }
     }
-    return dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
-            &le, &re, ybot, ytop, swap_axes, pdevc, pfs->pgs->log_op);
+    return patch_fill_trapezoid(pfs,
+            &le, &re, ybot, ytop, swap_axes, pdevc);
 }
 
 static inline void
@@ -1493,8 +1518,8 @@ constant_color_trapezoid(patch_fill_state_t *pfs, gs_fixed_edge *le, gs_fixed_ed
         dc.tag = 0;
     }
 
-    return dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
-        le, re, ybot, ytop, swap_axes, &dc, pfs->pgs->log_op);
+    return patch_fill_trapezoid(pfs,
+        le, re, ybot, ytop, swap_axes, &dc);
 }
 
 static inline float
@@ -1650,6 +1675,10 @@ decompose_linear_color(patch_fill_state_t *pfs, gs_fixed_edge *le, gs_fixed_edge
             code = dev_proc(pdev, fill_linear_color_trapezoid)(pdev, &fa,
                             &le->start, &le->end, &re->start, &re->end,
                             fc[0], fc[1], NULL, NULL);
+            if (pfs->tess != NULL)
+                gx_shading_tess_record_linear_trapezoid(pfs->tess, &fa,
+                            &le->start, &le->end, &re->start, &re->end,
+                            fc[0], fc[1], code);
             if (code == 1) {
                 pfs->monotonic_color = monotonic_color_save;
                 pfs->linear_color = linear_color_save;
@@ -2115,6 +2144,10 @@ try_device_linear_color(patch_fill_state_t *pfs, bool wedge,
         code = dev_proc(pdev, fill_linear_color_triangle)(pdev, &fa,
                         &p0->p, &p1->p, &p2->p,
                         fc[0], (wedge ? NULL : fc[1]), fc[2]);
+        if (pfs->tess != NULL)
+            gx_shading_tess_record_linear_triangle(pfs->tess, &fa,
+                        &p0->p, &p1->p, &p2->p,
+                        fc[0], (wedge ? NULL : fc[1]), fc[2], code);
         if (code == 1)
             return 0; /* The area is filled. */
         if (code < 0)
@@ -2475,26 +2508,26 @@ ordered_triangle(patch_fill_state_t *pfs, gs_fixed_edge *le, gs_fixed_edge *re,
     if (code < 0)
         return code;
     if (le->end.y < re->end.y) {
-        code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
-            le, re, le->start.y, le->end.y, false, &dc, pfs->pgs->log_op);
+        code = patch_fill_trapezoid(pfs,
+            le, re, le->start.y, le->end.y, false, &dc);
         if (code >= 0) {
             ue.start = le->end;
             ue.end = re->end;
-            code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
-                &ue, re, le->end.y, re->end.y, false, &dc, pfs->pgs->log_op);
+            code = patch_fill_trapezoid(pfs,
+                &ue, re, le->end.y, re->end.y, false, &dc);
         }
     } else if (le->end.y > re->end.y) {
-        code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
-            le, re, le->start.y, re->end.y, false, &dc, pfs->pgs->log_op);
+        code = patch_fill_trapezoid(pfs,
+            le, re, le->start.y, re->end.y, false, &dc);
         if (code >= 0) {
             ue.start = re->end;
             ue.end = le->end;
-            code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
-                le, &ue, re->end.y, le->end.y, false, &dc, pfs->pgs->log_op);
+            code = patch_fill_trapezoid(pfs,
+                le, &ue, re->end.y, le->end.y, false, &dc);
         }
     } else
-        code = dev_proc(pfs->dev, fill_trapezoid)(pfs->dev,
-            le, re, le->start.y, le->end.y, false, &dc, pfs->pgs->log_op);
+        code = patch_fill_trapezoid(pfs,
+            le, re, le->start.y, le->end.y, false, &dc);
     return code;
 }
 
@@ -3034,6 +3067,7 @@ gx_init_patch_fill_state_for_clist(gx_device *dev, patch_fill_state_t *pfs, gs_m
     pfs->color_stack = NULL; /* fixme */
     pfs->color_stack_limit = NULL; /* fixme */
     pfs->pcic = NULL; /* Will do someday. */
+    pfs->tess = NULL;
     pfs->trans_device = NULL;
     pfs->icclink = NULL;
     return alloc_patch_fill_memory(pfs, memory, NULL);
@@ -0,0 +1,838 @@
+/* Copyright (C) 2001-2026 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Cache of patch mesh shading decompositions */
+#include "memory_.h"
+#include "gx.h"
+#include "gserrors.h"
+#include "gsmd5.h"
+#include "gslibctx.h"
+#include "gxsync.h"
+#include "gxcspace.h"
+#include "gxdcolor.h"
+#include "gxdevsop.h"
+#include "gxgstate.h"
+#include "gxcmap.h"
+#include "gxfmap.h"
+#include "gscms.h"
+#include "gsfunc.h"
+#include "stream.h"
+#include "gxshade.h"
+#include "gxshade4.h"
+#include "gxshtess.h"
+
+#ifndef SHADING_TESS_CACHE_SIZE
+#  define SHADING_TESS_CACHE_SIZE (4 * 1024 * 1024)
+#endif
+
+/* The most of the cache that one decomposition may take. */
+#define SHADING_TESS_MAX_ENTRY(max_size) ((max_size) / 4)
+
+/* The initial size of the hash table, it doubles as the cache fills. */
+#define SHADING_TESS_HASH_INITIAL 64
+
+/* Each recorded device call starts with one of these. */
+enum {
+    tess_op_trapezoid,
+    tess_op_linear_trapezoid,
+    tess_op_linear_triangle
+};
+
+typedef struct shading_tess_entry_s shading_tess_entry;
+struct shading_tess_entry_s {
+    shading_tess_entry *prev_used, *next_used;	/* most recently used first */
+    shading_tess_entry *next_hash;
+    byte digest[16];
+    int num_values;		/* of each recorded color */
+    int refs;			/* fills replaying the entry */
+    bool removed;		/* free it when refs drops to 0 */
+    size_t size;		/* of the recorded calls */
+    /* The recorded calls follow. */
+};
+
+#define shading_tess_entry_data(e) ((byte *)((e) + 1))
+
+typedef struct shading_tess_cache_s {
+    gs_memory_t *memory;	/* thread safe */
+    gx_monitor_t *lock;
+    size_t max_size;		/* 0 disables the cache */
+    size_t used;
+    shading_tess_entry *first_used, *last_used;
+    shading_tess_entry **hash;	/* by digest */
+    uint hash_size, count;
+} shading_tess_cache;
+
+/* The recording of a fill. */
+struct gx_shading_tess_s {
+    shading_tess_cache *cache;
+    byte digest[16];
+    int num_values;
+    size_t max_entry;		/* the most the recording may take */
+    bool failed;		/* too big, or a color we can't keep */
+    byte *data;
+    size_t size, alloc_size;
+};
+
+#define put_value(p, v) (memcpy(p, &(v), sizeof(v)), (p) += sizeof(v))
+#define get_value(v, p) (memcpy(&(v), p, sizeof(v)), (p) += sizeof(v))
+
+/* ------ The cache ------ */
+
+static void
+shading_tess_unlink_used(shading_tess_cache *cache, shading_tess_entry *e)
+{
+    if (e->prev_used)
+        e->prev_used->next_used = e->next_used;
+    else
+        cache->first_used = e->next_used;
+    if (e->next_used)
+        e->next_used->prev_used = e->prev_used;
+    else
+        cache->last_used = e->prev_used;
+}
+
+static void
+shading_tess_link_used(shading_tess_cache *cache, shading_tess_entry *e)
+{
+    e->prev_used = 0;
+    e->next_used = cache->first_used;
+    if (cache->first_used)
+        cache->first_used->prev_used = e;
+    else
+        cache->last_used = e;
+    cache->first_used = e;
+}
+
+static uint
+shading_tess_hash_index(const shading_tess_cache *cache, const byte digest[16])
+{
+    uint h = digest[0] | (digest[1] << 8) | (digest[2] << 16) |
+             ((uint)digest[3] << 24);
+
+    return h % cache->hash_size;
+}
+
+/* Find an entry. The caller holds the lock. */
+static shading_tess_entry *
+shading_tess_find(const shading_tess_cache *cache, const byte digest[16])
+{
+    shading_tess_entry *e;
+
+    if (cache->hash == 0)
+        return 0;
+    for (e = cache->hash[shading_tess_hash_index(cache, digest)]; e != 0;
+         e = e->next_hash)
+        if (!memcmp(e->digest, digest, sizeof(e->digest)))
+            return e;
+    return 0;
+}
+
+/*
+ * Add an entry to the hash table, growing the table if it is full.
+ * The caller holds the lock.
+ */
+static int
+shading_tess_hash_add(shading_tess_cache *cache, shading_tess_entry *e)
+{
+    uint index;
+
+    if (cache->count >= cache->hash_size) {
+        uint old_size = cache->hash_size, i;
+        shading_tess_entry **old_hash = cache->hash;
+        shading_tess_entry **hash;
+        shading_tess_entry *he, *next;
+
+        cache->hash_size = (old_size == 0 ? SHADING_TESS_HASH_INITIAL : old_size * 2);
+        hash = (shading_tess_entry **)
+            gs_alloc_byte_array(cache->memory, cache->hash_size,
+                                sizeof(shading_tess_entry *),
+                                "shading_tess_hash_add");
+        if (hash == 0) {
+            /* Keep the old table, only fail if there is none. */
+            cache->hash_size = old_size;
+            if (old_hash == 0)
+                return_error(gs_error_VMerror);
+        } else {
+            memset(hash, 0, cache->hash_size * sizeof(shading_tess_entry *));
+            cache->hash = hash;
+            for (i = 0; i < old_size; i++)
+                for (he = old_hash[i]; he != 0; he = next) {
+                    next = he->next_hash;
+                    index = shading_tess_hash_index(cache, he->digest);
+                    he->next_hash = hash[index];
+                    hash[index] = he;
+                }
+            gs_free_object(cache->memory, old_hash, "shading_tess_hash_add");
+        }
+    }
+    index = shading_tess_hash_index(cache, e->digest);
+    e->next_hash = cache->hash[index];
+    cache->hash[index] = e;
+    cache->count++;
+    return 0;
+}
+
+/* Remove an entry. The caller holds the lock. */
+static void
+shading_tess_remove(shading_tess_cache *cache, shading_tess_entry *e)
+{
+    shading_tess_entry **pe =
+        &cache->hash[shading_tess_hash_index(cache, e->digest)];
+
+    while (*pe != e)
+        pe = &(*pe)->next_hash;
+    *pe = e->next_hash;
+    cache->count--;
+    shading_tess_unlink_used(cache, e);
+    cache->used -= sizeof(*e) + e->size;
+    if (e->refs == 0)
+        gs_free_object(cache->memory, e, "shading_tess_remove");
+    else
+        e->removed = true;
+}
+
+static void
+shading_tess_cache_free(void *data)
+{
+    shading_tess_cache *cache = (shading_tess_cache *)data;
+
+    if (cache == 0)
+        return;
+    while (cache->last_used != 0)
+        shading_tess_remove(cache, cache->last_used);
+    gs_free_object(cache->memory, cache->hash, "shading_tess_cache_free");
+    gx_monitor_free(cache->lock);
+    gs_free_object(cache->memory, cache, "shading_tess_cache_free");
+}
+
+/* Return the cache of mem's instance, creating it if needed. */
+static shading_tess_cache *
+shading_tess_get_cache(const gs_memory_t *mem)
+{
+    gs_lib_ctx_t *ctx = mem->gs_lib_ctx;
+    shading_tess_cache *cache;
+
+    if (ctx == NULL)
+        return 0;
+    gx_monitor_enter((gx_monitor_t *)ctx->core->monitor);
+    cache = (shading_tess_cache *)ctx->shading_tess_cache;
+    if (cache == 0) {
+        gs_memory_t *cmem = ctx->memory->thread_safe_memory;
+
+        cache = (shading_tess_cache *)gs_alloc_bytes(cmem, sizeof(*cache),
+                                                     "shading_tess_get_cache");
+        if (cache != 0) {
+            memset(cache, 0, sizeof(*cache));
+            cache->memory = cmem;
+            cache->max_size = SHADING_TESS_CACHE_SIZE;
+            cache->lock = gx_monitor_label(gx_monitor_alloc(cmem),
+                                           "shading tess cache");
+            if (cache->lock == 0) {
+                gs_free_object(cmem, cache, "shading_tess_get_cache");
+                cache = 0;
+            } else {
+                ctx->shading_tess_cache = cache;
+                ctx->free_shading_tess_cache = shading_tess_cache_free;
+            }
+        }
+    }
+    gx_monitor_leave((gx_monitor_t *)ctx->core->monitor);
+    return cache;
+}
+
+/* Discard entries until the cache fits. The caller holds the lock. */
+static void
+shading_tess_trim(shading_tess_cache *cache)
+{
+    while (cache->used > cache->max_size && cache->last_used != 0)
+        shading_tess_remove(cache, cache->last_used);
+}
+
+int
+gx_shading_tess_set_max_size(const gs_memory_t *mem, size_t size)
+{
+    shading_tess_cache *cache = shading_tess_get_cache(mem);
+
+    if (cache == 0)
+        return_error(gs_error_VMerror);
+    gx_monitor_enter(cache->lock);
+    cache->max_size = size;
+    shading_tess_trim(cache);
+    gx_monitor_leave(cache->lock);
+    return 0;
+}
+
+size_t
+gx_shading_tess_max_size(const gs_memory_t *mem)
+{
+    gs_lib_ctx_t *ctx = mem->gs_lib_ctx;
+    shading_tess_cache *cache;
+    size_t size = SHADING_TESS_CACHE_SIZE;
+
+    if (ctx == NULL)
+        return 0;
+    gx_monitor_enter((gx_monitor_t *)ctx->core->monitor);
+    cache = (shading_tess_cache *)ctx->shading_tess_cache;
+    gx_monitor_leave((gx_monitor_t *)ctx->core->monitor);
+    if (cache != 0) {
+        gx_monitor_enter(cache->lock);
+        size = cache->max_size;
+        gx_monitor_leave(cache->lock);
+    }
+    return size;
+}
+
+/* ------ The key ------ */
+
+#define hash_value(md5, v)\
+  gs_md5_append(md5, (const gs_md5_byte_t *)&(v), sizeof(v))
+
+static void
+shading_tess_hash_bytes(gs_md5_state_t *md5, const byte *data, size_t size)
+{
+    hash_value(md5, size);
+    while (size > 0) {
+        int n = (int)min(size, max_int);
+
+        gs_md5_append(md5, data, n);
+        data += n;
+        size -= n;
+    }
+}
+
+static void
+shading_tess_hash_device(gs_md5_state_t *md5, const gx_device *dev)
+{
+    const gx_device_color_info *ci = &dev->color_info;
+
+    hash_value(md5, dev->procs);
+    hash_value(md5, dev->HWResolution);
+    hash_value(md5, dev->graphics_type_tag);
+    hash_value(md5, ci->max_components);
+    hash_value(md5, ci->num_components);
+    hash_value(md5, ci->polarity);
+    hash_value(md5, ci->depth);
+    hash_value(md5, ci->gray_index);
+    hash_value(md5, ci->max_gray);
+    hash_value(md5, ci->max_color);
+    hash_value(md5, ci->dither_grays);
+    hash_value(md5, ci->dither_colors);
+    hash_value(md5, ci->separable_and_linear);
+    hash_value(md5, ci->comp_shift);
+    hash_value(md5, ci->comp_bits);
+}
+
+static void
+shading_tess_hash_map(gs_md5_state_t *md5, const gx_transfer_map *map)
+{
+    bool present = (map != 0);
+
+    hash_value(md5, present);
+    if (present)
+        hash_value(md5, map->values);
+}
+
+static int
+shading_tess_hash_function(gs_md5_state_t *md5, const gs_function_t *pfn,
+                           gs_memory_t *mem)
+{
+    stream s;
+    byte *buf;
+    uint size;
+    int code;
+
+    s_init(&s, NULL);
+    swrite_position_only(&s);
+    code = gs_function_serialize(pfn, &s);
+    if (code < 0)
+        return code;
+    size = (uint)stell(&s);
+    buf = gs_alloc_bytes(mem, size, "shading_tess_hash_function");
+    if (buf == 0)
+        return_error(gs_error_VMerror);
+    s_init(&s, NULL);
+    swrite_string(&s, buf, size);
+    code = gs_function_serialize(pfn, &s);
+    if (code >= 0)
+        shading_tess_hash_bytes(md5, buf, size);
+    gs_free_object(mem, buf, "shading_tess_hash_function");
+    return code;
+}
+
+/*
+ * Compute the key of a fill. Return false if the fill can't be cached:
+ * its data is in a file, or its colors aren't converted with an ICC link.
+ */
+static bool
+shading_tess_digest(const patch_fill_state_t *pfs,
+                    const gs_shading_mesh_t *psh, byte digest[16])
+{
+    const gs_shading_mesh_params_t *params = &psh->params;
+    const gs_color_space *pcs = params->ColorSpace;
+    const gs_gstate *pgs = pfs->pgs;
+    const gs_data_source_t *ds = &params->DataSource;
+    const gs_matrix_fixed *pctm = &pgs->ctm;
+    const gx_color_map_procs *cmap_procs;
+    const byte *data;
+    size_t size;
+    int BitsPerFlag, i;
+    gs_md5_state_t md5;
+
+    if (pfs->icclink == 0 || pcs == 0 ||
+        gs_color_space_get_index(pcs) != gs_color_space_index_ICC ||
+        pcs->cmm_icc_profile_data == 0)
+        return false;
+    switch (ds->type) {
+        case data_source_type_string:
+        case data_source_type_bytes:
+        case data_source_type_floats:
+            data = ds->data.str.data;
+            size = ds->data.str.size;
+            break;
+        case data_source_type_stream: {
+            /* Only a reusable string; see shade_next_init. */
+            const stream *s = ds->data.strm;
+
+            if (s == 0 || s->file != 0 || s->strm != 0 ||
+                s->cbuf_string.data == 0)
+                return false;
+            data = s->cbuf_string.data;
+            size = s->cbuf_string.size;
+            break;
+        }
+        default:
+            return false;
+    }
+
+    gs_md5_init(&md5);
+    /* The shading. */
+    hash_value(&md5, psh->head.type);
+    hash_value(&md5, params->BitsPerCoordinate);
+    hash_value(&md5, params->BitsPerComponent);
+    BitsPerFlag = (psh->head.type == shading_type_Coons_patch ?
+                   ((const gs_shading_Cp_t *)psh)->params.BitsPerFlag :
+                   ((const gs_shading_Tpp_t *)psh)->params.BitsPerFlag);
+    hash_value(&md5, BitsPerFlag);
+    hash_value(&md5, ds->type);
+    shading_tess_hash_bytes(&md5, data, size);
+    if (params->Decode != 0)
+        shading_tess_hash_bytes(&md5, (const byte *)params->Decode,
+                                sizeof(float) * (4 + 2 *
+                                (params->Function ? 1 : pfs->num_components)));
+    if (params->Function != 0 &&
+        shading_tess_hash_function(&md5, params->Function,
+                                   pfs->pgs->memory->non_gc_memory) < 0)
+        return false;
+    hash_value(&md5, pcs->cmm_icc_profile_data->hashcode);
+    hash_value(&md5, pfs->icclink->hashcode);
+    /* The geometry. */
+    hash_value(&md5, pctm->xx);
+    hash_value(&md5, pctm->xy);
+    hash_value(&md5, pctm->yx);
+    hash_value(&md5, pctm->yy);
+    hash_value(&md5, pctm->tx);
+    hash_value(&md5, pctm->ty);
+    hash_value(&md5, pfs->rect);
+    /* The subdivision. */
+    hash_value(&md5, pfs->num_components);
+    hash_value(&md5, pfs->fixed_flat);
+    hash_value(&md5, pfs->smoothness);
+    hash_value(&md5, pfs->decomposition_limit);
+    hash_value(&md5, pfs->unlinear);
+    hash_value(&md5, pfs->cs_always_linear);
+    for (i = 0; i < pfs->num_components; i++) {
+        hash_value(&md5, pfs->color_domain.paint.values[i]);
+        hash_value(&md5, pfs->cc_max_error[i]);
+    }
+    /* The color mapping. */
+    hash_value(&md5, pgs->log_op);
+    hash_value(&md5, pgs->renderingintent);
+    hash_value(&md5, pgs->blackptcomp);
+    cmap_procs = gx_get_cmap_procs(pgs, pfs->dev);
+    hash_value(&md5, cmap_procs);
+    shading_tess_hash_map(&md5, pgs->black_generation);
+    shading_tess_hash_map(&md5, pgs->undercolor_removal);
+    for (i = 0; i < pfs->trans_device->color_info.num_components; i++)
+        shading_tess_hash_map(&md5, pgs->effective_transfer[i]);
+    /* The devices. */
+    shading_tess_hash_device(&md5, pfs->dev);
+    shading_tess_hash_device(&md5, pfs->trans_device);
+    gs_md5_finish(&md5, digest);
+    return true;
+}
+
+/* ------ Recording ------ */
+
+/* Make room for a call, or return 0 if the recording has been given up. */
+static byte *
+shading_tess_reserve(gx_shading_tess_t *tess, size_t size)
+{
+    byte *p;
+
+    if (tess->failed)
+        return 0;
+    if (tess->size + size > tess->alloc_size) {
+        size_t limit = tess->max_entry - sizeof(shading_tess_entry);
+        size_t new_size = max(tess->alloc_size * 2, 4096);
+        byte *data;
+
+        while (new_size < tess->size + size)
+            new_size *= 2;
+        new_size = min(new_size, limit);
+        if (new_size < tess->size + size) {
+            tess->failed = true;
+            return 0;
+        }
+        data = gs_alloc_bytes(tess->cache->memory, new_size,
+                              "shading_tess_reserve");
+        if (data == 0) {
+            tess->failed = true;
+            return 0;
+        }
+        if (tess->size)
+            memcpy(data, tess->data, tess->size);
+        gs_free_object(tess->cache->memory, tess->data, "shading_tess_reserve");
+        tess->data = data;
+        tess->alloc_size = new_size;
+    }
+    p = tess->data + tess->size;
+    tess->size += size;
+    return p;
+}
+
+static byte *
+shading_tess_put_attributes(byte *p, const gs_fill_attributes *fa, bool y_range)
+{
+    byte swap_axes = fa->swap_axes;
+
+    put_value(p, *fa->clip);
+    *p++ = swap_axes;
+    if (y_range) {
+        put_value(p, fa->ystart);
+        put_value(p, fa->yend);
+    }
+    return p;
+}
+
+#define attributes_size(y_range)\
+  (sizeof(gs_fixed_rect) + 1 + ((y_range) ? 2 * sizeof(fixed) : 0))
+
+void
+gx_shading_tess_record_trapezoid(gx_shading_tess_t *tess,
+        const gs_fixed_edge *le, const gs_fixed_edge *re,
+        fixed ybot, fixed ytop, bool swap_axes,
+        const gx_device_color *pdevc)
+{
+    size_t size = 3 + 2 * sizeof(gs_fixed_edge) + 2 * sizeof(fixed) +
+                  sizeof(pdevc->tag);
+    byte devn;
+    byte *p;
+
+    if (pdevc->type == gx_dc_type_pure) {
+        devn = 0;
+        size += sizeof(gx_color_index);
+    } else if (pdevc->type == gx_dc_type_devn) {
+        devn = 1;
+        size += sizeof(ushort) * tess->num_values;
+    } else {
+        tess->failed = true;
+        return;
+    }
+    p = shading_tess_reserve(tess, size);
+    if (p == 0)
+        return;
+    *p++ = tess_op_trapezoid;
+    put_value(p, *le);
+    put_value(p, *re);
+    put_value(p, ybot);
+    put_value(p, ytop);
+    *p++ = (byte)swap_axes;
+    *p++ = devn;
+    put_value(p, pdevc->tag);
+    if (devn)
+        memcpy(p, pdevc->colors.devn.values, sizeof(ushort) * tess->num_values);
+    else
+        put_value(p, pdevc->colors.pure);
+}
+
+void
+gx_shading_tess_record_linear_trapezoid(gx_shading_tess_t *tess,
+        const gs_fill_attributes *fa,
+        const gs_fixed_point *p0, const gs_fixed_point *p1,
+        const gs_fixed_point *p2, const gs_fixed_point *p3,
+        const frac31 *c0, const frac31 *c1, int code)
+{
+    size_t csize = sizeof(frac31) * tess->num_values;
+    byte *p = shading_tess_reserve(tess, 1 + attributes_size(true) +
+                                   4 * sizeof(gs_fixed_point) + 2 * csize +
+                                   sizeof(code));
+
+    if (p == 0)
+        return;
+    *p++ = tess_op_linear_trapezoid;
+    p = shading_tess_put_attributes(p, fa, true);
+    put_value(p, *p0);
+    put_value(p, *p1);
+    put_value(p, *p2);
+    put_value(p, *p3);
+    memcpy(p, c0, csize), p += csize;
+    memcpy(p, c1, csize), p += csize;
+    put_value(p, code);
+}
+
+void
+gx_shading_tess_record_linear_triangle(gx_shading_tess_t *tess,
+        const gs_fill_attributes *fa,
+        const gs_fixed_point *p0, const gs_fixed_point *p1,
+        const gs_fixed_point *p2,
+        const frac31 *c0, const frac31 *c1, const frac31 *c2, int code)
+{
+    size_t csize = sizeof(frac31) * tess->num_values;
+    byte *p = shading_tess_reserve(tess, 2 + attributes_size(false) +
+                                   3 * sizeof(gs_fixed_point) +
+                                   (c1 ? 3 : 2) * csize + sizeof(code));
+
+    if (p == 0)
+        return;
+    *p++ = tess_op_linear_triangle;
+    p = shading_tess_put_attributes(p, fa, false);
+    put_value(p, *p0);
+    put_value(p, *p1);
+    put_value(p, *p2);
+    *p++ = (c1 != 0);
+    memcpy(p, c0, csize), p += csize;
+    if (c1)
+        memcpy(p, c1, csize), p += csize;
+    memcpy(p, c2, csize), p += csize;
+    put_value(p, code);
+}
+
+/* ------ Replaying ------ */
+
+/*
+ * Make the recorded device calls. Return 0 if they have all been made,
+ * 1 if a device call didn't return what it returned when the fill was
+ * recorded, in which case the rest of the recording no longer follows
+ * and the remaining calls aren't made, or an error code.
+ */
+static int
+shading_tess_replay(patch_fill_state_t *pfs, const shading_tess_entry *e)
+{
+    gx_device *dev = pfs->dev;
+    const byte *p = shading_tess_entry_data(e);
+    const byte *end = p + e->size;
+    size_t csize = sizeof(frac31) * e->num_values;
+    frac31 fc[3][GX_DEVICE_COLOR_MAX_COMPONENTS];
+    gx_device_color dc;
+    gs_fill_attributes fa;
+    gs_fixed_rect clip;
+    gs_fixed_edge le, re;
+    gs_fixed_point pt[4];
+    fixed ybot, ytop;
+    int code = 0, recorded;
+    bool swap_axes, devn, have_c1;
+
+    memset(fc, 0, sizeof(fc));
+    memset(&dc, 0, sizeof(dc));
+    fa.clip = &clip;
+    fa.ht = NULL;
+    fa.lop = 0;
+    fa.ystart = fa.yend = 0;
+    fa.pfs = NULL;
+    while (p < end && code >= 0) {
+        switch (*p++) {
+            case tess_op_trapezoid:
+                get_value(le, p);
+                get_value(re, p);
+                get_value(ybot, p);
+                get_value(ytop, p);
+                swap_axes = *p++;
+                devn = *p++;
+                get_value(dc.tag, p);
+                if (devn) {
+                    dc.type = gx_dc_type_devn;
+                    memcpy(dc.colors.devn.values, p,
+                           sizeof(ushort) * e->num_values);
+                    p += sizeof(ushort) * e->num_values;
+                } else {
+                    dc.type = gx_dc_type_pure;
+                    get_value(dc.colors.pure, p);
+                }
+                code = dev_proc(dev, fill_trapezoid)(dev, &le, &re,
+                                ybot, ytop, swap_axes, &dc, pfs->pgs->log_op);
+                break;
+            case tess_op_linear_trapezoid:
+                get_value(clip, p);
+                fa.swap_axes = *p++;
+                get_value(fa.ystart, p);
+                get_value(fa.yend, p);
+                get_value(pt[0], p);
+                get_value(pt[1], p);
+                get_value(pt[2], p);
+                get_value(pt[3], p);
+                memcpy(fc[0], p, csize), p += csize;
+                memcpy(fc[1], p, csize), p += csize;
+                get_value(recorded, p);
+                code = dev_proc(dev, fill_linear_color_trapezoid)(dev, &fa,
+                                &pt[0], &pt[1], &pt[2], &pt[3],
+                                fc[0], fc[1], NULL, NULL);
+                if (code >= 0 && code != recorded)
+                    return 1;
+                break;
+            case tess_op_linear_triangle:
+                get_value(clip, p);
+                fa.swap_axes = *p++;
+                get_value(pt[0], p);
+                get_value(pt[1], p);
+                get_value(pt[2], p);
+                have_c1 = *p++;
+                memcpy(fc[0], p, csize), p += csize;
+                if (have_c1)
+                    memcpy(fc[1], p, csize), p += csize;
+                memcpy(fc[2], p, csize), p += csize;
+                get_value(recorded, p);
+                code = dev_proc(dev, fill_linear_color_triangle)(dev, &fa,
+                                &pt[0], &pt[1], &pt[2],
+                                fc[0], (have_c1 ? fc[1] : NULL), fc[2]);
+                if (code >= 0 && code != recorded)
+                    return 1;
+                break;
+            default:
+                return 1;	/* Must not happen. */
+        }
+    }
+    return (code < 0 ? code : 0);
+}
+
+/* ------ Public procedures ------ */
+
+int
+gx_shading_tess_begin(patch_fill_state_t *pfs, const gs_shading_mesh_t *psh)
+{
+    shading_tess_cache *cache;
+    shading_tess_entry *e;
+    gx_shading_tess_t *tess;
+    byte digest[16];
+    size_t max_size;
+    bool free_entry;
+    int code;
+
+    pfs->tess = NULL;
+    if (pfs->vectorization || pfs->pgs->overprint)
+        return 0;
+    /* A device that wants the outline of the patches isn't given it here. */
+    if (dev_proc(pfs->dev, dev_spec_op)(pfs->dev,
+            gxdso_pattern_shading_area, NULL, 0) > 0)
+        return 0;
+    cache = shading_tess_get_cache(pfs->pgs->memory);
+    if (cache == 0)
+        return 0;
+    gx_monitor_enter(cache->lock);
+    max_size = cache->max_size;
+    gx_monitor_leave(cache->lock);
+    if (max_size == 0 || !shading_tess_digest(pfs, psh, digest))
+        return 0;
+
+    gx_monitor_enter(cache->lock);
+    e = shading_tess_find(cache, digest);
+    if (e != 0) {
+        shading_tess_unlink_used(cache, e);
+        shading_tess_link_used(cache, e);
+        e->refs++;
+    }
+    gx_monitor_leave(cache->lock);
+    if (e != 0) {
+        if_debug1('2', "[2]shading decomposition from the cache, %"PRIdSIZE" bytes\n",
+                  e->size);
+        code = shading_tess_replay(pfs, e);
+        gx_monitor_enter(cache->lock);
+        /* A recording that no longer replays is of no further use. */
+        if (code == 1 && !e->removed)
+            shading_tess_remove(cache, e);
+        free_entry = (--e->refs == 0 && e->removed);
+        gx_monitor_leave(cache->lock);
+        if (free_entry)
+            gs_free_object(cache->memory, e, "gx_shading_tess_begin");
+        if (code == 1) {
+            /*
+             * Decompose the shading afresh, without recording it. The
+             * calls already made are the first ones the decomposition
+             * makes, with the same arguments, so they paint the same
+             * pixels again.
+             */
+            if_debug0('2', "[2]shading decomposition replay abandoned\n");
+            return 0;
+        }
+        return (code < 0 ? code : 1);
+    }
+
+    tess = (gx_shading_tess_t *)gs_alloc_bytes(cache->memory, sizeof(*tess),
+                                               "gx_shading_tess_begin");
+    if (tess == 0)
+        return 0;
+    memset(tess, 0, sizeof(*tess));
+    tess->cache = cache;
+    memcpy(tess->digest, digest, sizeof(digest));
+    tess->num_values = max(pfs->dev->color_info.num_components,
+                           pfs->trans_device->color_info.num_components);
+    tess->max_entry = SHADING_TESS_MAX_ENTRY(max_size);
+    pfs->tess = tess;
+    return 0;
+}
+
+int
+gx_shading_tess_end(patch_fill_state_t *pfs, int code)
+{
+    gx_shading_tess_t *tess = pfs->tess;
+    shading_tess_cache *cache;
+    shading_tess_entry *e, *old;
+
+    if (tess == NULL)
+        return code;
+    pfs->tess = NULL;
+    cache = tess->cache;
+    if (code >= 0 && !tess->failed) {
+        e = (shading_tess_entry *)gs_alloc_bytes(cache->memory,
+                                                 sizeof(*e) + tess->size,
+                                                 "gx_shading_tess_end");
+        if (e != 0) {
+            memset(e, 0, sizeof(*e));
+            memcpy(e->digest, tess->digest, sizeof(e->digest));
+            e->num_values = tess->num_values;
+            e->size = tess->size;
+            if (tess->size)
+                memcpy(shading_tess_entry_data(e), tess->data, tess->size);
+            gx_monitor_enter(cache->lock);
+            /* Another thread may have recorded the same fill. */
+            old = shading_tess_find(cache, e->digest);
+            if (old != 0)
+                shading_tess_remove(cache, old);
+            /* The size may have been reduced while recording. */
+            if (sizeof(*e) + e->size > SHADING_TESS_MAX_ENTRY(cache->max_size) ||
+                shading_tess_hash_add(cache, e) < 0) {
+                gs_free_object(cache->memory, e, "gx_shading_tess_end");
+            } else {
+                shading_tess_link_used(cache, e);
+                cache->used += sizeof(*e) + e->size;
+                shading_tess_trim(cache);
+            }
+            gx_monitor_leave(cache->lock);
+        }
+    }
+    gs_free_object(cache->memory, tess->data, "gx_shading_tess_end");
+    gs_free_object(cache->memory, tess, "gx_shading_tess_end");
+    return code;
+}
@@ -0,0 +1,83 @@
+/* Copyright (C) 2001-2026 Artifex Software, Inc.
+   All Rights Reserved.
+
+   This software is provided AS-IS with no warranty, either express or
+   implied.
+
+   This software is distributed under license and may not be copied,
+   modified or distributed except as expressly authorized under the terms
+   of the license contained in the file LICENSE in this distribution.
+
+   Refer to licensing information at http://www.artifex.com or contact
+   Artifex Software, Inc.,  1305 Grant Avenue - Suite 200, Novato,
+   CA 94945, U.S.A., +1(415)492-9861, for further information.
+*/
+
+
+/* Cache of patch mesh shading decompositions */
+/* Requires gxshade4.h */
+
+#ifndef gxshtess_INCLUDED
+#  define gxshtess_INCLUDED
+
+#include "gxshade4.h"
+
+/*
+ * Coons and tensor product patch shadings are subdivided down to
+ * trapezoids and linear color triangles each time they are filled.
+ * Documents often fill the same shading many times (on every page, or
+ * in each cell of a pattern), so each instance keeps a cache of the
+ * device calls a fill made, and a fill that would make the same calls
+ * again replays them instead of running the subdivision.
+ *
+ * Entries are keyed by an MD5 digest of everything the subdivision
+ * depends on: the shading dictionary and its data, the function, the
+ * ICC link, the CTM, the clipping box, the flatness and smoothness,
+ * the color mapping of the graphics state, and the color model and
+ * procedures of the device. Only decompositions into pure and DeviceN
+ * colors are kept, so fills rendered through a halftone aren't cached.
+ * Entries are found through a hash table on the digest, and discarded
+ * least recently used first.
+ *
+ * The default size of the cache is set at compile time with
+ * SHADING_TESS_CACHE_SIZE, and may be changed at run time (the
+ * MaxShadingCache user parameter); 0 disables it.
+ */
+
+/* Set or return the size of the cache of mem's instance. */
+int gx_shading_tess_set_max_size(const gs_memory_t *mem, size_t size);
+size_t gx_shading_tess_max_size(const gs_memory_t *mem);
+
+/*
+ * Start a fill of a Coons or tensor product patch shading, after
+ * init_patch_fill_state. Return 1 if the fill has been done from the
+ * cache, 0 if the caller must do it. In the latter case the fill may be
+ * recorded through pfs->tess. If the device doesn't respond to a replay
+ * as it did to the recording, the replay is abandoned, the entry is
+ * discarded and 0 is returned.
+ */
+int gx_shading_tess_begin(patch_fill_state_t *pfs, const gs_shading_mesh_t *psh);
+
+/*
+ * Finish a fill started with gx_shading_tess_begin; code is the result
+ * of the fill. A complete recording is added to the cache. Return code.
+ */
+int gx_shading_tess_end(patch_fill_state_t *pfs, int code);
+
+/* Record the device calls made while filling. */
+void gx_shading_tess_record_trapezoid(gx_shading_tess_t *tess,
+        const gs_fixed_edge *le, const gs_fixed_edge *re,
+        fixed ybot, fixed ytop, bool swap_axes,
+        const gx_device_color *pdevc);
+void gx_shading_tess_record_linear_trapezoid(gx_shading_tess_t *tess,
+        const gs_fill_attributes *fa,
+        const gs_fixed_point *p0, const gs_fixed_point *p1,
+        const gs_fixed_point *p2, const gs_fixed_point *p3,
+        const frac31 *c0, const frac31 *c1, int code);
+void gx_shading_tess_record_linear_triangle(gx_shading_tess_t *tess,
+        const gs_fill_attributes *fa,
+        const gs_fixed_point *p0, const gs_fixed_point *p1,
+        const gs_fixed_point *p2,
+        const frac31 *c0, const frac31 *c1, const frac31 *c2, int code);
+
+#endif /* gxshtess_INCLUDED */
@@ -291,12 +291,13 @@ run_len_0_n0_read:
                     *++q = 257+run_len; /* Repeated run */
                     *++q = n0;
                     run_len = 0;
-                    if (p == rlimit)
-                        rlimit = p + ss->record_size;
                     if (n0 != n1) {
+                        /* n1 starts the next run, and may end the record */
                         n0 = n1;
                         goto run_len_0_n0_read;
                     }
+                    if (p == rlimit)
+                        rlimit = p + ss->record_size;
                 }
             }
         }
@@ -250,6 +250,7 @@ const gx_device_bit gs_bitrgbtags_device =
         0,  /*band_offset_x*/
         0,  /*band_offset_y*/
         false, /*BLS_force_memory*/
+        false, /*BLS_compress*/
         {false}, /*sgr*/
         0, /*MaxPatternBitmap*/
         0, /*page_uses_transparency*/
@@ -288,7 +289,10 @@ const gx_device_bit gs_bitrgbtags_device =
         NULL,  /* file */
         false, /* bg_print_requested */
         0,     /* bg_print *  */
+        1,     /* bg_print_pages_requested */
+        0,     /* bg_print_max_bytes */
         0,     /* num_render_threads_requested */
+        1,     /* band_buffers_per_thread */
         NULL,  /* saved_pages_list */
         {0}    /* save_procs_while_delaying_erasepage */
     };
@@ -22,6 +22,8 @@
 #include "sdct.h"
 #include "sjpeg.h"
 #include "gxdownscale.h"
+#include "gxdevsop.h"
+#include "gxgetbit.h"
 
 /* Structure for the JPEG-writing device. */
 typedef struct gx_device_jpeg_s {
@@ -47,6 +49,7 @@ typedef struct gx_device_jpeg_s {
 static dev_proc_get_params(jpeg_get_params);
 static dev_proc_get_initial_matrix(jpeg_get_initial_matrix);
 static dev_proc_put_params(jpeg_put_params);
+static dev_proc_dev_spec_op(jpeg_dev_spec_op);
 static dev_proc_print_page(jpeg_print_page);
 static dev_proc_map_color_rgb(jpegcmyk_map_color_rgb);
 static dev_proc_map_cmyk_color(jpegcmyk_map_cmyk_color);
@@ -72,6 +75,7 @@ jpeg_initialize_device_procs(gx_device *dev)
     set_dev_proc(dev, get_initial_matrix, jpeg_get_initial_matrix);
     set_dev_proc(dev, get_params, jpeg_get_params);
     set_dev_proc(dev, put_params, jpeg_put_params);
+    set_dev_proc(dev, dev_spec_op, jpeg_dev_spec_op);
 }
 
 const gx_device_jpeg gs_jpeg_device =
@@ -95,6 +99,7 @@ jpeggray_initialize_device_procs(gx_device *dev)
     set_dev_proc(dev, get_initial_matrix, jpeg_get_initial_matrix);
     set_dev_proc(dev, get_params, jpeg_get_params);
     set_dev_proc(dev, put_params, jpeg_put_params);
+    set_dev_proc(dev, dev_spec_op, jpeg_dev_spec_op);
     set_dev_proc(dev, encode_color, gx_default_8bit_map_gray_color);
     set_dev_proc(dev, decode_color, gx_default_8bit_map_color_gray);
 }
@@ -123,6 +128,7 @@ jpegcmyk_initialize_device_procs(gx_device *dev)
     set_dev_proc(dev, map_color_rgb, jpegcmyk_map_color_rgb);
     set_dev_proc(dev, get_params, jpeg_get_params);
     set_dev_proc(dev, put_params, jpeg_put_params);
+    set_dev_proc(dev, dev_spec_op, jpeg_dev_spec_op);
     set_dev_proc(dev, map_cmyk_color, jpegcmyk_map_cmyk_color);
 
     set_dev_proc(dev, encode_color, jpegcmyk_map_cmyk_color);
@@ -313,6 +319,27 @@ jpeg_put_params(gx_device * dev, gs_param_list * plist)
     return 0;
 }
 
+/* The largest MCU the IJG library uses by default (2x2 subsampled YCbCr) */
+#define JPEG_MAX_MCU_HEIGHT 16
+
+static int
+jpeg_dev_spec_op(gx_device *dev, int dev_spec_op, void *data, int size)
+{
+    gx_device_jpeg *jdev = (gx_device_jpeg *)dev;
+
+    if (dev_spec_op == gxdso_adjust_bandheight) {
+        /* Start every band, once downscaled, on an MCU row, so that bands
+         * can be compressed separately (see jpeg_print_page_bands). */
+        int up, down;
+
+        gx_downscaler_decode_factor(jdev->downscale.downscale_factor, &up, &down);
+        if (size >= JPEG_MAX_MCU_HEIGHT * down)
+            return size / (JPEG_MAX_MCU_HEIGHT * down) * (JPEG_MAX_MCU_HEIGHT * down);
+        return gx_downscaler_adjust_bandheight(jdev->downscale.downscale_factor, size);
+    }
+    return gdev_prn_dev_spec_op(dev, dev_spec_op, data, size);
+}
+
 /******************************************************************
  This device supports translation and scaling.
 
@@ -390,78 +417,61 @@ jpeg_get_initial_matrix(gx_device *dev, gs_matrix *pmat)
 
 }
 
-/* Send the page to the file. */
+/* Create a DCT encoder state for the device, with its ICC profile if asked. */
 static int
-jpeg_print_page(gx_device_printer * pdev, gp_file * prn_stream)
+jpeg_create_encoder(gx_device_jpeg *jdev, gs_memory_t *mem,
+                    stream_DCT_state *state, jpeg_compress_data *jcdp,
+                    bool with_profile)
 {
-    gx_device_jpeg *jdev = (gx_device_jpeg *) pdev;
-    gs_memory_t *mem = pdev->memory;
-    int line_size = gdev_mem_bytes_per_scan_line((gx_device *) pdev);
-    byte *in = gs_alloc_bytes(mem, line_size, "jpeg_print_page(in)");
-    jpeg_compress_data *jcdp = gs_alloc_struct_immovable(mem, jpeg_compress_data,
-      &st_jpeg_compress_data, "jpeg_print_page(jpeg_compress_data)");
-    byte *fbuf = 0;
-    uint fbuf_size;
-    byte *jbuf = 0;
-    uint jbuf_size;
-    int lnum;
+    gx_device_printer *pdev = (gx_device_printer *)jdev;
     int code;
-    stream_DCT_state state;
-    stream fstrm, jstrm;
-    gx_downscaler_t ds;
-
-    if (jcdp == 0 || in == 0) {
-        code = gs_note_error(gs_error_VMerror);
-        goto fail;
-    }
-    code = gx_downscaler_init(&ds, (gx_device *)jdev, 8, 8,
-                              jdev->color_info.depth/8,
-                              &jdev->downscale, NULL, 0);
-    if (code < 0) {
-        gs_free_object(mem, jcdp, "jpeg_print_page(jpeg_compress_data)");
-        jcdp = NULL;
-        goto fail;
-    }
 
-    /* Create the DCT encoder state. */
     jcdp->templat = s_DCTE_template;
-    s_init_state((stream_state *)&state, &jcdp->templat, 0);
-    if (state.templat->set_defaults) {
-        state.memory = mem;
-        (*state.templat->set_defaults) ((stream_state *) & state);
-        state.memory = NULL;
+    s_init_state((stream_state *)state, &jcdp->templat, 0);
+    if (state->templat->set_defaults) {
+        state->memory = mem;
+        (*state->templat->set_defaults) ((stream_state *) state);
+        state->memory = NULL;
     }
-    state.QFactor = 1.0;	/* disable quality adjustment in zfdcte.c */
-    state.ColorTransform = 1;	/* default for RGB */
+    state->QFactor = 1.0;	/* disable quality adjustment in zfdcte.c */
+    state->ColorTransform = 1;	/* default for RGB */
     /* We insert no markers, allowing the IJG library to emit */
     /* the format it thinks best. */
-    state.NoMarker = true;	/* do not insert our own Adobe marker */
-    state.Markers.data = 0;
-    state.Markers.size = 0;
-    state.data.compress = jcdp;
+    state->NoMarker = true;	/* do not insert our own Adobe marker */
+    state->Markers.data = 0;
+    state->Markers.size = 0;
+    state->data.compress = jcdp;
     /* Add in ICC profile */
-    state.icc_profile = NULL; /* In case it is not set here */
-    if (pdev->icc_struct != NULL &&
+    state->icc_profile = NULL; /* In case it is not set here */
+    if (with_profile && pdev->icc_struct != NULL &&
         pdev->icc_struct->device_profile[GS_DEFAULT_DEVICE_PROFILE] != NULL) {
         cmm_profile_t *icc_profile = pdev->icc_struct->device_profile[GS_DEFAULT_DEVICE_PROFILE];
         if (icc_profile->num_comps == pdev->color_info.num_components &&
             !(pdev->icc_struct->usefastcolor)) {
-            state.icc_profile = icc_profile;
+            state->icc_profile = icc_profile;
         }
     }
-    /* We need state.memory for gs_jpeg_create_compress().... */
-    jcdp->memory = state.jpeg_memory = state.memory = mem;
-    if ((code = gs_jpeg_create_compress(&state)) < 0)
-    {
-        gx_downscaler_fin(&ds);
-        goto fail;
-    }
+    /* We need state->memory for gs_jpeg_create_compress().... */
+    jcdp->memory = state->jpeg_memory = state->memory = mem;
+    code = gs_jpeg_create_compress(state);
     /* ....but we need it to be NULL so we don't try to free
      * the stack based state...
      */
-    state.memory = NULL;
+    state->memory = NULL;
+    return code;
+}
+
+/* Set the compression parameters for an image of the given height. */
+static int
+jpeg_set_encoder_params(gx_device_jpeg *jdev, stream_DCT_state *state,
+                        int height)
+{
+    gx_device_printer *pdev = (gx_device_printer *)jdev;
+    jpeg_compress_data *jcdp = state->data.compress;
+    int code;
+
     jcdp->cinfo.image_width = gx_downscaler_scale(pdev->width, jdev->downscale.downscale_factor);
-    jcdp->cinfo.image_height = gx_downscaler_scale(pdev->height, jdev->downscale.downscale_factor);
+    jcdp->cinfo.image_height = height;
     switch (pdev->color_info.depth) {
         case 32:
             jcdp->cinfo.input_components = 4;
@@ -477,19 +487,19 @@ jpeg_print_page(gx_device_printer * pdev, gp_file * prn_stream)
             break;
     }
     /* Set compression parameters. */
-    if ((code = gs_jpeg_set_defaults(&state)) < 0)
-        goto done;
+    if ((code = gs_jpeg_set_defaults(state)) < 0)
+        return code;
     if (jdev->JPEGQ > 0) {
-        code = gs_jpeg_set_quality(&state, jdev->JPEGQ, TRUE);
+        code = gs_jpeg_set_quality(state, jdev->JPEGQ, TRUE);
         if (code < 0)
-            goto done;
+            return code;
     } else if (jdev->QFactor > 0.0) {
-        code = gs_jpeg_set_linear_quality(&state,
+        code = gs_jpeg_set_linear_quality(state,
                                           (int)(min(jdev->QFactor, 100.0)
                                                 * 100.0 + 0.5),
                                           TRUE);
         if (code < 0)
-            goto done;
+            return code;
     }
     jcdp->cinfo.restart_interval = 0;
     jcdp->cinfo.density_unit = 1;	/* dots/inch (no #define or enum) */
@@ -497,13 +507,316 @@ jpeg_print_page(gx_device_printer * pdev, gp_file * prn_stream)
     jcdp->cinfo.Y_density = (UINT16)pdev->HWResolution[1];
     /* Create the filter. */
     /* Make sure we get at least a full scan line of input. */
-    state.scan_line_size = jcdp->cinfo.input_components *
+    state->scan_line_size = jcdp->cinfo.input_components *
         jcdp->cinfo.image_width;
     jcdp->templat.min_in_size =
-        max(s_DCTE_template.min_in_size, state.scan_line_size);
+        max(s_DCTE_template.min_in_size, state->scan_line_size);
     /* Make sure we can write the user markers in a single go. */
     jcdp->templat.min_out_size =
-        max(s_DCTE_template.min_out_size, state.Markers.size);
+        max(s_DCTE_template.min_out_size, state->Markers.size);
+    return 0;
+}
+
+/* ------ Compressing bands on the rendering threads ------ */
+
+/*
+ * When the page is rendered by several threads, each band is compressed
+ * on the thread that rendered it, as a JPEG of its own with a restart
+ * marker after every MCU row. Bands start on MCU rows (see
+ * jpeg_dev_spec_op), so the output function can join the bands' entropy
+ * coded data into one baseline JPEG, with the headers of the first band
+ * and a restart marker between bands, renumbering the restart markers as
+ * it goes. The result decodes to exactly the same pixels as the JPEG
+ * written by one thread.
+ */
+
+typedef struct jpeg_band_writer_s {
+    gx_device_jpeg *jdev;
+    gp_file *file;
+    int height;                 /* of the image */
+} jpeg_band_writer;
+
+typedef struct jpeg_band_buffer_s {
+    gs_memory_t *memory;
+    int y;                      /* first row of the band */
+    int rows;
+    int mcu_height;
+    byte *in;                   /* the band's rows */
+    byte *data;                 /* the band's JPEG */
+    uint size;
+    uint used;
+} jpeg_band_buffer;
+
+static void
+jpeg_bands_free_buffer(void *arg, gx_device *dev, gs_memory_t *mem,
+                       void *buffer)
+{
+    jpeg_band_buffer *buf = (jpeg_band_buffer *)buffer;
+
+    if (buf == NULL)
+        return;
+    gs_free_object(mem, buf->data, "jpeg_bands_free_buffer");
+    gs_free_object(mem, buf->in, "jpeg_bands_free_buffer");
+    gs_free_object(mem, buf, "jpeg_bands_free_buffer");
+}
+
+static int
+jpeg_bands_init_buffer(void *arg, gx_device *dev, gs_memory_t *mem,
+                       int w, int h, void **pbuffer)
+{
+    jpeg_band_buffer *buf;
+    uint in_size = w * dev->color_info.num_components * h;
+
+    buf = (jpeg_band_buffer *)gs_alloc_bytes(mem, sizeof(*buf),
+                                             "jpeg_bands_init_buffer");
+    *pbuffer = buf;
+    if (buf == NULL)
+        return_error(gs_error_VMerror);
+    memset(buf, 0, sizeof(*buf));
+    buf->memory = mem;
+    /* Compressed bands are rarely a quarter of their size; the ICC
+     * profile goes in the first band. */
+    buf->size = in_size / 4 + 65536;
+    buf->in = gs_alloc_bytes(mem, in_size, "jpeg_bands_init_buffer");
+    buf->data = gs_alloc_bytes(mem, buf->size, "jpeg_bands_init_buffer");
+    if (buf->in == NULL || buf->data == NULL) {
+        jpeg_bands_free_buffer(arg, dev, mem, buf);
+        *pbuffer = NULL;
+        return_error(gs_error_VMerror);
+    }
+    return 0;
+}
+
+static int
+jpeg_band_reserve(jpeg_band_buffer *buf, uint count)
+{
+    byte *data;
+    uint size;
+
+    if (buf->size - buf->used >= count)
+        return 0;
+    size = max(buf->size * 2, buf->used + count);
+    data = gs_alloc_bytes(buf->memory, size, "jpeg_band_reserve");
+    if (data == NULL)
+        return_error(gs_error_VMerror);
+    memcpy(data, buf->data, buf->used);
+    gs_free_object(buf->memory, buf->data, "jpeg_band_reserve");
+    buf->data = data;
+    buf->size = size;
+    return 0;
+}
+
+/* Called on a rendering thread with one (downscaled) band. */
+static int
+jpeg_bands_process(void *arg, gx_device *dev, gx_device *bdev,
+                   const gs_int_rect *rect, void *buffer)
+{
+    jpeg_band_writer *jw = (jpeg_band_writer *)arg;
+    jpeg_band_buffer *buf = (jpeg_band_buffer *)buffer;
+    gs_memory_t *mem = buf->memory;
+    jpeg_compress_data *jcdp;
+    stream_DCT_state state;
+    stream_cursor_read r;
+    stream_cursor_write w;
+    gs_get_bits_params_t params;
+    gs_int_rect row_rect;
+    int status = 0;
+    int row, i, code;
+
+    buf->y = rect->p.y;
+    buf->rows = min(rect->q.y, jw->height) - rect->p.y;
+    buf->used = 0;
+    if (buf->rows <= 0)
+        return 0;
+
+    jcdp = gs_alloc_struct_immovable(mem, jpeg_compress_data,
+                &st_jpeg_compress_data, "jpeg_bands_process(jpeg_compress_data)");
+    if (jcdp == NULL)
+        return_error(gs_error_VMerror);
+    code = jpeg_create_encoder(jw->jdev, mem, &state, jcdp, buf->y == 0);
+    if (code < 0) {
+        gs_free_object(mem, jcdp, "jpeg_bands_process(jpeg_compress_data)");
+        return code;
+    }
+    code = jpeg_set_encoder_params(jw->jdev, &state, buf->rows);
+    if (code < 0)
+        goto done;
+    jcdp->cinfo.restart_in_rows = 1;
+    buf->mcu_height = 1;
+    for (i = 0; i < jcdp->cinfo.num_components; i++)
+        buf->mcu_height = max(buf->mcu_height,
+                              jcdp->cinfo.comp_info[i].v_samp_factor);
+    buf->mcu_height *= DCTSIZE;
+
+    row_rect.p.x = 0;
+    row_rect.q.x = rect->q.x - rect->p.x;
+    for (row = 0; row < buf->rows; row++) {
+        row_rect.p.y = row;
+        row_rect.q.y = row + 1;
+        params.options = GB_COLORS_NATIVE | GB_ALPHA_NONE |
+            GB_PACKING_CHUNKY | GB_RETURN_POINTER | GB_ALIGN_ANY |
+            GB_OFFSET_0 | GB_RASTER_ANY;
+        code = dev_proc(bdev, get_bits_rectangle)(bdev, &row_rect, &params);
+        if (code < 0)
+            goto done;
+        memcpy(buf->in + row * state.scan_line_size, params.data[0],
+               state.scan_line_size);
+    }
+
+    if (state.templat->init)
+        (*state.templat->init) ((stream_state *)&state);
+    r.ptr = buf->in - 1;
+    r.limit = r.ptr + buf->rows * state.scan_line_size;
+    do {
+        code = jpeg_band_reserve(buf, max(4096, buf->size / 4));
+        if (code < 0)
+            goto done;
+        w.ptr = buf->data + buf->used - 1;
+        w.limit = buf->data + buf->size - 1;
+        status = state.templat->process((stream_state *)&state, &r, &w, true);
+        buf->used = w.ptr + 1 - buf->data;
+    } while (status == 1);
+    if (status != EOFC)
+        code = gs_note_error(gs_error_ioerror);
+  done:
+    gs_jpeg_destroy(&state);
+    gs_free_object(mem, jcdp, "jpeg_bands_process(jpeg_compress_data)");
+    return code;
+}
+
+/* Called in band order with the band's JPEG. */
+static int
+jpeg_bands_output(void *arg, gx_device *dev, void *buffer)
+{
+    jpeg_band_writer *jw = (jpeg_band_writer *)arg;
+    jpeg_band_buffer *buf = (jpeg_band_buffer *)buffer;
+    byte *data = buf->data;
+    uint pos = 2, end = buf->used - 2;
+    int mcu_row = buf->y / buf->mcu_height;
+    int restart = mcu_row;
+    byte marker[2];
+    uint i;
+
+    if (buf->rows <= 0)
+        return 0;
+    /* Skip the headers, patching the image height in the frame header. */
+    if (buf->used < 4 || data[0] != 0xff || data[1] != 0xd8 /* SOI */ ||
+        data[end] != 0xff || data[end + 1] != 0xd9 /* EOI */)
+        return_error(gs_error_ioerror);
+    for (;;) {
+        byte code;
+
+        if (pos + 4 > end || data[pos] != 0xff)
+            return_error(gs_error_ioerror);
+        code = data[pos + 1];
+        if (code >= 0xc0 && code <= 0xc2 /* SOF0..2 */ && pos + 7 <= end) {
+            data[pos + 5] = (byte)(jw->height >> 8);
+            data[pos + 6] = (byte)jw->height;
+        }
+        pos += 2 + ((data[pos + 2] << 8) | data[pos + 3]);
+        if (code == 0xda /* SOS */)
+            break;
+    }
+    if (buf->y == 0) {
+        if (gp_fwrite(data, 1, pos, jw->file) != pos)
+            return_error(gs_error_ioerror);
+    } else {
+        marker[0] = 0xff;
+        marker[1] = 0xd0 /* RST0 */ + ((mcu_row - 1) & 7);
+        if (gp_fwrite(marker, 1, 2, jw->file) != 2)
+            return_error(gs_error_ioerror);
+    }
+    /* Stuffed 0xff bytes are followed by 0, so the only markers in the
+     * entropy coded data are restarts. */
+    for (i = pos; i + 1 < end; i++)
+        if (data[i] == 0xff && data[i + 1] >= 0xd0 && data[i + 1] <= 0xd7)
+            data[++i] = 0xd0 + (restart++ & 7);
+    if (buf->y + buf->rows >= jw->height)
+        end += 2;		/* the last band keeps its EOI */
+    if (gp_fwrite(data + pos, 1, end - pos, jw->file) != end - pos)
+        return_error(gs_error_ioerror);
+    return 0;
+}
+
+static int
+jpeg_print_page_bands(gx_device_printer *pdev, gp_file *prn_stream)
+{
+    gx_device_jpeg *jdev = (gx_device_jpeg *)pdev;
+    gx_process_page_options_t process = { 0 };
+    jpeg_band_writer jw;
+
+    jw.jdev = jdev;
+    jw.file = prn_stream;
+    jw.height = gx_downscaler_scale(pdev->height, jdev->downscale.downscale_factor);
+
+    process.init_buffer_fn = jpeg_bands_init_buffer;
+    process.free_buffer_fn = jpeg_bands_free_buffer;
+    process.process_fn = jpeg_bands_process;
+    process.output_fn = jpeg_bands_output;
+    process.arg = &jw;
+    return gx_downscaler_process_page((gx_device *)pdev, &process,
+                                      jdev->downscale.downscale_factor);
+}
+
+/* Send the page to the file. */
+static int
+jpeg_print_page(gx_device_printer * pdev, gp_file * prn_stream)
+{
+    gx_device_jpeg *jdev = (gx_device_jpeg *) pdev;
+    gs_memory_t *mem = pdev->memory;
+    int line_size = gdev_mem_bytes_per_scan_line((gx_device *) pdev);
+    byte *in;
+    jpeg_compress_data *jcdp;
+    byte *fbuf = 0;
+    uint fbuf_size;
+    byte *jbuf = 0;
+    uint jbuf_size;
+    int lnum;
+    int code;
+    stream_DCT_state state;
+    stream fstrm, jstrm;
+    gx_downscaler_t ds;
+
+    if (PRINTER_IS_CLIST(pdev) && pdev->num_render_threads_requested > 0) {
+        int band_height =
+            ((gx_device_clist_common *)pdev)->page_info.band_params.BandHeight;
+        int up, down;
+
+        gx_downscaler_decode_factor(jdev->downscale.downscale_factor, &up, &down);
+        /* The band downscaler picks its core from comp_bits, which the
+         * standard CMYK device body leaves unset. */
+        if ((up == down || pdev->color_info.comp_bits[0] == 8) &&
+            band_height < pdev->height && band_height % down == 0 &&
+            band_height * up / down % JPEG_MAX_MCU_HEIGHT == 0)
+            return jpeg_print_page_bands(pdev, prn_stream);
+    }
+
+    in = gs_alloc_bytes(mem, line_size, "jpeg_print_page(in)");
+    jcdp = gs_alloc_struct_immovable(mem, jpeg_compress_data,
+      &st_jpeg_compress_data, "jpeg_print_page(jpeg_compress_data)");
+    if (jcdp == 0 || in == 0) {
+        code = gs_note_error(gs_error_VMerror);
+        goto fail;
+    }
+    code = gx_downscaler_init(&ds, (gx_device *)jdev, 8, 8,
+                              jdev->color_info.depth/8,
+                              &jdev->downscale, NULL, 0);
+    if (code < 0) {
+        gs_free_object(mem, jcdp, "jpeg_print_page(jpeg_compress_data)");
+        jcdp = NULL;
+        goto fail;
+    }
+
+    /* Create the DCT encoder state. */
+    if ((code = jpeg_create_encoder(jdev, mem, &state, jcdp, true)) < 0)
+    {
+        gx_downscaler_fin(&ds);
+        goto fail;
+    }
+    code = jpeg_set_encoder_params(jdev, &state,
+                 gx_downscaler_scale(pdev->height, jdev->downscale.downscale_factor));
+    if (code < 0)
+        goto done;
 
     /* Set up the streams. */
     fbuf_size = max(512 /* arbitrary */ , jcdp->templat.min_out_size);
@@ -25,9 +25,14 @@
 #include "gdevprn.h"
 #include "minftrsz.h"
 #include "gxdownscale.h"
+#include "gxgetbit.h"
 #include "scommon.h"
 #include "stream.h"
 #include "strmio.h"
+#include "strimpl.h"
+#include "scfx.h"
+#include "slzwx.h"
+#include "srlx.h"
 #include "gsicc_cache.h"
 #include "gscms.h"
 #include "gstiffio.h"
@@ -452,6 +457,440 @@ int tiff_set_fields_for_printer(gx_device_printer *pdev,
     return 0;
 }
 
+/* ------ Compressing strips on the rendering threads ------ */
+
+/*
+ * When the page is rendered by several threads, the strips that lie
+ * within a band are compressed on the thread that rendered the band,
+ * with our own stream encoders rather than libtiff's codecs, and are
+ * handed to libtiff as raw strips in page order. The rows of a strip
+ * that straddles two bands are kept uncompressed until the second band
+ * is output, and the strip is compressed then.
+ * Only devices printing through tiff_print_page use this; tiffsep,
+ * tiffsep1 and the tiffscaled devices write their rows through the
+ * downscaler and still compress them on the output thread.
+ */
+
+typedef struct tiff_strip_buffer_s {
+    gs_memory_t *memory;
+    int first_strip;            /* first strip starting in the band */
+    int num_strips;             /* strips wholly within the band */
+    int head_rows;              /* rows ending the strip before first_strip */
+    int tail_rows;              /* rows starting the strip after the last */
+    bool page_end;
+    uint *strip_bytes;          /* [num_strips] */
+    byte *head;
+    byte *tail;
+    byte *in;                   /* uncompressed rows of one strip */
+    byte *data;                 /* compressed strips */
+    uint size;
+    uint used;
+} tiff_strip_buffer;
+
+typedef struct tiff_strip_writer_s {
+    TIFF *tif;
+    uint16 compression;
+    int width;                  /* in pixels, after AdjustWidth */
+    int src_bytes;              /* bytes per rendered row */
+    int row_bytes;              /* bytes per row in the file */
+    int rows_per_strip;
+    int max_strips;             /* per band */
+    bool swab16;
+    bool first_bit_low_order;
+    uint32 g3_options;          /* Group3Options */
+    int g3_k;                   /* rows per 1-D row with 2-D G3 coding */
+    tiff_strip_buffer *pending; /* the strip straddling the last band */
+    int pending_rows;
+} tiff_strip_writer;
+
+typedef union tiff_strip_stream_state_u {
+    stream_state st;
+    stream_CFE_state cfe;
+    stream_LZW_state lzw;
+    stream_RLE_state rle;
+} tiff_strip_stream_state;
+
+static bool
+tiff_strips_possible(gx_device_printer *dev, TIFF *tif, int bpc,
+                     int min_feature_size)
+{
+    uint16 compression;
+    uint32 rows_per_strip;
+    int band_height;
+
+    if (!PRINTER_IS_CLIST(dev) || dev->num_render_threads_requested < 1 ||
+        min_feature_size > 1 || (bpc != 1 && bpc != 8 && bpc != 16))
+        return false;
+    TIFFGetField(tif, TIFFTAG_COMPRESSION, &compression);
+    switch (compression) {
+        case COMPRESSION_NONE:
+        case COMPRESSION_PACKBITS:
+        case COMPRESSION_LZW:
+            break;
+        case COMPRESSION_CCITTRLE:
+        case COMPRESSION_CCITTFAX3:
+        case COMPRESSION_CCITTFAX4:
+            if (dev->color_info.depth != 1)
+                return false;
+            break;
+        default:
+            return false;
+    }
+    TIFFGetField(tif, TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+    band_height = ((gx_device_clist_common *)dev)->page_info.band_params.BandHeight;
+    return band_height > 0 && band_height < dev->height &&
+           rows_per_strip < dev->height;
+}
+
+static int
+tiff_strip_reserve(tiff_strip_buffer *buf, uint count)
+{
+    byte *data;
+    uint size;
+
+    if (buf->size - buf->used >= count)
+        return 0;
+    size = max(buf->size * 2, buf->used + count);
+    data = gs_alloc_bytes(buf->memory, size, "tiff_strip_reserve");
+    if (data == NULL)
+        return_error(gs_error_VMerror);
+    memcpy(data, buf->data, buf->used);
+    gs_free_object(buf->memory, buf->data, "tiff_strip_reserve");
+    buf->data = data;
+    buf->size = size;
+    return 0;
+}
+
+/*
+ * Compress the rows in buf->in onto the end of buf->data. Like libtiff,
+ * reverse the bits of the strip for FillOrder 2, except for the CCITT
+ * codings, which are produced in that order.
+ */
+static int
+tiff_compress_strip(const tiff_strip_writer *tw, tiff_strip_buffer *buf,
+                    int rows)
+{
+    uint count = rows * tw->row_bytes;
+    uint start = buf->used;
+    const stream_template *templat;
+    tiff_strip_stream_state ss;
+    stream_cursor_read r;
+    stream_cursor_write w;
+    int status, code;
+
+    if (tw->compression == COMPRESSION_NONE) {
+        code = tiff_strip_reserve(buf, count);
+        if (code < 0)
+            return code;
+        memcpy(buf->data + buf->used, buf->in, count);
+        buf->used += count;
+        if (tw->first_bit_low_order)
+            TIFFReverseBits(buf->data + start, count);
+        return 0;
+    }
+
+    switch (tw->compression) {
+        case COMPRESSION_PACKBITS:
+            templat = &s_RLE_template;
+            break;
+        case COMPRESSION_LZW:
+            templat = &s_LZWE_template;
+            break;
+        default:
+            templat = &s_CFE_template;
+            break;
+    }
+    s_init_state(&ss.st, templat, buf->memory);
+    templat->set_defaults(&ss.st);
+    switch (tw->compression) {
+        case COMPRESSION_PACKBITS:
+            /* Runs don't cross rows, and there is no EOD marker. */
+            ss.rle.record_size = tw->row_bytes;
+            ss.rle.omitEOD = true;
+            break;
+        case COMPRESSION_CCITTRLE:
+            /* 1-D coding, each row byte aligned, no EOLs or RTC. */
+            ss.cfe.K = 0;
+            ss.cfe.EncodedByteAlign = true;
+            ss.cfe.EndOfBlock = false;
+            break;
+        case COMPRESSION_CCITTFAX3:
+            /* An EOL before each row, aligned to end on a byte boundary
+             * with fill bits, and no RTC (libtiff's default Class F
+             * mode). libtiff starts each strip with a 1-D row, as we do. */
+            ss.cfe.K = tw->g3_options & GROUP3OPT_2DENCODING ? tw->g3_k : 0;
+            ss.cfe.EndOfLine = true;
+            ss.cfe.EncodedByteAlign = (tw->g3_options & GROUP3OPT_FILLBITS) != 0;
+            ss.cfe.EndOfBlock = false;
+            break;
+        case COMPRESSION_CCITTFAX4:
+            /* 2-D coding, ending with an EOFB, as libtiff does. */
+            ss.cfe.K = -1;
+            break;
+    }
+    if (templat == &s_CFE_template) {
+        /* libtiff codes 0 bits as white whatever the photometric. */
+        ss.cfe.Columns = tw->width;
+        ss.cfe.Rows = rows;
+        ss.cfe.BlackIs1 = true;
+        ss.cfe.FirstBitLowOrder = tw->first_bit_low_order;
+    }
+    if (templat->init(&ss.st) < 0)
+        return_error(gs_error_VMerror);
+
+    r.ptr = buf->in - 1;
+    r.limit = r.ptr + count;
+    do {
+        code = tiff_strip_reserve(buf, count / 2 + templat->min_out_size);
+        if (code < 0)
+            break;
+        w.ptr = buf->data + buf->used - 1;
+        w.limit = buf->data + buf->size - 1;
+        status = templat->process(&ss.st, &r, &w, true);
+        buf->used = w.ptr + 1 - buf->data;
+    } while (status == 1);
+    if (templat->release)
+        templat->release(&ss.st);
+    if (code >= 0 && status < 0 && status != EOFC)
+        code = gs_note_error(gs_error_ioerror);
+    if (code >= 0 && tw->first_bit_low_order && templat != &s_CFE_template)
+        TIFFReverseBits(buf->data + start, buf->used - start);
+    return code;
+}
+
+static void
+tiff_strips_free_buffer(void *arg, gx_device *dev, gs_memory_t *mem,
+                        void *buffer)
+{
+    tiff_strip_buffer *buf = (tiff_strip_buffer *)buffer;
+
+    if (buf == NULL)
+        return;
+    gs_free_object(mem, buf->data, "tiff_strips_free_buffer");
+    gs_free_object(mem, buf->in, "tiff_strips_free_buffer");
+    gs_free_object(mem, buf->tail, "tiff_strips_free_buffer");
+    gs_free_object(mem, buf->head, "tiff_strips_free_buffer");
+    gs_free_object(mem, buf->strip_bytes, "tiff_strips_free_buffer");
+    gs_free_object(mem, buf, "tiff_strips_free_buffer");
+}
+
+static int
+tiff_strips_init_buffer(void *arg, gx_device *dev, gs_memory_t *mem,
+                        int w, int h, void **pbuffer)
+{
+    tiff_strip_writer *tw = (tiff_strip_writer *)arg;
+    uint strip_size = tw->rows_per_strip * tw->row_bytes;
+    tiff_strip_buffer *buf;
+
+    buf = (tiff_strip_buffer *)gs_alloc_bytes(mem, sizeof(*buf),
+                                              "tiff_strips_init_buffer");
+    *pbuffer = buf;
+    if (buf == NULL)
+        return_error(gs_error_VMerror);
+    memset(buf, 0, sizeof(*buf));
+    buf->memory = mem;
+    buf->size = strip_size * tw->max_strips;
+    buf->strip_bytes = (uint *)gs_alloc_byte_array(mem, tw->max_strips,
+                                sizeof(uint), "tiff_strips_init_buffer");
+    buf->head = gs_alloc_bytes(mem, strip_size, "tiff_strips_init_buffer");
+    buf->tail = gs_alloc_bytes(mem, strip_size, "tiff_strips_init_buffer");
+    buf->in = gs_alloc_bytes(mem, strip_size, "tiff_strips_init_buffer");
+    buf->data = gs_alloc_bytes(mem, buf->size, "tiff_strips_init_buffer");
+    if (buf->strip_bytes == NULL || buf->head == NULL || buf->tail == NULL ||
+        buf->in == NULL || buf->data == NULL) {
+        tiff_strips_free_buffer(arg, dev, mem, buf);
+        *pbuffer = NULL;
+        return_error(gs_error_VMerror);
+    }
+    return 0;
+}
+
+/* Copy rows of a band as they are written to the file. */
+static int
+tiff_strips_get_rows(const tiff_strip_writer *tw, gx_device *bdev,
+                     int y, int rows, byte *dst)
+{
+    int copy = min(tw->src_bytes, tw->row_bytes);
+    int last_bits = -(bdev->width * bdev->color_info.depth) & 7;
+    gs_get_bits_params_t params;
+    gs_int_rect rect;
+    int row, code;
+
+    rect.p.x = 0;
+    rect.q.x = bdev->width;
+    for (row = 0; row < rows; row++, dst += tw->row_bytes) {
+        rect.p.y = y + row;
+        rect.q.y = y + row + 1;
+        params.options = GB_COLORS_NATIVE | GB_ALPHA_NONE |
+            GB_PACKING_CHUNKY | GB_RETURN_POINTER | GB_ALIGN_ANY |
+            GB_OFFSET_0 | GB_RASTER_ANY;
+        code = dev_proc(bdev, get_bits_rectangle)(bdev, &rect, &params);
+        if (code < 0)
+            return code;
+        memcpy(dst, params.data[0], copy);
+        /* Clear the bits past the page width, as gdev_prn_get_bits does. */
+        if (last_bits != 0 && copy == tw->src_bytes)
+            dst[copy - 1] &= 0xff << last_bits;
+        if (copy < tw->row_bytes)
+            memset(dst + copy, 0, tw->row_bytes - copy);
+        /* Our 16 bit samples are big-endian; the file's may not be. */
+        if (tw->swab16)
+            TIFFSwabArrayOfShort((uint16 *)dst, tw->row_bytes / 2);
+    }
+    return 0;
+}
+
+/* Called on a rendering thread with one band. */
+static int
+tiff_strips_process(void *arg, gx_device *dev, gx_device *bdev,
+                    const gs_int_rect *rect, void *buffer)
+{
+    tiff_strip_writer *tw = (tiff_strip_writer *)arg;
+    tiff_strip_buffer *buf = (tiff_strip_buffer *)buffer;
+    int rps = tw->rows_per_strip;
+    int h = rect->q.y - rect->p.y;
+    int y, rows;
+    uint start;
+    int code;
+
+    buf->first_strip = (rect->p.y + rps - 1) / rps;
+    buf->num_strips = 0;
+    buf->head_rows = min(buf->first_strip * rps - rect->p.y, h);
+    buf->tail_rows = 0;
+    buf->page_end = rect->q.y >= dev->height;
+    buf->used = 0;
+
+    code = tiff_strips_get_rows(tw, bdev, 0, buf->head_rows, buf->head);
+    for (y = buf->head_rows; y < h && code >= 0; y += rows) {
+        rows = min(rps, h - y);
+        if (rows < rps && !buf->page_end) {
+            buf->tail_rows = rows;
+            code = tiff_strips_get_rows(tw, bdev, y, rows, buf->tail);
+            break;
+        }
+        code = tiff_strips_get_rows(tw, bdev, y, rows, buf->in);
+        if (code < 0)
+            break;
+        start = buf->used;
+        code = tiff_compress_strip(tw, buf, rows);
+        buf->strip_bytes[buf->num_strips++] = buf->used - start;
+    }
+    return code;
+}
+
+/* Called in band order with the band's compressed strips. */
+static int
+tiff_strips_output(void *arg, gx_device *dev, void *buffer)
+{
+    tiff_strip_writer *tw = (tiff_strip_writer *)arg;
+    tiff_strip_buffer *buf = (tiff_strip_buffer *)buffer;
+    tiff_strip_buffer *pending = tw->pending;
+    byte *data = buf->data;
+    int i, code;
+
+    if (buf->head_rows > 0) {
+        memcpy(pending->in + tw->pending_rows * tw->row_bytes, buf->head,
+               buf->head_rows * tw->row_bytes);
+        tw->pending_rows += buf->head_rows;
+        if (tw->pending_rows == tw->rows_per_strip || buf->page_end) {
+            pending->used = 0;
+            code = tiff_compress_strip(tw, pending, tw->pending_rows);
+            if (code < 0)
+                return code;
+            if (TIFFWriteRawStrip(tw->tif, buf->first_strip - 1,
+                                  pending->data, pending->used) < 0)
+                return_error(gs_error_ioerror);
+            tw->pending_rows = 0;
+        }
+    }
+    for (i = 0; i < buf->num_strips; i++) {
+        if (TIFFWriteRawStrip(tw->tif, buf->first_strip + i, data,
+                              buf->strip_bytes[i]) < 0)
+            return_error(gs_error_ioerror);
+        data += buf->strip_bytes[i];
+    }
+    if (buf->tail_rows > 0) {
+        memcpy(pending->in, buf->tail, buf->tail_rows * tw->row_bytes);
+        tw->pending_rows = buf->tail_rows;
+    }
+    return 0;
+}
+
+static int
+tiff_print_page_strips(gx_device_printer *dev, TIFF *tif, int bpc)
+{
+    int band_height =
+        ((gx_device_clist_common *)dev)->page_info.band_params.BandHeight;
+    gx_process_page_options_t process = { 0 };
+    tiff_strip_writer tw;
+    uint32 rows_per_strip, width;
+    uint16 fill_order = FILLORDER_MSB2LSB;
+    int rps;
+    int code;
+
+    /*
+     * A strip taller than a band would be compressed entirely on the
+     * output side, so make it one band high. Otherwise, if strips can be
+     * made to divide the band height without more than doubling their
+     * number, none of them will straddle bands.
+     */
+    TIFFGetField(tif, TIFFTAG_ROWSPERSTRIP, &rows_per_strip);
+    tw.rows_per_strip = min(rows_per_strip, band_height);
+    for (rps = tw.rows_per_strip; rps * 2 > tw.rows_per_strip; rps--)
+        if (band_height % rps == 0) {
+            tw.rows_per_strip = rps;
+            break;
+        }
+    tw.max_strips = band_height / tw.rows_per_strip + 1;
+    TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, tw.rows_per_strip);
+
+    TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width);
+    TIFFGetField(tif, TIFFTAG_FILLORDER, &fill_order);
+    TIFFGetField(tif, TIFFTAG_COMPRESSION, &tw.compression);
+    tw.tif = tif;
+    tw.width = width;
+    tw.src_bytes = gdev_mem_bytes_per_scan_line((gx_device *)dev);
+    tw.row_bytes = TIFFScanlineSize(tif);
+    tw.swab16 = bpc == 16 && !TIFFIsBigEndian(tif);
+    tw.first_bit_low_order = fill_order == FILLORDER_LSB2MSB;
+    tw.pending_rows = 0;
+    tw.g3_options = 0;
+    tw.g3_k = 2;
+    if (tw.compression == COMPRESSION_CCITTFAX3) {
+        float yres = 0;
+        uint16 unit = RESUNIT_INCH;
+
+        /* libtiff codes every 2nd row 1-D, or every 4th above 150dpi. */
+        TIFFGetField(tif, TIFFTAG_GROUP3OPTIONS, &tw.g3_options);
+        TIFFGetField(tif, TIFFTAG_YRESOLUTION, &yres);
+        TIFFGetField(tif, TIFFTAG_RESOLUTIONUNIT, &unit);
+        if (unit == RESUNIT_CENTIMETER)
+            yres *= 2.54f;
+        if (yres > 150)
+            tw.g3_k = 4;
+    }
+
+    code = TIFFCheckpointDirectory(tif);
+    if (code < 0)
+        return code;
+
+    code = tiff_strips_init_buffer(&tw, (gx_device *)dev, dev->memory,
+                                   dev->width, band_height,
+                                   (void **)&tw.pending);
+    if (code < 0)
+        return code;
+    process.init_buffer_fn = tiff_strips_init_buffer;
+    process.free_buffer_fn = tiff_strips_free_buffer;
+    process.process_fn = tiff_strips_process;
+    process.output_fn = tiff_strips_output;
+    process.arg = &tw;
+    code = dev_proc(dev, process_page)((gx_device *)dev, &process);
+    tiff_strips_free_buffer(&tw, (gx_device *)dev, dev->memory, tw.pending);
+    if (code >= 0)
+        code = TIFFWriteDirectory(tif);
+    return code;
+}
+
 int
 tiff_print_page(gx_device_printer *dev, TIFF *tif, int min_feature_size)
 {
@@ -465,6 +904,9 @@ tiff_print_page(gx_device_printer *dev, TIFF *tif, int min_feature_size)
     int line_lag = 0;
     int filtered_count;
 
+    if (tiff_strips_possible(dev, tif, bpc, min_feature_size))
+        return tiff_print_page_strips(dev, tif, bpc);
+
     data = gs_alloc_bytes(dev->memory, max_size, "tiff_print_page(data)");
     if (data == NULL)
         return_error(gs_error_VMerror);
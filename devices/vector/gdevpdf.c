@@ -70,6 +70,9 @@ ENUM_PTRS_WITH(device_pdfwrite_enum_ptrs, gx_device_pdf *pdev)
     if (index < NUM_RESOURCE_TYPES * NUM_RESOURCE_CHAINS)
         ENUM_RETURN(pdev->resources[index / NUM_RESOURCE_CHAINS].chains[index % NUM_RESOURCE_CHAINS]);
     index -= NUM_RESOURCE_TYPES * NUM_RESOURCE_CHAINS;
+    if (index < NUM_RESOURCE_TYPES)
+        ENUM_RETURN(pdev->resources[index].same);
+    index -= NUM_RESOURCE_TYPES;
     if (index <= pdev->outline_depth && pdev->outline_levels)
         ENUM_RETURN(pdev->outline_levels[index].first.action);
     index -= pdev->outline_depth + 1;
@@ -186,6 +189,8 @@ static RELOC_PTRS_WITH(device_pdfwrite_reloc_ptrs, gx_device_pdf *pdev)
         for (i = 0; i < NUM_RESOURCE_TYPES; ++i)
             for (j = 0; j < NUM_RESOURCE_CHAINS; ++j)
                 RELOC_PTR(gx_device_pdf, resources[i].chains[j]);
+        for (i = 0; i < NUM_RESOURCE_TYPES; ++i)
+            RELOC_PTR(gx_device_pdf, resources[i].same);
         if (pdev->outline_levels) {
             for (i = 0; i <= pdev->outline_depth; ++i) {
                 RELOC_PTR(gx_device_pdf, outline_levels[i].first.action);
@@ -866,9 +871,12 @@ pdf_open(gx_device * dev)
     {
         int i, j;
 
-        for (i = 0; i < NUM_RESOURCE_TYPES; ++i)
+        for (i = 0; i < NUM_RESOURCE_TYPES; ++i) {
             for (j = 0; j < NUM_RESOURCE_CHAINS; ++j)
                 pdev->resources[i].chains[j] = 0;
+            pdev->resources[i].same = 0;
+            pdev->resources[i].same_size = pdev->resources[i].same_count = 0;
+        }
     }
     pdev->outline_levels = (pdf_outline_level_t *)gs_alloc_bytes(mem, INITIAL_MAX_OUTLINE_DEPTH * sizeof(pdf_outline_level_t), "outline_levels array");
     memset(pdev->outline_levels, 0x00, INITIAL_MAX_OUTLINE_DEPTH * sizeof(pdf_outline_level_t));
@@ -3431,6 +3439,8 @@ pdf_close(gx_device * dev)
             }
         }
     }
+    pdf_free_same_resource_index(pdev);
+    pdf_free_compress_workers(pdev);
 
     /* Release the resource records. */
     /* So what exactly is stored in this list ? I believe the following types of resource:
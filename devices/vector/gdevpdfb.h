@@ -236,7 +236,10 @@ const gx_device_pdf PDF_DEVICE_IDENT =
  0,                     /* OCR_char_code */
  0,                     /* OCR_glyph */
  NULL,                  /* ocr_glyphs */
- 0                   /* initial_pattern_state */
+ 0,                  /* initial_pattern_state */
+ 0,                     /* NumCompressionThreads */
+ 0,                     /* compress_workers */
+ 0                      /* compress_worker_count */
 };
 
 #else
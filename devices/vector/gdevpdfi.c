@@ -1663,6 +1663,15 @@ pdf_begin_typed_image(gx_device_pdf *pdev, const gs_gstate * pgs,
             goto fail_and_fallback;
         ++pie->writer.alt_writer_count;
     }
+    /* The compression chooser needs the encoders on this thread. */
+    if (pie->writer.alt_writer_count == 1 && !pie->JPEG_PassThrough &&
+        !pie->JPX_PassThrough) {
+        code = pdf_thread_encoder(pdev, pie->writer.binary[0].strm,
+                    (int64_t)pim->Width * pim->Height * num_components *
+                    pim->BitsPerComponent / 8);
+        if (code < 0)
+            goto fail_and_fallback;
+    }
 
     /* use_fallback = 0, so this will drop through the below labels, doing only the cleanup parts */
     code = 0;
@@ -1929,6 +1938,9 @@ pdf_end_and_do_image(gx_device_pdf *pdev, pdf_image_writer *piw,
                 (*(pres->object)).md5_valid = 0;
                 if (code < 0)
                     return code;
+                code = pdf_rehash_same_resource(pdev, pres);
+                if (code < 0)
+                    return code;
             }
             if (pdev->image_mask_skip)
                 code = 0;
@@ -2269,8 +2269,11 @@ pdfmark_PUT(gx_device_pdf * pdev, gs_param_string * pairs, uint count,
         return_error(gs_error_rangecheck);
     if (pco->written)
         return_error(gs_error_rangecheck);
-    return cos_array_put((cos_array_t *)pco, index,
+    code = cos_array_put((cos_array_t *)pco, index,
                 cos_string_value(&value, pairs[2].data, pairs[2].size));
+    if (code >= 0 && pco->pres != NULL)
+        code = pdf_rehash_same_resource(pdev, pco->pres);
+    return code;
 }
 
 /* [ {dict} key value ... /.PUTDICT pdfmark */
@@ -2321,7 +2324,10 @@ pdfmark_PUTDICT(gx_device_pdf * pdev, gs_param_string * pairs, uint count,
         }
     }
 
-    return pdfmark_put_pairs((cos_dict_t *)pco, pairs + 1, count - 1);
+    code = pdfmark_put_pairs((cos_dict_t *)pco, pairs + 1, count - 1);
+    if (code >= 0 && pco->pres != NULL)
+        code = pdf_rehash_same_resource(pdev, pco->pres);
+    return code;
 }
 
 /* [ {stream} string ... /.PUTSTREAM pdfmark */
@@ -2344,6 +2350,8 @@ pdfmark_PUTSTREAM(gx_device_pdf * pdev, gs_param_string * pairs, uint count,
             return_error(gs_error_ioerror);
     if (pco->written)
         return_error(gs_error_rangecheck);
+    if (pco->pres != NULL)
+        code = pdf_rehash_same_resource(pdev, pco->pres);
     return code;
 }
 
@@ -2360,8 +2368,11 @@ pdfmark_APPEND(gx_device_pdf * pdev, gs_param_string * pairs, uint count,
         return_error(gs_error_rangecheck);
     if ((code = pdf_get_named(pdev, &pairs[0], cos_type_array, &pco)) < 0)
         return code;
-    return cos_array_add((cos_array_t *)pco,
+    code = cos_array_add((cos_array_t *)pco,
                 cos_string_value(&value, pairs[1].data, pairs[1].size));
+    if (code >= 0 && pco->pres != NULL)
+        code = pdf_rehash_same_resource(pdev, pco->pres);
+    return code;
 }
 
 /* [ {array} index value ... /.PUTINTERVAL pdfmark */
@@ -2384,6 +2395,8 @@ pdfmark_PUTINTERVAL(gx_device_pdf * pdev, gs_param_string * pairs, uint count,
     for (i = 2; code >= 0 && i < count; ++i)
         code = cos_array_put((cos_array_t *)pco, index + i - 2,
                 cos_string_value(&value, pairs[i].data, pairs[i].size));
+    if (code >= 0 && pco->pres != NULL)
+        code = pdf_rehash_same_resource(pdev, pco->pres);
     return code;
 }
 
@@ -89,6 +89,12 @@ private_st_cos_object();
 private_st_cos_value();
 private_st_cos_array_element();
 private_st_cos_dict_element();
+gs_private_st_ptr(st_cos_dict_element_ptr, cos_dict_element_t *,
+  "cos_dict_element_t *", cos_dict_element_ptr_enum_ptrs,
+  cos_dict_element_ptr_reloc_ptrs);
+gs_private_st_element(st_cos_dict_element_ptr_element, cos_dict_element_t *,
+  "cos_dict_element_t *[]", cos_dict_element_ptr_element_enum_ptrs,
+  cos_dict_element_ptr_element_reloc_ptrs, st_cos_dict_element_ptr);
 
 /* GC procedures */
 static
@@ -179,6 +185,10 @@ cos_object_init(cos_object_t *pco, gx_device_pdf *pdev,
         pco->md5_valid = 0;
         pco->stream_md5_valid = 0;
         memset(&pco->hash, 0x00, 16);
+        pco->lookup = 0;
+        pco->lookup_last = 0;
+        pco->lookup_size = 0;
+        pco->lookup_count = 0;
     }
 }
 
@@ -813,11 +823,96 @@ cos_dict_element_free(cos_dict_t *pcd, cos_dict_element_t *pcde,
     gs_free_object(mem, pcde, cname);
 }
 
+/*
+ * Dictionaries with at least this many elements get a hash table
+ * (pcd->lookup) for finding keys.  The table is open-addressed with
+ * linear probing, and is kept no more than half full.
+ */
+#define COS_DICT_LOOKUP_MIN_ELEMENTS 16
+
+static uint
+cos_dict_key_hash(const byte *key_data, uint key_size)
+{
+    uint hash = key_size;
+
+    while (key_size--)
+        hash = hash * 31 + *key_data++;
+    return hash;
+}
+
+/* Return the slot which holds a key, or the empty slot where it would go. */
+static cos_dict_element_t **
+cos_dict_lookup_slot(const cos_dict_t *pcd, const byte *key_data, uint key_size)
+{
+    uint mask = pcd->lookup_size - 1;
+    uint i = cos_dict_key_hash(key_data, key_size) & mask;
+    cos_dict_element_t *pcde;
+
+    while ((pcde = pcd->lookup[i]) != 0 &&
+           bytes_compare(key_data, key_size, pcde->key.data, pcde->key.size))
+        i = (i + 1) & mask;
+    return &pcd->lookup[i];
+}
+
+static void
+cos_dict_lookup_free(cos_dict_t *pcd)
+{
+    if (pcd->lookup)
+        gs_free_object(COS_OBJECT_MEMORY(pcd), pcd->lookup, "cos_dict_lookup_free");
+    pcd->lookup = 0;
+    pcd->lookup_last = 0;
+    pcd->lookup_size = pcd->lookup_count = 0;
+}
+
+/*
+ * (Re)build the hash table for a dictionary with room for 'count' elements.
+ * The table is only an accelerator: if we can't allocate it, the dictionary
+ * just goes back to searching its list.
+ */
+static void
+cos_dict_lookup_build(cos_dict_t *pcd, uint count)
+{
+    gs_memory_t *mem = COS_OBJECT_MEMORY(pcd);
+    cos_dict_element_t *pcde;
+    uint size = 32;
+
+    while (size < count * 2)
+        size <<= 1;
+    cos_dict_lookup_free(pcd);
+    pcd->lookup = gs_alloc_struct_array(mem, size, cos_dict_element_t *,
+                                        &st_cos_dict_element_ptr_element,
+                                        "cos_dict_lookup_build");
+    if (pcd->lookup == 0)
+        return;
+    memset(pcd->lookup, 0, size * sizeof(*pcd->lookup));
+    pcd->lookup_size = size;
+    for (pcde = pcd->elements; pcde; pcde = pcde->next) {
+        *cos_dict_lookup_slot(pcd, pcde->key.data, pcde->key.size) = pcde;
+        pcd->lookup_count++;
+        pcd->lookup_last = pcde;
+    }
+}
+
+/* Add a new element (already linked into the list) to the hash table. */
+static void
+cos_dict_lookup_add(cos_dict_t *pcd, cos_dict_element_t *pcde)
+{
+    if ((pcd->lookup_count + 1) * 2 > pcd->lookup_size) {
+        cos_dict_lookup_build(pcd, pcd->lookup_count + 1);
+        return;
+    }
+    *cos_dict_lookup_slot(pcd, pcde->key.data, pcde->key.size) = pcde;
+    pcd->lookup_count++;
+}
+
 static int
 cos_dict_delete(cos_dict_t *pcd, const byte *key_data, uint key_size)
 {
     cos_dict_element_t *pcde = pcd->elements, *prev = 0;
 
+    /* Deletion is rare: drop the hash table, the next put rebuilds it. */
+    cos_dict_lookup_free(pcd);
+
     for (; pcde; pcde = pcde->next) {
         if (!bytes_compare(key_data, key_size, pcde->key.data, pcde->key.size)) {
             if (prev != 0)
@@ -849,6 +944,7 @@ cos_dict_release(cos_object_t *pco, client_name_t cname)
         cos_dict_element_free(pcd, cur, cname);
     }
     pcd->elements = 0;
+    cos_dict_lookup_free(pcd);
 }
 
 /* Write the elements of a dictionary. */
@@ -1285,12 +1381,21 @@ cos_dict_put_copy(cos_dict_t *pcd, const byte *key_data, uint key_size,
     cos_dict_element_t *pcde;
     cos_dict_element_t *next;
     cos_value_t value;
+    uint count = 0;
     int code;
 
-    while ((next = *ppcde) != 0 &&
-           bytes_compare(next->key.data, next->key.size, key_data, key_size)
-           )
-        ppcde = &next->next;
+    if (pcd->lookup) {
+        next = *cos_dict_lookup_slot(pcd, key_data, key_size);
+        if (!next)
+            ppcde = &pcd->lookup_last->next;
+    } else {
+        while ((next = *ppcde) != 0 &&
+               bytes_compare(next->key.data, next->key.size, key_data, key_size)
+               ) {
+            ppcde = &next->next;
+            count++;
+        }
+    }
     if (next) {
         /* We're replacing an existing element. */
         if ((pvalue->value_type == COS_VALUE_SCALAR ||
@@ -1342,6 +1447,14 @@ cos_dict_put_copy(cos_dict_t *pcd, const byte *key_data, uint key_size,
         pcde->owns_key = (flags & DICT_FREE_KEY) != 0;
         pcde->next = next;
         *ppcde = pcde;
+        pcde->value = value;
+        pcd->md5_valid = false;
+        if (pcd->lookup) {
+            pcd->lookup_last = pcde;
+            cos_dict_lookup_add(pcd, pcde);
+        } else if (count + 1 >= COS_DICT_LOOKUP_MIN_ELEMENTS)
+            cos_dict_lookup_build(pcd, count + 1);
+        return 0;
     }
     pcde->value = value;
     pcd->md5_valid = false;
@@ -1451,7 +1564,17 @@ cos_dict_move_all(cos_dict_t *pcdto, cos_dict_t *pcdfrom)
 {
     cos_dict_element_t *pcde = pcdfrom->elements;
     cos_dict_element_t *head = pcdto->elements;
+    uint count = 0;
+
+    if (!pcdto->lookup && pcdfrom->elements) {
+        cos_dict_element_t *p;
 
+        for (p = pcdto->elements; p; p = p->next)
+            count++;
+        if (count >= COS_DICT_LOOKUP_MIN_ELEMENTS)
+            cos_dict_lookup_build(pcdto, count);
+    }
+    cos_dict_lookup_free(pcdfrom);
     while (pcde) {
         cos_dict_element_t *next = pcde->next;
 
@@ -1462,6 +1585,14 @@ cos_dict_move_all(cos_dict_t *pcdto, cos_dict_t *pcdfrom)
             /* Move the element. */
             pcde->next = head;
             head = pcde;
+            /*
+             * The keys in pcdfrom are distinct, so finding a moved
+             * element in the hash table doesn't change the outcome.
+             */
+            if (pcdto->lookup) {
+                pcdto->elements = head;
+                cos_dict_lookup_add(pcdto, pcde);
+            }
         }
         pcde = next;
     }
@@ -1477,6 +1608,10 @@ cos_dict_find(const cos_dict_t *pcd, const byte *key_data, uint key_size)
 {
     cos_dict_element_t *pcde = pcd->elements;
 
+    if (pcd->lookup) {
+        pcde = *cos_dict_lookup_slot(pcd, key_data, key_size);
+        return (pcde ? &pcde->value : 0);
+    }
     for (; pcde; pcde = pcde->next)
         if (!bytes_compare(key_data, key_size, pcde->key.data, pcde->key.size))
             return &pcde->value;
@@ -1790,6 +1925,35 @@ cos_stream_length(const cos_stream_t *pcs)
     return pcs->length;
 }
 
+/* Compute a hash key for an object from its MD5 hash(es). */
+int
+cos_object_hash_key(const cos_object_t *pco, gx_device_pdf *pdev, uint *pkey)
+{
+    uint key = 0;
+    int code, i;
+
+    if (cos_type(pco) != cos_type_array && cos_type(pco) != cos_type_dict &&
+        cos_type(pco) != cos_type_stream)
+        return 1;
+    /* Comparing the object with itself makes the equal procedure compute
+       and cache the hashes we want. */
+    code = pco->cos_procs->equal(pco, pco, pdev);
+    if (code < 0)
+        return code;
+    if (!pco->md5_valid)
+        return 1;
+    for (i = 0; i < 16; i++)
+        key = (key << 5) + (key >> 27) + pco->hash[i];
+    if (cos_type(pco) == cos_type_stream) {
+        if (!pco->stream_md5_valid)
+            return 1;
+        for (i = 0; i < 16; i++)
+            key = (key << 5) + (key >> 27) + pco->stream_hash[i];
+    }
+    *pkey = key;
+    return 0;
+}
+
 /* Write the (dictionary) elements of a stream. */
 /* (This procedure is exported.) */
 int
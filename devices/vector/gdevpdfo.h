@@ -121,14 +121,18 @@ struct otype_s {\
     byte hash[16];		/* MD5 hash value */\
     int stream_md5_valid;       /* (for streams) 1 if hash created, 0 otherwise */\
     byte stream_hash[16];	/* MD5 hash value (if stream) */\
+    etype **lookup;		/* (dicts/streams) key index, see below */\
+    etype *lookup_last;		/* (dicts/streams) last element, if lookup */\
+    uint lookup_size;		/* (dicts/streams) slots in lookup */\
+    uint lookup_count;		/* (dicts/streams) elements in lookup */\
     /* input_strm is introduced recently for pdfmark. */\
     /* Using this field, psdf_binary_writer_s may be simplified. */\
 }
 cos_object_struct(cos_object_s, cos_element_t);
 #define private_st_cos_object()	/* in gdevpdfo.c */\
-  gs_private_st_ptrs4(st_cos_object, cos_object_t, "cos_object_t",\
+  gs_private_st_ptrs6(st_cos_object, cos_object_t, "cos_object_t",\
     cos_object_enum_ptrs, cos_object_reloc_ptrs, elements, pieces,\
-    pres, input_strm)
+    pres, input_strm, lookup, lookup_last)
 extern const cos_object_procs_t cos_generic_procs;
 #define cos_type_generic (&cos_generic_procs)
 
@@ -174,7 +178,10 @@ struct cos_value_s {
  * Define Cos arrays, dictionaries, and streams.
  *
  * The elements of arrays are stored sorted in decreasing index order.
- * The elements of dictionaries/streams are not sorted.
+ * The elements of dictionaries/streams are not sorted.  Once a dictionary
+ * has more than a few elements, 'lookup' holds an open-addressed hash
+ * table of them keyed on the key strings, so that lookups don't have to
+ * walk the list; the list still determines the order of output.
  * The contents pieces of streams are stored in reverse order.
  */
     /* array */
@@ -225,6 +232,13 @@ cos_proc_write(cos_write);
 int cos_write_dict_as_ordered_array(cos_object_t *pco, gx_device_pdf *pdev, pdf_resource_type_t type);
 #define COS_WRITE(pc, pdev) cos_write(CONST_COS_OBJECT(pc), pdev, (pc)->id)
 
+/*
+ * Compute a hash key for an array, dictionary or stream from the MD5
+ * hash used by the equal procedure, so that equal objects get equal
+ * keys.  Returns 1 (and no key) for other types of object.
+ */
+int cos_object_hash_key(const cos_object_t *pco, gx_device_pdf *pdev, uint *pkey);
+
 /* Make a value to store into a composite object. */
 const cos_value_t *cos_string_value(cos_value_t *, const byte *, uint);
 const cos_value_t *cos_c_string_value(cos_value_t *, const char *);
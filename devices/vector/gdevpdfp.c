@@ -129,6 +129,7 @@ static const gs_param_item_t pdf_param_items[] = {
     pi("NoOutputFonts", gs_param_type_bool, FlattenFonts),
     pi("WantsPageLabels", gs_param_type_bool, WantsPageLabels),
     pi("UserUnit", gs_param_type_float, UserUnit),
+    pi("NumCompressionThreads", gs_param_type_int, NumCompressionThreads),
 #undef pi
     gs_param_item_end
 };
@@ -725,6 +726,11 @@ gdev_pdf_put_params_impl(gx_device * dev, const gx_device_pdf * save_dev, gs_par
         param_signal_error(plist, "UserUnit", ecode);
         goto fail;
     }
+    if (pdev->NumCompressionThreads < 0) {
+        ecode = gs_note_error(gs_error_rangecheck);
+        param_signal_error(plist, "NumCompressionThreads", ecode);
+        goto fail;
+    }
 
     ecode = gdev_psdf_put_params(dev, plist);
     if (ecode < 0)
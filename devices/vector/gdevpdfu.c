@@ -40,6 +40,7 @@
 #include "strmio.h"
 #include "szlibx.h"
 #include "gsagl.h"
+#include "gxsync.h"
 
 #include "opdfread.h"
 #include "gs_mgl_e.h"
@@ -77,6 +78,11 @@ extern_st(st_pdf_font_descriptor);
 public_st_pdf_resource();
 private_st_pdf_x_object();
 private_st_pdf_pattern();
+gs_private_st_ptr(st_pdf_resource_ptr, pdf_resource_t *, "pdf_resource_t *",
+  pdf_resource_ptr_enum_ptrs, pdf_resource_ptr_reloc_ptrs);
+gs_private_st_element(st_pdf_resource_ptr_element, pdf_resource_t *,
+  "pdf_resource_t *[]", pdf_resource_ptr_element_enum_ptrs,
+  pdf_resource_ptr_element_reloc_ptrs, st_pdf_resource_ptr);
 
 /* ---------------- Utilities ---------------- */
 
@@ -1001,6 +1007,407 @@ pdf_begin_encrypt(gx_device_pdf * pdev, stream **s, gs_id object_id)
      */
 }
 
+/* ------ Compression workers ------ */
+
+/*
+ * A compression worker is a thread which runs a lossless encoder for one
+ * stream at a time. The stream set up by pdf_thread_encoder collects its
+ * input in blocks, and keeps one block in flight: the worker encodes one
+ * block while the interpreter fills the next. The encoded data is passed
+ * down the pipeline by the interpreter thread in the order it was
+ * produced, so the output is exactly what the encoder would have written
+ * by itself. Input which the encoder doesn't consume (CCITTFax encodes
+ * whole rows only) stays at the start of the worker's source buffer.
+ *
+ * Everything the worker touches is allocated from thread_safe_memory.
+ */
+#define PDF_COMPRESS_BLOCK_SIZE 65536
+/* Minimum free space in the worker's output buffer. */
+#define PDF_COMPRESS_MIN_SPACE 256
+
+struct pdf_compress_worker_s {
+    pdf_compress_worker_t *next;
+    gs_memory_t *memory;
+    gx_semaphore_t *start;
+    gx_semaphore_t *done;
+    gp_thread_id thread;
+    bool quit;
+    bool in_use;		/* owned by a stream */
+    bool pending;		/* started and not yet collected */
+    /* The job */
+    stream_state *ss;		/* the encoder, with non-GC memory */
+    bool last;
+    byte *src;
+    uint src_count, src_size;
+    byte *dst;
+    uint dst_count, dst_size;
+    int status;
+};
+
+typedef struct stream_pdf_thread_state_s {
+    stream_state_common;
+    pdf_compress_worker_t *worker;
+    byte *fill;			/* the block being filled */
+    uint fill_count;
+    byte *out;			/* encoded data not written yet */
+    uint out_pos, out_count, out_size;
+    bool finished;		/* the last block has been collected */
+} stream_pdf_thread_state;
+
+gs_private_st_simple(st_pdf_thread_state, stream_pdf_thread_state,
+                     "stream_pdf_thread_state");
+
+static int
+pdf_compress_grow(gs_memory_t *mem, byte **pbuf, uint *psize, uint need)
+{
+    uint size = *psize;
+    byte *buf;
+
+    if (need <= size)
+        return 0;
+    if (size == 0)
+        size = PDF_COMPRESS_MIN_SPACE;
+    while (size < need)
+        size *= 2;
+    if (*pbuf == NULL)
+        buf = gs_alloc_bytes(mem, size, "pdf_compress_grow");
+    else
+        buf = gs_resize_object(mem, *pbuf, size, "pdf_compress_grow");
+    if (buf == NULL)
+        return_error(gs_error_VMerror);
+    *pbuf = buf;
+    *psize = size;
+    return 0;
+}
+
+static void
+pdf_compress_worker_run(pdf_compress_worker_t *w)
+{
+    const stream_template *templat = w->ss->templat;
+    stream_cursor_read r;
+    stream_cursor_write cw;
+    uint left;
+    int status;
+
+    r.ptr = w->src - 1;
+    r.limit = r.ptr + w->src_count;
+    for (;;) {
+        if (w->dst_size - w->dst_count < PDF_COMPRESS_MIN_SPACE) {
+            status = pdf_compress_grow(w->memory, &w->dst, &w->dst_size,
+                                       w->dst_count + PDF_COMPRESS_MIN_SPACE);
+            if (status < 0)
+                break;
+        }
+        cw.ptr = w->dst + w->dst_count - 1;
+        cw.limit = w->dst + w->dst_size - 1;
+        status = (*templat->process)(w->ss, &r, &cw, w->last);
+        w->dst_count = cw.ptr + 1 - w->dst;
+        if (status != 1)
+            break;
+    }
+    if (status < 0 && status != EOFC) {
+        w->status = status;
+        return;
+    }
+    left = r.limit - r.ptr;
+    if (left > 0 && r.ptr + 1 != w->src)
+        memmove(w->src, r.ptr + 1, left);
+    w->src_count = left;
+}
+
+static void
+pdf_compress_worker_thread(void *arg)
+{
+    pdf_compress_worker_t *w = (pdf_compress_worker_t *)arg;
+
+    for (;;) {
+        gx_semaphore_wait(w->start);
+        if (w->quit)
+            break;
+        pdf_compress_worker_run(w);
+        gx_semaphore_signal(w->done);
+    }
+}
+
+static void
+pdf_compress_worker_wait(pdf_compress_worker_t *w)
+{
+    if (!w->pending)
+        return;
+    gx_semaphore_wait(w->done);
+    w->pending = false;
+}
+
+/* Release the encoder and the buffers of a job. */
+static void
+pdf_compress_worker_end_job(pdf_compress_worker_t *w)
+{
+    pdf_compress_worker_wait(w);
+    if (w->ss != NULL) {
+        if (w->ss->templat->release != NULL)
+            (*w->ss->templat->release)(w->ss);
+        gs_free_object(w->memory, w->ss, "pdf_compress_worker_end_job(state)");
+        w->ss = NULL;
+    }
+    gs_free_object(w->memory, w->src, "pdf_compress_worker_end_job(src)");
+    gs_free_object(w->memory, w->dst, "pdf_compress_worker_end_job(dst)");
+    w->src = w->dst = NULL;
+    w->in_use = false;
+}
+
+/* Find an idle worker, or start a new one if the limit allows. */
+static pdf_compress_worker_t *
+pdf_get_compress_worker(gx_device_pdf *pdev)
+{
+    gs_memory_t *mem = pdev->memory->thread_safe_memory;
+    pdf_compress_worker_t *w;
+
+    for (w = pdev->compress_workers; w != NULL; w = w->next)
+        if (!w->in_use)
+            return w;
+    if (pdev->compress_worker_count >= pdev->NumCompressionThreads)
+        return NULL;
+    w = (pdf_compress_worker_t *)gs_alloc_bytes(mem, sizeof(*w),
+                                                "pdf_get_compress_worker");
+    if (w == NULL)
+        return NULL;
+    memset(w, 0, sizeof(*w));
+    w->memory = mem;
+    w->start = gx_semaphore_label(gx_semaphore_alloc(mem), "pdfwrite compress start");
+    w->done = gx_semaphore_label(gx_semaphore_alloc(mem), "pdfwrite compress done");
+    if (w->start == NULL || w->done == NULL ||
+        gp_thread_start(pdf_compress_worker_thread, w, &w->thread) < 0) {
+        /* Not fatal, the encoder just stays on this thread */
+        if (w->start != NULL)
+            gx_semaphore_free(w->start);
+        if (w->done != NULL)
+            gx_semaphore_free(w->done);
+        gs_free_object(mem, w, "pdf_get_compress_worker");
+        return NULL;
+    }
+    gp_thread_label(w->thread, "pdfwrite compress");
+    w->next = pdev->compress_workers;
+    pdev->compress_workers = w;
+    pdev->compress_worker_count++;
+    return w;
+}
+
+void
+pdf_free_compress_workers(gx_device_pdf *pdev)
+{
+    pdf_compress_worker_t *w;
+
+    /* All the streams using the workers have been closed by now. */
+    while ((w = pdev->compress_workers) != NULL) {
+        pdev->compress_workers = w->next;
+        pdf_compress_worker_end_job(w);
+        w->quit = true;
+        gx_semaphore_signal(w->start);
+        gp_thread_finish(w->thread);
+        gx_semaphore_free(w->start);
+        gx_semaphore_free(w->done);
+        gs_free_object(w->memory, w, "pdf_free_compress_workers");
+    }
+    pdev->compress_worker_count = 0;
+}
+
+/* Wait for the block in flight, and queue its output. */
+static int
+s_pdf_thread_collect(stream_pdf_thread_state *ss)
+{
+    pdf_compress_worker_t *w = ss->worker;
+    int code;
+
+    if (!w->pending)
+        return 0;
+    pdf_compress_worker_wait(w);
+    if (w->status < 0)
+        return w->status;
+    if (ss->out_pos == ss->out_count) {
+        /* The usual case, just swap the buffers. */
+        byte *buf = ss->out;
+        uint size = ss->out_size;
+
+        ss->out = w->dst;
+        ss->out_size = w->dst_size;
+        ss->out_pos = 0;
+        ss->out_count = w->dst_count;
+        w->dst = buf;
+        w->dst_size = size;
+    } else {
+        code = pdf_compress_grow(w->memory, &ss->out, &ss->out_size,
+                                 ss->out_count + w->dst_count);
+        if (code < 0)
+            return code;
+        memcpy(ss->out + ss->out_count, w->dst, w->dst_count);
+        ss->out_count += w->dst_count;
+    }
+    w->dst_count = 0;
+    return 0;
+}
+
+/* Hand the filled block to the worker. */
+static int
+s_pdf_thread_submit(stream_pdf_thread_state *ss, bool last)
+{
+    pdf_compress_worker_t *w = ss->worker;
+    int code = s_pdf_thread_collect(ss);
+
+    if (code < 0)
+        return code;
+    code = pdf_compress_grow(w->memory, &w->src, &w->src_size,
+                             w->src_count + ss->fill_count);
+    if (code < 0)
+        return code;
+    memcpy(w->src + w->src_count, ss->fill, ss->fill_count);
+    w->src_count += ss->fill_count;
+    ss->fill_count = 0;
+    w->last = last;
+    w->pending = true;
+    gx_semaphore_signal(w->start);
+    if (last) {
+        code = s_pdf_thread_collect(ss);
+        ss->finished = true;
+    }
+    return code;
+}
+
+static int
+s_pdf_thread_process(stream_state *st, stream_cursor_read *pr,
+                     stream_cursor_write *pw, bool last)
+{
+    stream_pdf_thread_state *const ss = (stream_pdf_thread_state *)st;
+
+    for (;;) {
+        uint count = ss->out_count - ss->out_pos;
+
+        if (count > 0) {
+            uint wcount = pw->limit - pw->ptr;
+
+            if (count > wcount)
+                count = wcount;
+            memcpy(pw->ptr + 1, ss->out + ss->out_pos, count);
+            pw->ptr += count;
+            ss->out_pos += count;
+            if (ss->out_pos < ss->out_count)
+                return 1;
+        }
+        if (ss->finished)
+            return 0;
+        count = pr->limit - pr->ptr;
+        if (count > PDF_COMPRESS_BLOCK_SIZE - ss->fill_count)
+            count = PDF_COMPRESS_BLOCK_SIZE - ss->fill_count;
+        memcpy(ss->fill + ss->fill_count, pr->ptr + 1, count);
+        pr->ptr += count;
+        ss->fill_count += count;
+        if (ss->fill_count < PDF_COMPRESS_BLOCK_SIZE &&
+            !(last && pr->ptr == pr->limit))
+            return 0;
+        if (s_pdf_thread_submit(ss, last && pr->ptr == pr->limit) < 0)
+            return ERRC;
+    }
+}
+
+static void
+s_pdf_thread_release(stream_state *st)
+{
+    stream_pdf_thread_state *const ss = (stream_pdf_thread_state *)st;
+    pdf_compress_worker_t *w = ss->worker;
+
+    if (w == NULL)
+        return;
+    gs_free_object(w->memory, ss->fill, "s_pdf_thread_release(fill)");
+    gs_free_object(w->memory, ss->out, "s_pdf_thread_release(out)");
+    ss->fill = ss->out = NULL;
+    pdf_compress_worker_end_job(w);
+    ss->worker = NULL;
+}
+
+static const stream_template s_pdf_thread_template = {
+    &st_pdf_thread_state, NULL, s_pdf_thread_process, 1, 1,
+    s_pdf_thread_release
+};
+
+int
+pdf_thread_encoder(gx_device_pdf *pdev, stream *s, int64_t size_hint)
+{
+    stream_state *st;
+    const stream_template *templat = NULL;
+    stream_pdf_thread_state *ts;
+    pdf_compress_worker_t *w;
+    stream_state *ss;
+    gs_memory_t *mem;
+
+    if (pdev->NumCompressionThreads <= 0 ||
+        (size_hint >= 0 && size_hint < PDF_COMPRESS_BLOCK_SIZE))
+        return 0;
+    /* Find the encoder. */
+    for (; s != NULL; s = s->strm) {
+        templat = s->state->templat;
+        if (templat == &s_zlibE_template || templat == &s_LZWE_template ||
+            templat == &s_CFE_template)
+            break;
+    }
+    if (s == NULL || s->procs.process != templat->process || stell(s) != 0)
+        return 0;
+    w = pdf_get_compress_worker(pdev);
+    if (w == NULL)
+        return 0;
+    st = s->state;
+    mem = w->memory;
+    ts = gs_alloc_struct(st->memory, stream_pdf_thread_state,
+                         &st_pdf_thread_state, "pdf_thread_encoder");
+    ss = gs_alloc_struct(mem, stream_state, templat->stype,
+                         "pdf_thread_encoder(state)");
+    w->src_size = w->dst_size = PDF_COMPRESS_BLOCK_SIZE;
+    w->src = gs_alloc_bytes(mem, w->src_size, "pdf_thread_encoder(src)");
+    w->dst = gs_alloc_bytes(mem, w->dst_size, "pdf_thread_encoder(dst)");
+    if (ts != NULL)
+        ts->fill = gs_alloc_bytes(mem, PDF_COMPRESS_BLOCK_SIZE,
+                                  "pdf_thread_encoder(fill)");
+    w->in_use = true;
+    if (ts == NULL || ss == NULL || w->src == NULL || w->dst == NULL ||
+        ts->fill == NULL) {
+        if (ts != NULL)
+            gs_free_object(mem, ts->fill, "pdf_thread_encoder(fill)");
+        gs_free_object(st->memory, ts, "pdf_thread_encoder");
+        gs_free_object(mem, ss, "pdf_thread_encoder(state)");
+        pdf_compress_worker_end_job(w);
+        return_error(gs_error_VMerror);
+    }
+    /*
+     * Set up a copy of the encoder with the same parameters, which
+     * allocates its working storage from the non-GC memory.
+     */
+    memcpy(ss, st, templat->stype->ssize);
+    ss->memory = mem;
+    if ((*templat->init)(ss) < 0) {
+        /* Leave the encoder where it was. */
+        gs_free_object(mem, ts->fill, "pdf_thread_encoder(fill)");
+        gs_free_object(st->memory, ts, "pdf_thread_encoder");
+        gs_free_object(mem, ss, "pdf_thread_encoder(state)");
+        pdf_compress_worker_end_job(w);
+        return 0;
+    }
+    w->ss = ss;
+    w->src_count = w->dst_count = 0;
+    w->status = 0;
+    w->pending = false;
+    s_init_state((stream_state *)ts, &s_pdf_thread_template, st->memory);
+    ts->report_error = st->report_error;
+    ts->worker = w;
+    ts->fill_count = 0;
+    ts->out = NULL;
+    ts->out_pos = ts->out_count = ts->out_size = 0;
+    ts->finished = false;
+    if (templat->release != NULL)
+        (*templat->release)(st);
+    gs_free_object(st->memory, st, "pdf_thread_encoder(old state)");
+    s->state = (stream_state *)ts;
+    s->procs.process = s_pdf_thread_process;
+    return 0;
+}
+
 /* Enter stream context. */
 static int
 none_to_stream(gx_device_pdf * pdev)
@@ -1082,6 +1489,9 @@ none_to_stream(gx_device_pdf * pdev)
             (*templat->set_defaults) ((stream_state *) st);
             (*templat->init) ((stream_state *) st);
             pdev->strm = s = es;
+            code = pdf_thread_encoder(pdev, es, -1);
+            if (code < 0)
+                return code;
         }
     }
     /*
@@ -1234,6 +1644,9 @@ const gs_memory_struct_type_t *const pdf_resource_type_structs[] = {
     PDF_RESOURCE_TYPE_STRUCTS
 };
 
+static void pdf_unindex_same_resource(gx_device_pdf * pdev, pdf_resource_t *pres1,
+                                      pdf_resource_type_t rtype);
+
 /* Cancel a resource (do not write it into PDF). */
 int
 pdf_cancel_resource(gx_device_pdf * pdev, pdf_resource_t *pres, pdf_resource_type_t rtype)
@@ -1291,6 +1704,7 @@ pdf_forget_resource(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_resource_ty
         for (; (pres = *pprev) != 0; pprev = &pres->next)
             if (pres == pres1) {
                 *pprev = pres->next;
+                pdf_unindex_same_resource(pdev, pres, rtype);
                 if (pres->object) {
                     COS_RELEASE(pres->object, "pdf_forget_resource");
                     gs_free_object(pdev->pdf_memory, pres->object, "pdf_forget_resource");
@@ -1384,9 +1798,189 @@ pdf_find_resource_by_resource_id(gx_device_pdf * pdev, pdf_resource_type_t rtype
     return 0;
 }
 
-/* Find same resource. */
+/* ------ Index for pdf_find_same_resource ------ */
+
+/* Remove a resource from the index of its type, if it is there. */
+static void
+pdf_unindex_same_resource(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_resource_type_t rtype)
+{
+    pdf_resource_list_t *plist = &pdev->resources[rtype];
+    pdf_resource_t **pprev, *pres;
+
+    if (!pres1->same_indexed || plist->same == NULL)
+        return;
+    pprev = &plist->same[pres1->same_key & (plist->same_size - 1)];
+    for (; (pres = *pprev) != 0; pprev = &pres->same_next)
+        if (pres == pres1) {
+            *pprev = pres->same_next;
+            plist->same_count--;
+            break;
+        }
+    pres1->same_next = 0;
+    pres1->same_indexed = false;
+}
+
+/* Resize the index of a resource type. */
+static int
+pdf_resize_same_resource_index(gx_device_pdf * pdev, pdf_resource_list_t *plist, uint new_size)
+{
+    pdf_resource_t **new_same =
+        gs_alloc_struct_array(pdev->pdf_memory, new_size, pdf_resource_t *,
+                              &st_pdf_resource_ptr_element,
+                              "pdf_resize_same_resource_index");
+    uint i;
+
+    if (new_same == NULL)
+        return_error(gs_error_VMerror);
+    memset(new_same, 0, new_size * sizeof(*new_same));
+    for (i = 0; i < plist->same_size; i++) {
+        pdf_resource_t *pres, *pnext;
+
+        for (pres = plist->same[i]; pres != 0; pres = pnext) {
+            pdf_resource_t **pbucket = &new_same[pres->same_key & (new_size - 1)];
+
+            pnext = pres->same_next;
+            pres->same_next = *pbucket;
+            *pbucket = pres;
+        }
+    }
+    gs_free_object(pdev->pdf_memory, plist->same, "pdf_resize_same_resource_index");
+    plist->same = new_same;
+    plist->same_size = new_size;
+    return 0;
+}
+
+/* Add a resource to the index of its type, growing the table as needed. */
+static int
+pdf_index_same_resource(gx_device_pdf * pdev, pdf_resource_t *pres, pdf_resource_type_t rtype,
+                        uint key)
+{
+    pdf_resource_list_t *plist = &pdev->resources[rtype];
+    pdf_resource_t **pbucket;
+
+    pdf_unindex_same_resource(pdev, pres, rtype);
+    if (plist->same_count >= plist->same_size) {
+        int code = pdf_resize_same_resource_index(pdev, plist,
+                        plist->same_size == 0 ? RESOURCE_SAME_INITIAL_SIZE :
+                        plist->same_size * 2);
+
+        if (code < 0)
+            return code;
+    }
+    pbucket = &plist->same[key & (plist->same_size - 1)];
+    pres->same_key = key;
+    pres->same_indexed = true;
+    pres->same_next = *pbucket;
+    *pbucket = pres;
+    plist->same_count++;
+    return 0;
+}
+
+/* Is there a resource of the type, other than pres0, to compare with? */
+static bool
+pdf_has_other_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t *pres0)
+{
+    pdf_resource_t **pchain = pdev->resources[rtype].chains;
+    pdf_resource_t *pres;
+    int i;
+
+    for (i = 0; i < NUM_RESOURCE_CHAINS; i++)
+        for (pres = pchain[i]; pres != 0; pres = pres->next)
+            if (pres != pres0 && pres->object != NULL)
+                return true;
+    return false;
+}
+
+/*
+ * Build the index of a resource type from the resources already on its
+ * chains. This is only done when a resource of the type is first looked
+ * for with another one to compare it with, so nothing is hashed for types
+ * which never have a duplicate candidate.
+ */
+static int
+pdf_build_same_resource_index(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t *pres0)
+{
+    pdf_resource_list_t *plist = &pdev->resources[rtype];
+    pdf_resource_t **pchain = plist->chains;
+    pdf_resource_t *pres;
+    int i, code;
+
+    code = pdf_resize_same_resource_index(pdev, plist, RESOURCE_SAME_INITIAL_SIZE);
+    if (code < 0)
+        return code;
+    for (i = 0; i < NUM_RESOURCE_CHAINS; i++) {
+        for (pres = pchain[i]; pres != 0; pres = pres->next) {
+            uint key;
+
+            if (pres == pres0 || pres->object == NULL)
+                continue;
+            code = cos_object_hash_key(pres->object, pdev, &key);
+            if (code < 0)
+                return code;
+            if (code == 0) {
+                code = pdf_index_same_resource(pdev, pres, rtype, key);
+                if (code < 0)
+                    return code;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * The object of a resource has been changed after the resource went through
+ * pdf_find_same_resource. Its key in the index is out of date, so move it to
+ * the bucket for its new content. The Cos objects don't know which resource
+ * they belong to, so this is called by the code making the change.
+ */
 int
-pdf_find_same_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t **ppres,
+pdf_rehash_same_resource(gx_device_pdf * pdev, pdf_resource_t *pres1)
+{
+    int i;
+
+    if (!pres1->same_indexed || pres1->object == NULL)
+        return 0;
+    for (i = 0; i < NUM_RESOURCE_TYPES; i++) {
+        pdf_resource_list_t *plist = &pdev->resources[i];
+        pdf_resource_t *pres;
+
+        if (plist->same == NULL)
+            continue;
+        for (pres = plist->same[pres1->same_key & (plist->same_size - 1)]; pres != 0;
+             pres = pres->same_next)
+            if (pres == pres1) {
+                uint key;
+                int code;
+
+                pdf_unindex_same_resource(pdev, pres1, i);
+                pres1->object->md5_valid = 0;
+                code = cos_object_hash_key(pres1->object, pdev, &key);
+                if (code != 0)
+                    return code < 0 ? code : 0;
+                return pdf_index_same_resource(pdev, pres1, i, key);
+            }
+    }
+    return 0;
+}
+
+/* Release the indices of all resource types. */
+void
+pdf_free_same_resource_index(gx_device_pdf * pdev)
+{
+    int i;
+
+    for (i = 0; i < NUM_RESOURCE_TYPES; i++) {
+        pdf_resource_list_t *plist = &pdev->resources[i];
+
+        gs_free_object(pdev->pdf_memory, plist->same, "pdf_free_same_resource_index");
+        plist->same = 0;
+        plist->same_size = plist->same_count = 0;
+    }
+}
+
+/* Find same resource by comparing against every resource of the type. */
+static int
+pdf_find_same_resource_slow(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t **ppres,
         int (*eq)(gx_device_pdf * pdev, pdf_resource_t *pres0, pdf_resource_t *pres1))
 {
     pdf_resource_t **pchain = pdev->resources[rtype].chains;
@@ -1420,6 +2014,60 @@ pdf_find_same_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_reso
     return 0;
 }
 
+/*
+ * Find same resource.  Objects which can be hashed are only compared
+ * against resources in the index with the same key; if there is no match
+ * the resource is added to the index, so that later duplicates can find it.
+ * The index of a type is built from its chains the first time there is
+ * something to compare with; after that, resources which don't go through
+ * here are not candidates.
+ */
+int
+pdf_find_same_resource(gx_device_pdf * pdev, pdf_resource_type_t rtype, pdf_resource_t **ppres,
+        int (*eq)(gx_device_pdf * pdev, pdf_resource_t *pres0, pdf_resource_t *pres1))
+{
+    pdf_resource_list_t *plist = &pdev->resources[rtype];
+    pdf_resource_t *pres;
+    cos_object_t *pco0 = (*ppres)->object;
+    uint key;
+    int code;
+
+    if (plist->same == NULL && !pdf_has_other_resource(pdev, rtype, *ppres))
+        return 0;
+    code = cos_object_hash_key(pco0, pdev, &key);
+    if (code < 0)
+        return code;
+    if (code > 0)
+        return pdf_find_same_resource_slow(pdev, rtype, ppres, eq);
+    if (plist->same == NULL) {
+        code = pdf_build_same_resource_index(pdev, rtype, *ppres);
+        if (code < 0)
+            return code;
+    }
+    for (pres = plist->same[key & (plist->same_size - 1)]; pres != 0; pres = pres->same_next) {
+        cos_object_t *pco1 = pres->object;
+
+        if (pres == *ppres || pres->same_key != key)
+            continue;
+        if (pco1 == NULL || cos_type(pco0) != cos_type(pco1))
+            continue;	    /* don't compare different types */
+        code = pco0->cos_procs->equal(pco0, pco1, pdev);
+        if (code < 0)
+            return code;
+        if (code > 0) {
+            code = eq(pdev, *ppres, pres);
+            if (code < 0)
+                return code;
+            if (code > 0) {
+                *ppres = pres;
+                return 1;
+            }
+        }
+    }
+    code = pdf_index_same_resource(pdev, *ppres, rtype, key);
+    return code < 0 ? code : 0;
+}
+
 void
 pdf_drop_resource_from_chain(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_resource_type_t rtype)
 {
@@ -1454,6 +2102,7 @@ pdf_drop_resource_from_chain(gx_device_pdf * pdev, pdf_resource_t *pres1, pdf_re
         for (; (pres = *pprev) != 0; pprev = &pres->next)
             if (pres == pres1) {
                 *pprev = pres->next;
+                pdf_unindex_same_resource(pdev, pres, rtype);
 #if 0
                 if (pres->object) {
                     COS_RELEASE(pres->object, "pdf_forget_resource");
@@ -1482,6 +2131,7 @@ pdf_drop_resources(gx_device_pdf * pdev, pdf_resource_type_t rtype,
         for (; (pres = *pprev) != 0; ) {
             if (cond(pdev, pres)) {
                 *pprev = pres->next;
+                pdf_unindex_same_resource(pdev, pres, rtype);
                 pres->next = pres; /* A temporary mark - see below */
             } else
                 pprev = &pres->next;
@@ -1580,6 +2230,9 @@ pdf_alloc_aside(gx_device_pdf * pdev, pdf_resource_t ** plist,
     pres->named = false;
     pres->global = false;
     pres->where_used = pdev->used_mask;
+    pres->same_next = 0;
+    pres->same_key = 0;
+    pres->same_indexed = false;
     *ppres = pres;
     return 0;
 }
@@ -1760,6 +2413,7 @@ pdf_free_resource_objects(gx_device_pdf *pdev, pdf_resource_type_t rtype)
                     cos_free(pres->object, "pdf_free_resource_objects");
                     pres->object = 0;
                 }
+                pdf_unindex_same_resource(pdev, pres, rtype);
                 *prev = pres->next;
             }
         }
@@ -195,6 +195,9 @@ typedef enum {
     bool global;                /* ps2write only */\
     char rname[1/*R*/ + (sizeof(long) * 8 / 3 + 1) + 1/*\0*/];\
     ulong where_used;                /* 1 bit per level of content stream */\
+    pdf_resource_t *same_next;        /* next in pdf_find_same_resource index */\
+    uint same_key;                /* hash of object, if same_indexed */\
+    bool same_indexed;\
     cos_object_t *object
 typedef struct pdf_resource_s pdf_resource_t;
 struct pdf_resource_s {
@@ -204,8 +207,9 @@ struct pdf_resource_s {
 /* The descriptor is public for subclassing. */
 extern_st(st_pdf_resource);
 #define public_st_pdf_resource()  /* in gdevpdfu.c */\
-  gs_public_st_ptrs3(st_pdf_resource, pdf_resource_t, "pdf_resource_t",\
-    pdf_resource_enum_ptrs, pdf_resource_reloc_ptrs, next, prev, object)
+  gs_public_st_ptrs4(st_pdf_resource, pdf_resource_t, "pdf_resource_t",\
+    pdf_resource_enum_ptrs, pdf_resource_reloc_ptrs, next, prev, object,\
+    same_next)
 
 /*
  * We define XObject resources here because they are used for Image,
@@ -275,6 +279,15 @@ struct pdf_article_s {
     "pdf_article_t", pdf_article_enum_ptrs, pdf_article_reloc_ptrs,\
     next, contents)
 
+/*
+ * Compression workers.  When NumCompressionThreads is non-zero, the
+ * lossless encoder of a large image or page contents stream runs on a
+ * worker thread while the interpreter carries on.  The structure is
+ * private to gdevpdfu.c, it is allocated outside the garbage collected
+ * heap.
+ */
+typedef struct pdf_compress_worker_s pdf_compress_worker_t;
+
 /* ---------------- The device structure ---------------- */
 
 /* Resource lists */
@@ -283,8 +296,20 @@ struct pdf_article_s {
  * long lists.
  */
 #define NUM_RESOURCE_CHAINS 16
+/* Resources are also indexed by the MD5 hash of their objects, so that
+ * pdf_find_same_resource doesn't have to compare against every resource
+ * of the type. The index of a type is only built when it is first needed.
+ * 'same' is a table of 'same_size' (a power of 2) buckets linked through
+ * pres->same_next, grown as 'same_count' increases. Code which changes
+ * the object of a resource after it has been through pdf_find_same_resource
+ * must call pdf_rehash_same_resource.
+ */
+#define RESOURCE_SAME_INITIAL_SIZE 64
 typedef struct pdf_resource_list_s {
     pdf_resource_t *chains[NUM_RESOURCE_CHAINS];
+    pdf_resource_t **same;
+    uint same_size;
+    uint same_count;
 } pdf_resource_list_t;
 
 /* Define the hash function for gs_ids. */
@@ -953,6 +978,11 @@ struct gx_device_pdf_s {
     gs_glyph OCR_glyph;             /* Passes the current glyph code from text processing to the image processing code when rendering glyph bitmaps for OCR */
     ocr_glyph_t *ocr_glyphs;        /* Records bitmaps and other data from text processing when doing OCR */
     gs_gstate **initial_pattern_states;
+    int NumCompressionThreads;      /* Maximum number of compression worker threads, 0 means
+                                     * compress on the interpreter thread.
+                                     */
+    pdf_compress_worker_t *compress_workers; /* Not GC'd, see gdevpdfu.c */
+    int compress_worker_count;
 };
 
 #define is_in_page(pdev)\
@@ -1140,6 +1170,12 @@ int pdf_find_same_resource(gx_device_pdf * pdev,
         pdf_resource_type_t rtype, pdf_resource_t **ppres,
         int (*eq)(gx_device_pdf * pdev, pdf_resource_t *pres0, pdf_resource_t *pres1));
 
+/* Re-index a resource whose object has changed since pdf_find_same_resource. */
+int pdf_rehash_same_resource(gx_device_pdf * pdev, pdf_resource_t *pres);
+
+/* Release the indices used by pdf_find_same_resource. */
+void pdf_free_same_resource_index(gx_device_pdf * pdev);
+
 /* Find resource by resource id. */
 pdf_resource_t *pdf_find_resource_by_resource_id(gx_device_pdf * pdev,
                                                 pdf_resource_type_t rtype, gs_id id);
@@ -1227,6 +1263,16 @@ static int inline pdf_end_encrypt(gx_device_pdf *pdev)
 /* Initialize encryption. */
 int pdf_encrypt_init(const gx_device_pdf * pdev, gs_id object_id, stream_arcfour_state *psarc4);
 
+/*
+ * Move the lossless encoder of the pipeline s to a compression worker
+ * thread, if one is available. The output is unchanged. size_hint is the
+ * expected amount of data, or -1 if unknown; small streams stay on this
+ * thread. This must be called before any data is written to the pipeline.
+ */
+int pdf_thread_encoder(gx_device_pdf * pdev, stream *s, int64_t size_hint);
+/* Stop the compression workers. */
+void pdf_free_compress_workers(gx_device_pdf * pdev);
+
 /* ------ Pages ------ */
 
 /* Get or assign the ID for a page. */
@@ -0,0 +1,26 @@
+/* This file was generated automatically by unix-aux.mak. */
+
+#ifndef HAVE_DIRENT_H
+#define HAVE_DIRENT_H 1
+#endif
+
+#ifndef HAVE_NDIR_H
+#define HAVE_NDIR_H 0
+#endif
+
+#ifndef HAVE_SYS_DIR_H
+#define HAVE_SYS_DIR_H 0
+#endif
+
+#ifndef HAVE_SYS_NDIR_H
+#define HAVE_SYS_NDIR_H 0
+#endif
+
+#ifndef HAVE_SYS_TIME_H
+#define HAVE_SYS_TIME_H 0
+#endif
+
+#ifndef HAVE_SYS_TIMES_H
+#define HAVE_SYS_TIMES_H 0
+#endif
+